@@ -1,53 +1,184 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <string>
 
 #include "OpDyn.hh"
 
 using namespace Utopia::Models::OpDyn;
 
 
+/// Run the model; a model restarted from a checkpoint continues after it,
+/// without writing the state of the checkpoint again
+template<class Model>
+void run(Model& model) {
+    if (not model.restarted()) {
+        model.run();
+        return;
+    }
+    while (model.get_time() < model.get_time_max()) {
+        model.iterate();
+    }
+}
+
+/// Run a model of float state next to one of double state from the same seed
+/// and configuration, the latter writing to the group OpDyn_double. At every
+/// write, the drift of the opinions of the float model from those of the
+/// double model is logged; its maximum over the run is added as attributes of
+/// the group of the float model.
+template<Mode model_mode, NetworkBackend network_backend>
+void validate(Utopia::PseudoParent& pp) {
+    using Model = OpDyn<model_mode, network_backend, float>;
+    using Reference = OpDyn<model_mode, network_backend, double>;
+    using RNG = typename Model::RNG;
+
+    // both draw from copies of the same RNG, not from the shared one
+    Model model("OpDyn", pp, {}, std::make_shared<RNG>(*pp.get_rng()));
+    if (model.restarted()) {
+        throw std::invalid_argument("A validation run cannot be restarted "
+                                    "from a checkpoint!");
+    }
+    Reference reference("OpDyn_double", pp, pp.get_cfg()["OpDyn"],
+                        std::make_shared<RNG>(*pp.get_rng()));
+
+    double max_drift = 0.;
+    double max_mean_drift = 0.;
+    auto report = [&](){
+        const auto& nw = model.get_nw_u();
+        const auto& nw_ref = reference.get_nw_u();
+        double drift = 0.;
+        double mean_drift = 0.;
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+            const double d = std::fabs(nw[*v].opinion - nw_ref[*v].opinion);
+            drift = std::max(drift, d);
+            mean_drift += d;
+        }
+        mean_drift /= std::max<double>(1., num_vertices(nw));
+        model.get_logger()->info("Opinion drift from double precision at "
+                                 "time {}: max {:.3g}, mean {:.3g}",
+                                 model.get_time(), drift, mean_drift);
+        max_drift = std::max(max_drift, drift);
+        max_mean_drift = std::max(max_mean_drift, mean_drift);
+    };
+
+    model.write_data();
+    reference.write_data();
+    while (model.get_time() < model.get_time_max()) {
+        model.iterate();
+        reference.iterate();
+        if (model.get_time() % model.get_write_every() == 0) {
+            report();
+        }
+    }
+
+    model.get_hdfgrp()->add_attribute("max_opinion_drift", max_drift);
+    model.get_hdfgrp()->add_attribute("max_mean_opinion_drift",
+                                      max_mean_drift);
+}
+
+/// Run the model with the configured precision of its state: 'double',
+/// 'float', or 'validate' (see validate)
+template<Mode model_mode, NetworkBackend network_backend>
+void run_with_precision(Utopia::PseudoParent& pp,
+                        const std::string& precision)
+{
+    if (precision == "double") {
+        OpDyn<model_mode, network_backend, double> model("OpDyn", pp);
+        run(model);
+    }
+    else if (precision == "float") {
+        OpDyn<model_mode, network_backend, float> model("OpDyn", pp);
+        run(model);
+    }
+    else if (precision == "validate") {
+        validate<model_mode, network_backend>(pp);
+    }
+    else {
+        throw std::invalid_argument("Precision '" + precision + "' unknown! "
+                                    "Set precision to either 'double', "
+                                    "'float' or 'validate'");
+    }
+}
+
+/// Run the model in the given mode with the configured user network backend
+template<Mode model_mode>
+void run_with_backend(Utopia::PseudoParent& pp, const std::string& backend,
+                      const std::string& precision)
+{
+    if (backend == "adjacency_list") {
+        run_with_precision<model_mode, NetworkBackend::adjacency_list>(
+                                                            pp, precision);
+    }
+    else if (backend == "flat") {
+        run_with_precision<model_mode, NetworkBackend::flat>(pp, precision);
+    }
+    else {
+        throw std::invalid_argument("Network backend '" + backend + "' "
+                                    "unknown! Set backend to either "
+                                    "'adjacency_list' or 'flat'");
+    }
+}
+
+
 int main (int argc, char** argv)
 {
     try {
-        // Initialize the PseudoParent from config file path
-        Utopia::PseudoParent pp(argv[1]);
+        // Initialize the PseudoParent from config file path. A run restarted
+        // from a checkpoint appends to the output file of the interrupted
+        // run, from which the rows written after the checkpoint are removed.
+        const auto run_cfg = YAML::LoadFile(argv[1]);
+        const auto restart_from = Utopia::get_as<std::string>("restart_from",
+                        run_cfg["parameter_space"]["OpDyn"]["checkpoint"]);
+
+        std::unique_ptr<Utopia::PseudoParent> parent;
+        if (restart_from.empty()) {
+            parent = std::make_unique<Utopia::PseudoParent>(argv[1]);
+        }
+        else {
+            const auto output_path = Utopia::get_as<std::string>(
+                                                    "output_path", run_cfg);
+            checkpoint::truncate_datasets(output_path,
+                                    checkpoint::read_header(restart_from));
+            parent = std::make_unique<Utopia::PseudoParent>(argv[1],
+                        output_path,
+                        Utopia::get_as<unsigned int>("seed", run_cfg), "a");
+        }
+        auto& pp = *parent;
 
         auto model_cfg = pp.get_cfg()["OpDyn"];
         auto ageing = Utopia::get_as<std::string>("user_ageing", model_cfg);
         auto media = Utopia::get_as<std::string>("media_status", model_cfg);
-        
+        auto backend = Utopia::get_as<std::string>("backend",
+                                                   model_cfg["nw_u"]);
+        auto precision = Utopia::get_as<std::string>("precision", model_cfg);
+
         if (ageing=="on") {
             if (media=="on") {
-                OpDyn<Ageing_and_Media> model("OpDyn", pp);
-                model.run();
+                run_with_backend<Ageing_and_Media>(pp, backend, precision);
             }
             else if (media=="off") {
-                OpDyn<Ageing> model("OpDyn", pp);
-                model.run();
-
+                run_with_backend<Ageing>(pp, backend, precision);
             }
             else {
                 throw std::invalid_argument("Media mode {} unknown! Set media "
                                             "to either 'on' or 'off'");
             }
         }
-        
+
         else if (ageing=="off") {
             if (media=="on") {
-                OpDyn<Media> model ("OpDyn", pp);
-                model.run();
-
+                run_with_backend<Media>(pp, backend, precision);
             }
-            if (media=="off") {
-                OpDyn<None> model("OpDyn", pp);
-                model.run();
-
+            else if (media=="off") {
+                run_with_backend<None>(pp, backend, precision);
             }
             else {
                 throw std::invalid_argument("Media mode {} unknown! Set media "
                                             "to either 'on' or 'off'");
             }
         }
-        
+
         else {
             throw std::invalid_argument("Ageing mode {} unkown! Set ageing "
                                         " to either 'on' or 'off'");
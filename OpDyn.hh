@@ -4,8 +4,12 @@
 #include <cmath>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
@@ -19,8 +23,22 @@
 #include <utopia/data_io/graph_utils.hh>
 
 #include "ageing.hh"
+#include "checkpoint.hh"
+#include "convergence.hh"
+#include "events.hh"
+#include "flat_network.hh"
+#include "graph_analysis.hh"
 #include "modes.hh"
+#include "observables.hh"
+#include "output.hh"
+#include "parallel.hh"
+#include "profiling.hh"
 #include "revision.hh"
+#include "rewiring.hh"
+#include "sampling.hh"
+#include "scheduling.hh"
+#include "streams.hh"
+#include "synchronous.hh"
 #include "utils.hh"
 
 
@@ -33,54 +51,132 @@ using modes::Mode::Ageing;
 using modes::Mode::Media;
 using modes::Mode::Ageing_and_Media;
 
+/*! The available backends of the user network: */
+using modes::NetworkBackend;
+
 /*!Each user-network node accomodates one user. Each user holds an opinion, is susceptible to others'
  opinions, and has a certain tolerance towards other opinions, which is the
- radius of interaction.*/
-struct User {
-    double opinion;
-    double tolerance;
-    double susceptibility;
+ radius of interaction. The weights of the out-edges of a user are not
+ normalised; they hold relative values, whose sum is kept in weight_sum (see
+ revision::normalize_weights). The real-valued properties are of type Real,
+ double or float (see OpDyn). The properties read in the revisions come first;
+ the cold ones, only read in the ageing and the information revisions, are kept
+ small, such that a user takes 40 bytes (double) or 24 bytes (float). */
+template<typename Real=double>
+struct BasicUser {
+    Real opinion;
+    Real tolerance;
+    Real susceptibility;
+    Real weight_sum;
     unsigned int age;
-    size_t used_media;
+    unsigned int used_media;
+};
+
+using User = BasicUser<>;
+
+/*! Column-wise storage of the user properties for the flat network backend.
+Each property lives in its own array, so a scan over the opinions of the
+neighbours only touches the opinions. Indexing returns a bundle of references,
+such that nw[v].opinion reads the same for both backends; the whole column of
+a property is copied directly where all users are read (see
+OpDyn::copy_users). */
+template<typename Real=double>
+struct BasicUserColumns {
+    std::vector<Real> opinion;
+    std::vector<Real> tolerance;
+    std::vector<Real> susceptibility;
+    std::vector<Real> weight_sum;
+    std::vector<unsigned int> age;
+    std::vector<unsigned int> used_media;
+
+    template<bool is_const>
+    struct Ref {
+        template<typename T>
+        using ref_t = std::conditional_t<is_const, const T&, T&>;
+
+        ref_t<Real> opinion;
+        ref_t<Real> tolerance;
+        ref_t<Real> susceptibility;
+        ref_t<Real> weight_sum;
+        ref_t<unsigned int> age;
+        ref_t<unsigned int> used_media;
+    };
+
+    Ref<false> operator[](std::size_t v) {
+        return {opinion[v], tolerance[v], susceptibility[v], weight_sum[v],
+                age[v], used_media[v]};
+    }
+
+    Ref<true> operator[](std::size_t v) const {
+        return {opinion[v], tolerance[v], susceptibility[v], weight_sum[v],
+                age[v], used_media[v]};
+    }
+
+    void resize(std::size_t n) {
+        opinion.resize(n);
+        tolerance.resize(n);
+        susceptibility.resize(n);
+        weight_sum.resize(n);
+        age.resize(n);
+        used_media.resize(n);
+    }
 };
 
+using UserColumns = BasicUserColumns<>;
+
 /*!Each media-network node accomodates one medium; the principle is similar
 to that of the users. Each medium holds an opinion, is able to convince users
 of its stance (persuasiveness), is editorially flexible (i.e. able to change
 its stance) (susceptibility), and has a certain tolerance for other media's
-views. As in the user case, all parameters are dynamic. */
-
-struct Medium {
-    double opinion;
-    double tolerance;
-    double susceptibility;
-    double persuasiveness;
-    double ads;
-    double ads_normalized;
+views. As in the user case, all parameters are dynamic. The ad fractions
+are only computed for the output (see revision::normalize_ads). */
+
+template<typename Real=double>
+struct BasicMedium {
+    Real opinion;
+    Real tolerance;
+    Real susceptibility;
+    Real persuasiveness;
+    Real ads;
     unsigned int users;
-    unsigned int users_previous;
 };
 
+using Medium = BasicMedium<>;
+
 /// Each network edge has a certain weight, which can be negative or positive.
-struct Weight {
-    double attr;
+template<typename Real=double>
+struct BasicWeight {
+    Real attr;
 };
 
+using Weight = BasicWeight<>;
+
 /// The directed network type for the OpDyn Model:
-using Network_u =   boost::adjacency_list<
-                    boost::setS,        // edges
-                    boost::vecS,        // vertices
-                    boost::bidirectionalS,
-                    User,               // vertex property
-                    Weight>;            // edge property
+template<typename Real=double>
+using BasicNetwork_u =  boost::adjacency_list<
+                        boost::setS,        // edges
+                        boost::vecS,        // vertices
+                        boost::bidirectionalS,
+                        BasicUser<Real>,    // vertex property
+                        BasicWeight<Real>>; // edge property
 
 /// The undirected network type for the OpDyn Model:
-using Network_m =   boost::adjacency_list<
-                    boost::setS,        // edges
-                    boost::vecS,        // vertices
-                    boost::undirectedS,
-                    Medium,             // vertex property
-                    Weight>;            // edge property
+template<typename Real=double>
+using BasicNetwork_m =  boost::adjacency_list<
+                        boost::setS,        // edges
+                        boost::vecS,        // vertices
+                        boost::undirectedS,
+                        BasicMedium<Real>,  // vertex property
+                        BasicWeight<Real>>; // edge property
+
+/// The flat alternative to BasicNetwork_u (see flat_network.hh)
+template<typename Real=double>
+using BasicFlatNetwork_u = flat::FlatNetwork<BasicUserColumns<Real>,
+                                             BasicWeight<Real>>;
+
+using Network_u = BasicNetwork_u<>;
+using Network_m = BasicNetwork_m<>;
+using FlatNetwork_u = BasicFlatNetwork_u<>;
 
 using OpDynTypes = ModelTypes<>;
 using pair_double = std::pair<double,double>;
@@ -89,14 +185,34 @@ using pair_int = std::pair<int, int>;
 
 
 /// The OpDyn Model
-
-template<Mode model_mode=None>
+/** The real-valued state of the users, media and edges is of type Real:
+ *  double, or float for half the memory of large networks, at the price of
+ *  rounding (see the precision entry of the configuration and OpDyn.cc).
+ */
+template<Mode model_mode=None,
+         NetworkBackend network_backend=NetworkBackend::adjacency_list,
+         typename Real=double>
 class OpDyn:
-    public Model<OpDyn<model_mode>, OpDynTypes>
+    public Model<OpDyn<model_mode, network_backend, Real>, OpDynTypes>
 {
+    static_assert(std::is_floating_point_v<Real>,
+                  "The model state must be of a floating point type!");
+
 public:
     /// The base model type
-    using Base = Model<OpDyn<model_mode>, OpDynTypes>;
+    using Base = Model<OpDyn<model_mode, network_backend, Real>, OpDynTypes>;
+
+    /// The user network as created, before packing it into the backend
+    using Network_u = BasicNetwork_u<Real>;
+
+    /// The media network
+    using Network_m = BasicNetwork_m<Real>;
+
+    /// The user network type of the selected backend
+    using NWType_u = std::conditional_t<
+                        network_backend == NetworkBackend::flat,
+                        BasicFlatNetwork_u<Real>,
+                        Network_u>;
 
     /// Data type that holds the configuration
     using Config = typename Base::Config;
@@ -111,24 +227,99 @@ public:
     using RNG = typename Base::RNG;
 
 private:
+    using vertex_u = typename boost::graph_traits<NWType_u>::vertex_descriptor;
+
+    /// The data of one write, copied from the networks by write_data
+    struct WriteBuffer {
+        std::vector<double> opinion_u;
+        std::vector<double> tolerance_u;
+        std::vector<double> susceptibility_u;
+        std::vector<unsigned int> age_u;
+        std::vector<double> opinion_m;
+        std::vector<int> user_count;
+        std::vector<double> ads;
+        std::vector<double> rel_bc;
+        std::vector<double> rel_bc_error;
+        std::size_t num_opinion_clusters;
+        std::size_t num_weighted_opinion_clusters;
+        convergence::Indicators indicators;
+        std::int64_t convergence_time;
+        profiling::Summary profile;
+
+        // the final edges, only in the last write
+        bool final;
+        std::vector<vertex_u> sources;
+        std::vector<vertex_u> targets;
+    };
+
     // Base members: _time, _name, _cfg, _hdfgrp, _rng, _monitor
 
+    // The RNG of this model: the shared RNG of the parent, or the own RNG of
+    // a member of an ensemble (see OpDyn_ensemble.cc)
+    const std::shared_ptr<RNG> _model_rng;
+
+    // If set, serialises the writes of several models into the same file
+    const std::shared_ptr<std::mutex> _write_mutex;
+
+    // If set, guards the parent shared with other models: it is held by the
+    // thread running this model, which releases it only during perform_step
+    const std::shared_ptr<std::mutex> _parent_mutex;
+
     std::uniform_real_distribution<double> _uniform_distr_prob_val;
 
     // User properties
     const Config _cfg_u;
-    Network_u _nw_u;
+    NWType_u _nw_u;
     const double _radicalisation_parameter;
     const double _rewiring;
     unsigned int _rewiring_count;
     const double _weighting;
 
+    // Cumulative out-weights of the users, for drawing interaction partners
+    sampling::NeighbourSampler<NWType_u> _nb_sampler;
+
+    // The buffers and marks of the rewiring, reused by all revisions
+    rewiring::Scratch<NWType_u> _rewiring_scratch;
+
+    // The number of revisions per step, and the total number performed
+    const std::size_t _revisions_per_step;
+    std::size_t _num_revisions;
+
+    // The scheduling of the user revisions; but for the uniform one, only
+    // those that can change the state are performed (see scheduling.hh).
+    // Their slots are numbered 2 * revision + (0 or 1).
+    const scheduling::Scheduler _scheduling;
+    scheduling::KineticScheduler<NWType_u> _scheduler;
+    scheduling::ActiveSet<NWType_u> _active;
+
+    // If set, the user revisions are replaced by synchronous sweeps over all
+    // users, one every _sweep_every revisions, i.e. as many user updates as
+    // user revisions (see synchronous.hh)
+    const bool _synchronous;
+    const std::size_t _sweep_every;
+    synchronous::Sweep<NWType_u> _sweep;
+
+    // Parallel user revisions: the seed of the random number streams, the
+    // thread pool, the scheduling of the users of a batch and the buffers of
+    // their revisions
+    const bool _parallel;
+    const std::size_t _batch_size;
+    std::uint64_t _seed;
+    parallel::ThreadPool _pool;
+    parallel::ConflictColouring<NWType_u> _colouring;
+    revision::BatchScratch<NWType_u> _batch_scratch;
+    std::vector<typename boost::graph_traits<NWType_u>::vertex_descriptor>
+        _batch;
+
     const unsigned int _life_cycle;
     const double _replacement_rate;
     const pair_int _child_ages;
     const pair_int _parent_ages;
     const pair_int _senior_ages;
 
+    // The susceptibility of the users by age, applied in the ageing step
+    const utils::SusceptibilityTable _susceptibility_table;
+
     // Media properties
     const Config _cfg_m;
     Network_m _nw_m;
@@ -137,6 +328,59 @@ private:
     pair_double _ads;
     pair_double _attr;
 
+    // The ad values of the media, for drawing media proportional to them
+    sampling::FenwickTree _ads_tree;
+
+    // Output: whether the opinions of the users are written, and whether
+    // reductions of the opinion distribution are written (see observables)
+    const bool _write_opinion_u;
+    const bool _observables;
+    const std::size_t _num_bins;
+    const double _peak_prominence;
+    const std::size_t _peak_distance;
+
+    // Storage settings of the per-vertex datasets
+    const output::DatasetSpec _out_opinion_u;
+    const output::DatasetSpec _out_tolerance_u;
+    const output::DatasetSpec _out_susceptibility_u;
+    const output::DatasetSpec _out_age_u;
+    const output::DatasetSpec _out_opinion_m;
+    const output::DatasetSpec _out_user_count;
+
+    // Betweenness centrality of the users, exact or estimated from a sample
+    // of source vertices; the samples are drawn from their own streams, so
+    // they do not change the dynamics
+    const bool _betweenness;
+    const std::size_t _betweenness_samples;
+    std::uint64_t _analysis_seed;
+
+    // Running indicators of the change of the users; if enabled, the steps
+    // after they have become quiescent are skipped (see convergence.hh), and
+    // only the first write after that is done, as the final one
+    const bool _detect_convergence;
+    convergence::Monitor _convergence;
+    bool _final_written;
+
+    // The time spent in the phases of the model and counters of events in
+    // them, if compiled in (see profiling.hh); published by monitor(), which
+    // keeps the values of its previous call for the rates, and written to the
+    // profile group at the final write
+    profiling::Profile _profile;
+    profiling::Summary _monitored;
+
+    // Checkpoints of the full state every _checkpoint_every steps (see
+    // checkpoint.hh); if _restart_from is given, the model continues from
+    // that checkpoint instead of initializing itself
+    const std::size_t _checkpoint_every;
+    const std::string _checkpoint_path;
+    const std::string _restart_from;
+    std::size_t _num_writes;
+
+    // Records every change of the user network topology, if enabled, with
+    // the full edge list every _keyframe_every steps (see events.hh)
+    const std::size_t _keyframe_every;
+    std::unique_ptr<events::EdgeLog> _edge_log;
+
     // datasets and groups
 
     std::shared_ptr<DataGroup> _grp_nw_u;
@@ -181,33 +425,93 @@ private:
 
     std::shared_ptr<DataSet> _dset_rel_bc;
 
+    std::shared_ptr<DataSet> _dset_rel_bc_error;
+
     std::shared_ptr<DataSet> _dset_weights;
 
+    std::shared_ptr<DataSet> _dset_opinion_histogram;
 
-public:
-    // Constructs the OpDyn model
+    std::shared_ptr<DataSet> _dset_opinion_variance;
+
+    std::shared_ptr<DataSet> _dset_opinion_range;
+
+    std::shared_ptr<DataSet> _dset_localization;
+
+    std::shared_ptr<DataSet> _dset_polarization;
+
+    std::shared_ptr<DataSet> _dset_number_of_peaks;
 
+    std::shared_ptr<DataSet> _dset_max_opinion_change;
+
+    std::shared_ptr<DataSet> _dset_mean_opinion_change;
+
+    std::shared_ptr<DataSet> _dset_rewiring_rate;
+
+    std::shared_ptr<DataSet> _dset_convergence_time;
+
+    // Writes the snapshots of write_data to the datasets, possibly on its own
+    // thread; declared last, so that it is drained before the datasets close
+    output::BufferedWriter<WriteBuffer> _writer;
+
+
+public:
+    /** @brief Constructs the OpDyn model
+     *  @detail The optional arguments allow running several models in one
+     *  process (see OpDyn_ensemble.cc): a configuration replacing the one
+     *  of the parent, an own RNG, an initial user network to copy instead of
+     *  creating one, a mutex guarding the writes to a shared file, and a
+     *  mutex guarding the shared parent (see _parent_mutex).
+     */
     template<class ParentModel>
     OpDyn (const std::string name,
-                    ParentModel &parent)
+                    ParentModel &parent,
+                    const Config& custom_cfg = {},
+                    std::shared_ptr<RNG> rng = nullptr,
+                    std::shared_ptr<const Network_u> initial_nw_u = nullptr,
+                    std::shared_ptr<std::mutex> write_mutex = nullptr,
+                    std::shared_ptr<std::mutex> parent_mutex = nullptr)
     :
         // Initialize first via base model
-        Base(name, parent),
+        Base(name, parent, custom_cfg),
+        _model_rng(rng ? rng : this->_rng),
+        _write_mutex(write_mutex),
+        _parent_mutex(parent_mutex),
         _cfg_u(this->_cfg["nw_u"]),
         _cfg_m(this->_cfg["nw_m"]),
 
         // initialize network
-        _nw_u(this->init_nw_u()),
+        _nw_u(this->init_nw_u(initial_nw_u)),
         _nw_m(this->init_nw_m()),
 
         _uniform_distr_prob_val(std::uniform_real_distribution<double>(0., 1.)),
+        _nb_sampler(num_vertices(_nw_u)),
+        _rewiring_scratch(num_vertices(_nw_u)),
 
         // model parameters
+        _revisions_per_step(this->init_revisions_per_step()),
+        _num_revisions(0),
+        _scheduling(this->init_scheduling()),
+        _scheduler(_scheduling == scheduling::Scheduler::kinetic ?
+                   num_vertices(_nw_u) : 0),
+        _active(_scheduling == scheduling::Scheduler::active ?
+                num_vertices(_nw_u) : 0, _rewiring),
+        _synchronous(this->init_synchronous()),
+        _sweep_every(std::max<std::size_t>(1, num_vertices(_nw_u) / 2)),
+        _sweep(),
+        _parallel(get_as<bool>("enabled", this->_cfg["parallel"])),
+        _batch_size(get_as<std::size_t>("batch_size",
+                                        this->_cfg["parallel"])),
+        _seed(_parallel ? (*_model_rng)() : 0),
+        _pool(this->init_num_threads()),
+        _colouring(num_vertices(_nw_u)),
+        _batch_scratch(),
+        _batch(),
         _life_cycle(get_as<int>("life_cycle", this->_cfg)),
         _replacement_rate(get_as<double>("replacement_rate", this->_cfg)),
         _child_ages(get_as<pair_int>("children", this->_cfg["age_groups"])),
         _parent_ages(get_as<pair_int>("parents", this->_cfg["age_groups"])),
         _senior_ages(get_as<pair_int>("seniors", this->_cfg["age_groups"])),
+        _susceptibility_table(this->_cfg["susceptibility"]["users"]["custom"]),
         _radicalisation_parameter(
                     get_as<double>("radicalisation_parameter", this->_cfg)),
         _rewiring(get_as<double>("rewiring", this->_cfg)),
@@ -218,54 +522,187 @@ public:
         _num_media(num_vertices(_nw_m)),
         _ads(get_as<pair_double>("init_ads", this->_cfg)),
         _attr(get_as<pair_double>("attr", this->_cfg)),
+        _ads_tree(_num_media),
+        _write_opinion_u(get_as<bool>("write_opinion_u", this->_cfg)),
+        _observables(get_as<bool>("enabled", this->_cfg["observables"])),
+        _num_bins(get_as<std::size_t>("num_bins", this->_cfg["observables"])),
+        _peak_prominence(get_as<double>("peak_prominence",
+                                        this->_cfg["observables"])),
+        _peak_distance(get_as<std::size_t>("peak_distance",
+                                           this->_cfg["observables"])),
+        _out_opinion_u("opinion_u", this->_cfg["output"], true),
+        _out_tolerance_u("tolerance_u", this->_cfg["output"], true),
+        _out_susceptibility_u("susceptibility_u", this->_cfg["output"], true),
+        _out_age_u("age_u", this->_cfg["output"], false),
+        _out_opinion_m("opinion_m", this->_cfg["output"], true),
+        _out_user_count("user_count", this->_cfg["output"], false),
+        _betweenness(get_as<bool>("enabled", this->_cfg["betweenness"])),
+        _betweenness_samples(get_as<std::size_t>("num_samples",
+                                                 this->_cfg["betweenness"])),
+        _analysis_seed(RNG(*_model_rng)()),
+        _detect_convergence(get_as<bool>("enabled", this->_cfg["convergence"])),
+        _convergence(get_as<double>("max_opinion_change",
+                                    this->_cfg["convergence"]),
+                     get_as<double>("max_rewiring_rate",
+                                    this->_cfg["convergence"]),
+                     get_as<std::size_t>("patience",
+                                         this->_cfg["convergence"])),
+        _final_written(false),
+        _profile(),
+        _monitored(),
+        _checkpoint_every(get_as<std::size_t>("every",
+                                              this->_cfg["checkpoint"])),
+        _checkpoint_path(get_as<std::string>("path_prefix",
+                                             this->_cfg["checkpoint"])
+                         + "_" + this->_name + ".chk"),
+        _restart_from(get_as<std::string>("restart_from",
+                                          this->_cfg["checkpoint"])),
+        _num_writes(0),
+        _keyframe_every(get_as<std::size_t>("keyframe_every",
+                                            this->_cfg["edge_events"])),
+        _edge_log(this->init_edge_log()),
 
         // create datagroups and datasets
-        _grp_nw_u(Utopia::DataIO::create_graph_group(_nw_u, this->_hdfgrp,
-                                                    "nw_users")),
+        _grp_nw_u(this->create_nw_u_group()),
         _grp_nw_m(Utopia::DataIO::create_graph_group(_nw_m, this->_hdfgrp,
                                                     "nw_media")),
 
         _dset_vertices_u(this->create_dset("_vertices", _grp_nw_u,
-                        {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, 5)),
         _grp_edges_u(_grp_nw_u->open_group("_edges")),
         _dset_edges_u_initial(_grp_edges_u->open_dataset("0",
-                        {2, boost::num_edges(_nw_u)})),
+                        {2, num_edges(_nw_u)})),
         _dset_edges_u_final(_grp_edges_u->open_dataset("1",
-                        {2, boost::num_edges(_nw_u)})),
-        _dset_opinion_u(this->create_dset("opinion_u", _grp_nw_u,
-                        {boost::num_vertices(_nw_u)}, 5)),
+                        {2, num_edges(_nw_u)})),
+        _dset_opinion_u(_write_opinion_u ?
+                        this->create_dset("opinion_u", _grp_nw_u,
+                        {num_vertices(_nw_u)}, _out_opinion_u.compression,
+                        _out_opinion_u.chunksize) : nullptr),
         _dset_tolerance_u(this->create_dset("tolerance_u", _grp_nw_u,
-                                          {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, _out_tolerance_u.compression,
+                        _out_tolerance_u.chunksize)),
         _dset_susceptibility_u(this->create_dset("susceptibility_u", _grp_nw_u,
-                                        {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)},
+                        _out_susceptibility_u.compression,
+                        _out_susceptibility_u.chunksize)),
         _dset_age_u(this->create_dset("age_u", _grp_nw_u,
-                                          {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, _out_age_u.compression,
+                        _out_age_u.chunksize)),
         _dset_opinion_m(this->create_dset("opinion_m", _grp_nw_m,
-                        {boost::num_vertices(_nw_m)}, 5)),
+                        {boost::num_vertices(_nw_m)},
+                        _out_opinion_m.compression,
+                        _out_opinion_m.chunksize)),
         _dset_avg_nb_opinion_u(this->create_dset("avg_nb_opinion_u", _grp_nw_u,
-                        {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, 5)),
         _dset_users(this->create_dset("user_count", _grp_nw_m,
-                        {boost::num_vertices(_nw_m)}, 5)),
+                        {boost::num_vertices(_nw_m)},
+                        _out_user_count.compression,
+                        _out_user_count.chunksize)),
         _dset_ads(this->create_dset("ads", _grp_nw_m,
                         {boost::num_vertices(_nw_m)}, 5)),
         _dset_rewiring_count(this->create_dset("rewiring_count", _grp_nw_u,
                         {}, 5)),
         _dset_out_degree(_grp_nw_u->open_dataset("out_degree",
-                        {boost::num_vertices(_nw_u)})),
+                        {num_vertices(_nw_u)})),
         _dset_in_degree(this->create_dset("in_degree", _grp_nw_u,
-                        {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, 5)),
         _dset_num_opinion_clusters(this->create_dset("num_opinion_clusters",
                         _grp_nw_u, {}, 5)),
         _dset_num_weighted_opinion_clusters(this->create_dset(
                         "num_weighted_opinion_clusters", _grp_nw_u, {}, 5)),
         _dset_rel_bc(this->create_dset("rel_bc", _grp_nw_u,
-                        {boost::num_vertices(_nw_u)}, 5)),
+                        {num_vertices(_nw_u)}, 5)),
+        _dset_rel_bc_error((_betweenness and _betweenness_samples > 0) ?
+                        this->create_dset("rel_bc_error", _grp_nw_u,
+                        {num_vertices(_nw_u)}, 5) : nullptr),
         _dset_weights(this->create_dset("weights", _grp_nw_u,
-                        {boost::num_edges(_nw_u)}, 5))
+                        {num_edges(_nw_u)}, 5)),
+        _dset_opinion_histogram(_observables ?
+                        this->create_dset("opinion_histogram", _grp_nw_u,
+                        {_num_bins}, 5) : nullptr),
+        _dset_opinion_variance(_observables ?
+                        this->create_dset("opinion_variance", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_opinion_range(_observables ?
+                        this->create_dset("opinion_range", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_localization(_observables ?
+                        this->create_dset("localization", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_polarization(_observables ?
+                        this->create_dset("polarization", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_number_of_peaks(_observables ?
+                        this->create_dset("number_of_peaks", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_max_opinion_change(_detect_convergence ?
+                        this->create_dset("max_opinion_change", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_mean_opinion_change(_detect_convergence ?
+                        this->create_dset("mean_opinion_change", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_rewiring_rate(_detect_convergence ?
+                        this->create_dset("rewiring_rate", _grp_nw_u,
+                        {}, 5) : nullptr),
+        _dset_convergence_time(_detect_convergence ?
+                        _grp_nw_u->open_dataset("convergence_time", {1})
+                        : nullptr),
+        _writer([this](const WriteBuffer& buf){ this->write_buffer(buf); },
+                get_as<bool>("enabled", this->_cfg["async_write"]),
+                get_as<std::size_t>("queue_depth", this->_cfg["async_write"]))
     {
         this->_log->debug("Constructing the OpDyn Model ...");
 
+        if (_batch_size == 0) {
+            throw std::invalid_argument("The parallel batch_size must be "
+                                        "positive!");
+        }
+        if (_observables and _num_bins == 0) {
+            throw std::invalid_argument("The number of histogram bins must be "
+                                        "positive!");
+        }
+        if (_scheduling != scheduling::Scheduler::uniform and _parallel) {
+            throw std::invalid_argument("Only the uniform scheduler can be "
+                                        "used with parallel revisions!");
+        }
+        if (_synchronous and (_parallel or _scheduling
+                                        != scheduling::Scheduler::uniform))
+        {
+            throw std::invalid_argument("The synchronous update rule cannot "
+                                        "be used with parallel revisions or "
+                                        "another than the uniform "
+                                        "scheduler!");
+        }
+        // the information revisions draw a medium by its ad value
+        if (_num_media == 0) {
+            throw std::invalid_argument("The media network must have at "
+                                        "least one medium!");
+        }
+        if (_checkpoint_every % this->get_write_every() != 0) {
+            throw std::invalid_argument("The checkpoint interval must be a "
+                                        "multiple of write_every!");
+        }
+        if (_parallel) {
+            this->_log->info("Revising users in parallel batches of {} "
+                             "revisions on {} threads.", _batch_size,
+                             _pool.num_threads());
+        }
+
+        // the output of the interrupted run is already there
+        if (restarted()) {
+            this->restore(_restart_from);
+            return;
+        }
+
         this->initialize_properties();
+        _convergence.reset(_nw_u, _num_revisions, _rewiring_count);
+        if (_scheduling == scheduling::Scheduler::kinetic) {
+            _scheduler.update_all(_nw_u);
+            _scheduler.reschedule(0, *_model_rng);
+        }
+        else if (_scheduling == scheduling::Scheduler::active) {
+            _active.update_all(_nw_u);
+        }
 
         this->_log->info("Initialized user network with {} vertices and {} edges",
                          num_vertices(_nw_u), num_edges(_nw_u));
@@ -273,11 +710,11 @@ public:
                          num_vertices(_nw_m), num_edges(_nw_m));
 
         // Write the vertex data once as it does not change
-        auto [v, v_end] = boost::vertices(_nw_u);
-        auto [e, e_end] = boost::edges(_nw_u);
+        auto [v, v_end] = vertices(_nw_u);
+        auto [e, e_end] = edges(_nw_u);
 
         _dset_vertices_u->write(v, v_end, [&](auto vd){
-                       return boost::get(boost::vertex_index_t(), _nw_u, vd);
+                       return get(boost::vertex_index_t(), _nw_u, vd);
         });
 
         _dset_out_degree->write(v, v_end, [&](auto vd){
@@ -285,25 +722,42 @@ public:
         });
 
         _dset_edges_u_initial->write(e, e_end, [&](auto ed){
-                return boost::get(boost::vertex_index_t(), _nw_u,
-                                  boost::source(ed, _nw_u));
+                return get(boost::vertex_index_t(), _nw_u,
+                           source(ed, _nw_u));
         });
 
         _dset_edges_u_initial->write(e, e_end, [&](auto ed){
-                return boost::get(boost::vertex_index_t(), _nw_u,
-                                  boost::target(ed, _nw_u));
+                return get(boost::vertex_index_t(), _nw_u,
+                           target(ed, _nw_u));
         });
 
         Utopia::DataIO::save_graph(_nw_m, _grp_nw_m);
 
-        _dset_opinion_u->add_attribute("is_vertex_property", true);
         _dset_opinion_m->add_attribute("is_vertex_property", true);
         _dset_users->add_attribute("is_vertex_property", true);
         _dset_ads->add_attribute("is_vertex_property", true);
         _dset_weights->add_attribute("is_edge_property", true);
-        _dset_opinion_u->add_attribute("dim_name__1", "vertex");
-        _dset_opinion_u->add_attribute("coords_mode__vertex", "start_and_step");
-        _dset_opinion_u->add_attribute("coords__vertex", std::vector<std::size_t>{0, 1});
+        output::add_attributes(*_dset_tolerance_u, _out_tolerance_u);
+        output::add_attributes(*_dset_susceptibility_u, _out_susceptibility_u);
+        output::add_attributes(*_dset_opinion_m, _out_opinion_m);
+        if (_write_opinion_u) {
+            output::add_attributes(*_dset_opinion_u, _out_opinion_u);
+            _dset_opinion_u->add_attribute("is_vertex_property", true);
+            _dset_opinion_u->add_attribute("dim_name__1", "vertex");
+            _dset_opinion_u->add_attribute("coords_mode__vertex",
+                                           "start_and_step");
+            _dset_opinion_u->add_attribute("coords__vertex",
+                                           std::vector<std::size_t>{0, 1});
+        }
+        if (_observables) {
+            _dset_opinion_histogram->add_attribute("dim_name__1", "bin");
+            _dset_opinion_histogram->add_attribute("coords_mode__bin",
+                                                   "linspace");
+            _dset_opinion_histogram->add_attribute("coords__bin",
+                    std::vector<double>{0.5 / _num_bins,
+                                        1. - 0.5 / _num_bins,
+                                        double(_num_bins)});
+        }
     }
 
 private:
@@ -316,78 +770,189 @@ private:
         /// Initialize the media network properties if the media network is turned on; this is done first
         /// to be able to set the media user count to 0.
         if constexpr (model_mode == Media or Ageing_and_Media) {
+            // the distributions are parsed once, not per vertex
+            const utils::Distribution opinion(this->_cfg["opinion"]["media"]);
+            const utils::Distribution tolerance(
+                                    this->_cfg["tolerance"]["media"]);
+            const utils::Distribution susceptibility(
+                                    this->_cfg["susceptibility"]["media"]);
+            const utils::Distribution persuasiveness(
+                                    this->_cfg["persuasiveness"]["media"]);
+
             for (auto v : range<IterateOver::vertices>(_nw_m)) {
 
-                _nw_m[v].opinion=utils::initialize(
-                                   this->_cfg["opinion"]["media"],
-                                   *this->_rng);
-                _nw_m[v].tolerance=utils::initialize(
-                                   this->_cfg["tolerance"]["media"],
-                                   *this->_rng);
-                _nw_m[v].susceptibility=utils::initialize(
-                                   this->_cfg["susceptibility"]["media"],
-                                   *this->_rng);
-                _nw_m[v].persuasiveness=utils::initialize(
-                                   this->_cfg["persuasiveness"]["media"],
-                                   *this->_rng);
+                _nw_m[v].opinion=opinion(*_model_rng);
+                _nw_m[v].tolerance=tolerance(*_model_rng);
+                _nw_m[v].susceptibility=susceptibility(*_model_rng);
+                _nw_m[v].persuasiveness=persuasiveness(*_model_rng);
                 _nw_m[v].users = 0.;
                 _nw_m[v].ads = 0.;
 
                 // set inter-media attractions
                 for (auto e : range<IterateOver::out_edges>(v, _nw_m)) {
-                    _nw_m[e].attr=utils::set_init_uniform(_attr, *this->_rng);
+                    _nw_m[e].attr=utils::set_init_uniform(_attr, *_model_rng);
                 }
             }
         }
 
         /// Second, initialize the user network properties:
-        for (auto v : range<IterateOver::vertices>(_nw_u)) {
+        const utils::Distribution opinion(this->_cfg["opinion"]["users"]);
+        const utils::Distribution tolerance(this->_cfg["tolerance"]["users"]);
+        const utils::Distribution susceptibility(
+                                    this->_cfg["susceptibility"]["users"]);
 
-            _nw_u[v].age = utils::get_rand_int<RNG>(1, 85, *this->_rng);
+        for (auto [it, it_end] = vertices(_nw_u); it!=it_end; ++it) {
+            const auto v = *it;
 
-            _nw_u[v].opinion=utils::initialize(
-                                this->_cfg["opinion"]["users"],
-                                *this->_rng);
+            _nw_u[v].age = utils::get_rand_int<RNG>(1, 85, *_model_rng);
 
-            _nw_u[v].tolerance=utils::initialize(
-                                _nw_u[v].age,
-                                this->_cfg["tolerance"]["users"],
-                                *this->_rng);
+            _nw_u[v].opinion=opinion(*_model_rng);
 
-            _nw_u[v].susceptibility=utils::initialize(
-                                _nw_u[v].age,
-                                this->_cfg["susceptibility"]["users"],
-                                *this->_rng);
+            _nw_u[v].tolerance=tolerance(_nw_u[v].age, *_model_rng);
+
+            _nw_u[v].susceptibility=susceptibility(_nw_u[v].age, *_model_rng);
 
             if constexpr (model_mode == Media or Ageing_and_Media) {
                 // choose random medium
                 _nw_u[v].used_media = utils::get_rand_int<RNG>(0,
                                                               _num_media,
-                                                              *this->_rng);
+                                                              *_model_rng);
                 _nw_m[_nw_u[v].used_media].users++;
                 _nw_m[_nw_u[v].used_media].ads++;
             }
             // set initial edge weight to 1/out-degree
-            for (auto e : range<IterateOver::out_edges>(v, _nw_u)) {
-                _nw_u[e].attr = 1. / double(out_degree(v, _nw_u));
+            for (auto [e, e_end] = out_edges(v, _nw_u); e!=e_end; ++e) {
+                _nw_u[*e].attr = 1. / double(out_degree(v, _nw_u));
             }
+            revision::sum_weights(v, _nw_u);
         }
 
         if constexpr (model_mode == Media or Ageing_and_Media) {
-            revision::normalize_ads(_nw_m);
+            for (auto [m, m_end] = boost::vertices(_nw_m); m!=m_end; ++m) {
+                _ads_tree.set(*m, _nw_m[*m].ads);
+            }
+            _ads_tree.rebuild();
         }
     }
 
-    Network_u init_nw_u() {
-        this->_log->debug("Creating and initializing the user network ...");
-        Network_u nw = Graph::create_graph<Network_u>(_cfg_u, *this->_rng);
-        return nw;
+    NWType_u init_nw_u(const std::shared_ptr<const Network_u>& initial_nw) {
+        Network_u nw;
+        if (initial_nw) {
+            this->_log->debug("Copying the given initial user network ...");
+            nw = *initial_nw;
+        }
+        else {
+            this->_log->debug("Creating and initializing the user network ...");
+            nw = Graph::create_graph<Network_u>(_cfg_u, *_model_rng);
+        }
+
+        if constexpr (network_backend == NetworkBackend::flat) {
+            this->_log->debug("Packing the user network into flat blocks ...");
+            return NWType_u::from(nw);
+        }
+        else {
+            return nw;
+        }
+    }
+
+    /// The number of revisions per step; 0 means one sweep (one revision per
+    /// user on average)
+    std::size_t init_revisions_per_step() {
+        const auto revisions = get_as<int>("revisions_per_step", this->_cfg);
+        if (revisions < 0) {
+            throw std::invalid_argument("revisions_per_step must be 0 (one "
+                                        "sweep) or a positive integer!");
+        }
+        if (revisions == 0) {
+            return num_vertices(_nw_u);
+        }
+        return revisions;
+    }
+
+    /// Whether the users are updated in synchronous sweeps
+    bool init_synchronous() {
+        const auto rule = get_as<std::string>("update_rule", this->_cfg);
+        if (rule != "pairwise" and rule != "synchronous") {
+            throw std::invalid_argument("Update rule '" + rule + "' unknown! "
+                                        "Set update_rule to either "
+                                        "'pairwise' or 'synchronous'");
+        }
+        return rule == "synchronous";
+    }
+
+    /// The scheduling of the user revisions
+    scheduling::Scheduler init_scheduling() {
+        const auto scheduler = get_as<std::string>("scheduler", this->_cfg);
+        if (scheduler == "uniform") {
+            return scheduling::Scheduler::uniform;
+        }
+        else if (scheduler == "kinetic") {
+            return scheduling::Scheduler::kinetic;
+        }
+        else if (scheduler == "active") {
+            return scheduling::Scheduler::active;
+        }
+        throw std::invalid_argument("Scheduler '" + scheduler + "' unknown! "
+                                    "Set scheduler to either 'uniform', "
+                                    "'kinetic' or 'active'");
+    }
+
+    /// The number of threads of the pool; 1 if the revisions are sequential
+    std::size_t init_num_threads() {
+        if (not _parallel and not _synchronous
+            and not get_as<bool>("enabled", this->_cfg["betweenness"]))
+        {
+            return 1;
+        }
+        return get_as<std::size_t>("num_threads", this->_cfg["parallel"]);
+    }
+
+    /// The edge event log, starting with a keyframe of the initial network;
+    /// nullptr if disabled
+    std::unique_ptr<events::EdgeLog> init_edge_log() {
+        const auto cfg = this->_cfg["edge_events"];
+        if (not get_as<bool>("enabled", cfg)) {
+            return nullptr;
+        }
+        if (_keyframe_every == 0) {
+            throw std::invalid_argument("The edge_events keyframe_every must "
+                                        "be positive!");
+        }
+        const auto path = get_as<std::string>("path_prefix", cfg) + "_"
+                          + this->_name + ".bin";
+        this->_log->info("Writing the edge events to '{}'.", path);
+
+        // a restarted model appends the keyframe of its checkpoint
+        auto edge_log = std::make_unique<events::EdgeLog>(path,
+                                                          num_vertices(_nw_u),
+                                                          restarted());
+        if (not restarted()) {
+            edge_log->keyframe(_nw_u);
+        }
+        return edge_log;
+    }
+
+    /// Create the user network group, with the attributes Utopia would set
+    std::shared_ptr<DataGroup> create_nw_u_group() {
+        if constexpr (network_backend == NetworkBackend::flat) {
+            auto grp = this->_hdfgrp->open_group("nw_users");
+            grp->add_attribute("content", "graph");
+            grp->add_attribute("is_directed", true);
+            grp->add_attribute("allows_parallel", false);
+            grp->add_attribute("num_vertices", num_vertices(_nw_u));
+            grp->add_attribute("num_edges", num_edges(_nw_u));
+            return grp;
+        }
+        else {
+            return Utopia::DataIO::create_graph_group(_nw_u, this->_hdfgrp,
+                                                      "nw_users");
+        }
     }
 
     Network_m init_nw_m() {
         if constexpr (model_mode == Media or Ageing_and_Media) {
             this->_log->debug("Creating and initializing the media network ...");
-            Network_m nw = Graph::create_graph<Network_m>(_cfg_m, *this->_rng);
+            Network_m nw = Graph::create_graph<Network_m>(_cfg_m, *_model_rng);
             return nw;
         }
     }
@@ -397,47 +962,227 @@ public:
     // Runtime functions ......................................................
 
     /** @brief Iterate a single step
-     *  @detail Each step consists of (i) user revision: interaction between
+     *  @detail Each step consists of a batch of revisions (see
+     *  perform_revision); the batch size is set by 'revisions_per_step'. If
+     *  the parallel mode is enabled, the revisions are performed in batches
+     *  of 'batch_size' (see perform_parallel_revisions).
+     */
+    void perform_step () {
+        // the steps only touch the state of this model and may run alongside
+        // those of other models on the same parent
+        const parallel::Unlock unlock(_parent_mutex.get());
+
+        // nothing changes any more
+        if (_convergence.converged()) {
+            return;
+        }
+
+        const profiling::Bind bind(&_profile);
+        const profiling::Timer timer(_profile, profiling::Phase::step);
+        profiling::count(profiling::Counter::revisions, _revisions_per_step);
+
+        // the edge events are stamped with the time after this step
+        const auto step = this->get_time() + 1;
+        if (_edge_log) {
+            _edge_log->begin_step(step);
+        }
+
+        if (_parallel) {
+            for (std::size_t i=0; i<_revisions_per_step; i+=_batch_size) {
+                perform_parallel_revisions(
+                            std::min(_batch_size, _revisions_per_step - i));
+            }
+        }
+        else {
+            for (std::size_t i=0; i<_revisions_per_step; ++i) {
+                perform_revision();
+                ++_num_revisions;
+            }
+        }
+
+        if (_edge_log and step % _keyframe_every == 0) {
+            _edge_log->keyframe(_nw_u);
+        }
+
+        if (_detect_convergence
+            and _convergence.update(_nw_u, step, _num_revisions,
+                                    _rewiring_count))
+        {
+            this->_log->info("Converged at time {}; the remaining steps are "
+                             "skipped.", step);
+        }
+    }
+
+    /** @brief Perform a single revision
+     *  @detail Each revision consists of (i) user revision: interaction between
      *  two users, (ii) information revision: interaction between a user and
      *  the media, (iii) media revision: interaction between two media.
      *  Media opinion revision can happen on timescales different to that of the user opinion revision.
+     *  The media time constant and the life cycle count revisions, such that
+     *  the dynamics do not depend on the number of revisions per step.
+     *  With the synchronous update rule, the user revisions are replaced by
+     *  a sweep over all users every _sweep_every revisions.
      */
-    void perform_step () {
+    void perform_revision () {
+
+        if (_synchronous) {
+            if (_num_revisions % _sweep_every == 0) {
+                perform_sweep();
+            }
+        }
+        else if constexpr (model_mode == None or Media) {
+            perform_user_revision<Mode::None>(2 * _num_revisions);
+        }
+
+        perform_media_revisions(*_model_rng);
 
-        if constexpr (model_mode == None or Media) {
-            revision::user_revision<Mode::None> (_nw_u,
-                                     _weighting,
-                                     _rewiring,
-                                     _rewiring_count,
-                                     _uniform_distr_prob_val,
-                                     _radicalisation_parameter,
-                                     *this->_rng);
+        //Perform user ageing once a year (= life_cycle revisions)
+        if (not _synchronous and (model_mode == Ageing or Ageing_and_Media)) {
+            perform_user_revision<Mode::Ageing>(2 * _num_revisions + 1);
         }
 
-        if constexpr (model_mode == Media or Ageing_and_Media) {
-            revision::information_revision (_nw_u,
-                                            _nw_m,
-                                            _uniform_distr_prob_val,
-                                            _radicalisation_parameter,
-                                            *this->_rng);
-
-            if (this->get_time()%_media_time_constant==0) {
-                      revision::media_revision(_nw_m, *this->_rng);
+        perform_ageing(*_model_rng);
+    }
+
+    /** @brief Perform a user revision
+     *  @detail The user is drawn uniformly at random; with the kinetic
+     *  scheduler or the active set, only the user revisions that can change
+     *  the state are performed, in the slots drawn for them.
+     */
+    template<Mode mode>
+    void perform_user_revision (const std::uint64_t slot) {
+        const profiling::Timer timer(_profile,
+                                     profiling::Phase::user_revision);
+        if (_scheduling == scheduling::Scheduler::uniform) {
+            revision::user_revision<mode>(_nw_u,
+                                          _weighting,
+                                          _rewiring,
+                                          _rewiring_count,
+                                          _uniform_distr_prob_val,
+                                          _radicalisation_parameter,
+                                          *_model_rng,
+                                          _nb_sampler,
+                                          _rewiring_scratch,
+                                          _edge_log.get());
+        }
+        else if (_scheduling == scheduling::Scheduler::kinetic) {
+            if (const auto v = _scheduler.draw(slot, *_model_rng)) {
+                revise_user<mode>(*v);
             }
         }
+        else if (const auto v = _active.draw(slot, *_model_rng)) {
+            const double opinion = _nw_u[*v].opinion;
+            revise_user<mode>(*v);
+            _active.touch(*v, _nw_u, opinion);
+        }
+    }
 
-        //Perform user ageing once a year (= life_cycle numerical steps)
-        if (model_mode == Ageing or Ageing_and_Media) {
+    /// Update all users synchronously (see synchronous.hh)
+    void perform_sweep () {
+        const profiling::Timer timer(_profile,
+                                     profiling::Phase::user_revision);
+        _sweep(_nw_u, _radicalisation_parameter, _pool);
+    }
+
+    /// The revision of the user v drawn by a scheduler
+    template<Mode mode>
+    void revise_user (const vertex_u v) {
+        revision::revise_user<mode>(v,
+                                    _nw_u,
+                                    _weighting,
+                                    _rewiring,
+                                    _rewiring_count,
+                                    _uniform_distr_prob_val,
+                                    _radicalisation_parameter,
+                                    *_model_rng,
+                                    _nb_sampler,
+                                    _rewiring_scratch,
+                                    _edge_log.get());
+    }
 
-            revision::user_revision<Mode::Ageing> (_nw_u,
-                                         _weighting,
-                                         _rewiring,
-                                         _rewiring_count,
-                                         _uniform_distr_prob_val,
-                                         _radicalisation_parameter,
-                                         *this->_rng);
+    /** @brief Perform n revisions, revising their users concurrently
+     *  @detail The users of both user revisions of each revision are drawn
+     *  up front and revised on the thread pool (see
+     *  revision::parallel_user_revision); the information and media
+     *  revisions and the ageing then follow for each revision in turn.
+     *  All random numbers are drawn from streams derived from the seed and
+     *  the revision count (see streams.hh), so the result does not depend
+     *  on the number of threads.
+     */
+    void perform_parallel_revisions (const std::size_t n) {
+        const auto step = _num_revisions;
+
+        auto batch_rng = streams::stream(_seed, step, 0,
+                                         streams::Phase::batch);
+        _batch.clear();
+        for (std::size_t i=0; i<2*n; ++i) {
+            _batch.push_back(random_vertex(_nw_u, batch_rng));
+        }
+
+        {
+            const profiling::Timer timer(_profile,
+                                         profiling::Phase::user_revision);
+            revision::parallel_user_revision<model_mode>(
+                                                    _nw_u,
+                                                    _batch,
+                                                    _weighting,
+                                                    _rewiring,
+                                                    _rewiring_count,
+                                                    _uniform_distr_prob_val,
+                                                    _radicalisation_parameter,
+                                                    _seed,
+                                                    step,
+                                                    _nb_sampler,
+                                                    _colouring,
+                                                    _rewiring_scratch,
+                                                    _batch_scratch,
+                                                    _pool,
+                                                    _edge_log.get());
+        }
+
+        for (std::size_t i=0; i<n; ++i) {
+            auto revision_rng = streams::stream(_seed, _num_revisions, 0,
+                                                streams::Phase::revision);
+            perform_media_revisions(revision_rng);
+            perform_ageing(revision_rng);
+            ++_num_revisions;
+        }
+    }
 
-            if (this->get_time()%_life_cycle==1) {
+    /// The information revision, and the media revision on its own timescale
+    template<typename RNGType>
+    void perform_media_revisions (RNGType& rng) {
+        if constexpr (model_mode == Media or Ageing_and_Media) {
+            {
+                const profiling::Timer timer(_profile,
+                                profiling::Phase::information_revision);
+                const auto [v, opinion] = revision::information_revision(
+                                                _nw_u,
+                                                _nw_m,
+                                                _uniform_distr_prob_val,
+                                                _radicalisation_parameter,
+                                                rng,
+                                                _ads_tree);
+                if (_scheduling == scheduling::Scheduler::active) {
+                    _active.touch(v, _nw_u, opinion);
+                }
+            }
+
+            if (_num_revisions%_media_time_constant==0) {
+                      const profiling::Timer timer(_profile,
+                                        profiling::Phase::media_revision);
+                      revision::media_revision(_nw_m, rng, _ads_tree);
+            }
+        }
+    }
+
+    /// Age the users once per life cycle
+    template<typename RNGType>
+    void perform_ageing (RNGType& rng) {
+        if (model_mode == Ageing or Ageing_and_Media) {
+            if (_num_revisions%_life_cycle==1) {
+                const profiling::Timer timer(_profile,
+                                             profiling::Phase::ageing);
                 ageing::ageing (_replacement_rate,
                                 _num_media,
                                 _child_ages,
@@ -445,8 +1190,20 @@ public:
                                 _senior_ages,
                                 _nw_u,
                                 this->_log,
-                                *this->_rng,
-                                this->_cfg["susceptibility"]["users"]["custom"]);
+                                rng,
+                                _susceptibility_table,
+                                _edge_log.get());
+
+                // the edge surgery has changed the weights of many users,
+                // and the out-degrees of some, i.e. their rates
+                _nb_sampler.invalidate_all();
+                if (_scheduling == scheduling::Scheduler::kinetic) {
+                    _scheduler.update_all(_nw_u);
+                    _scheduler.reschedule(2 * _num_revisions + 2, rng);
+                }
+                else if (_scheduling == scheduling::Scheduler::active) {
+                    _active.update_all(_nw_u);
+                }
             }
         }
     }
@@ -459,80 +1216,377 @@ public:
      */
     void monitor ()
     {
-        // Supply some number -- for illustration -- directly by value
-        //this->_monitor.set_entry("some_value", 42);
+        // The number of users whose revisions are performed
+        if (_scheduling == scheduling::Scheduler::active) {
+            this->_monitor.set_entry("active_users", _active.size());
+        }
+
+        // The time spent in each phase and the counters up to now, and the
+        // revisions per second of step time since the previous call
+        if constexpr (profiling::enabled) {
+            using profiling::Phase;
+            using profiling::Counter;
+            const auto profile = _profile.summary();
+
+            for (std::size_t i=0; i<profiling::num_phases; ++i) {
+                this->_monitor.set_entry(
+                        std::string(profiling::phase_names[i]) + "_seconds",
+                        profile.seconds(Phase(i)));
+            }
+            for (std::size_t i=0; i<profiling::num_counters; ++i) {
+                this->_monitor.set_entry(profiling::counter_names[i],
+                                         profile.counts[i]);
+            }
+
+            const double seconds = profile.seconds(Phase::step)
+                                   - _monitored.seconds(Phase::step);
+            const auto revisions = profile.count(Counter::revisions)
+                                   - _monitored.count(Counter::revisions);
+            this->_monitor.set_entry("revisions_per_second",
+                            seconds > 0. ? double(revisions) / seconds : 0.);
+            _monitored = profile;
+        }
     }
 
 
     /// Write data
     void write_data ()
     {
+        // after the final write, the state does not change any more
+        if (_final_written) {
+            return;
+        }
+
+        // Only copy the data here; the writer writes it to the datasets
+        auto buf = _writer.acquire();
+        {
+            const profiling::Timer timer(_profile, profiling::Phase::snapshot);
+            snapshot(*buf);
+        }
+        _final_written = buf->final;
+        _writer.submit(std::move(buf));
+        ++_num_writes;
+
+        // a converged run is not continued
+        if (not _convergence.converged() and _checkpoint_every != 0
+            and this->get_time() != 0
+            and this->get_time() % _checkpoint_every == 0)
+        {
+            save_checkpoint();
+        }
+    }
+
+    /// Wait until all data passed to write_data is written
+    void flush() {
+        _writer.flush();
+    }
+
+    /// Whether the model continues from a checkpoint; its state at the time
+    /// of the checkpoint is already written, so it must not be run, but only
+    /// iterated (see OpDyn.cc)
+    bool restarted() const {
+        return not _restart_from.empty();
+    }
+
+private:
+    // Checkpoints .............................................................
+
+    /// The datasets that get a row at every write
+    std::vector<std::string> time_series() const {
+        std::vector<std::string> paths;
+        for (const auto& dset : {_dset_opinion_u, _dset_opinion_histogram,
+                                 _dset_opinion_variance, _dset_opinion_range,
+                                 _dset_localization, _dset_polarization,
+                                 _dset_number_of_peaks, _dset_tolerance_u,
+                                 _dset_susceptibility_u, _dset_age_u,
+                                 _dset_opinion_m, _dset_users, _dset_ads,
+                                 _dset_rel_bc, _dset_rel_bc_error,
+                                 _dset_num_opinion_clusters,
+                                 _dset_num_weighted_opinion_clusters,
+                                 _dset_max_opinion_change,
+                                 _dset_mean_opinion_change,
+                                 _dset_rewiring_rate})
+        {
+            if (dset) {
+                paths.push_back(dset->get_path());
+            }
+        }
+        return paths;
+    }
+
+    /// Write the full state to the checkpoint file, after all data up to
+    /// now is written and flushed to disk, so that the output file has at
+    /// least the rows the checkpoint records
+    void save_checkpoint () {
+        const profiling::Timer timer(_profile, profiling::Phase::checkpoint);
+        _writer.flush();
+        this->get_hdffile()->flush();
+        if (_edge_log) {
+            _edge_log->flush();
+        }
+
+        checkpoint::Writer out(_checkpoint_path);
+        checkpoint::Header header;
+        header.model_mode = std::uint32_t(model_mode);
+        header.network_backend = std::uint32_t(network_backend);
+        header.real_size = sizeof(Real);
+        header.time = this->get_time();
+        header.num_writes = _num_writes;
+        header.time_series = time_series();
+        checkpoint::write_header(out, header);
+
+        std::ostringstream rng_state;
+        rng_state << *_model_rng;
+        out.write(rng_state.str());
+        out.write(std::uint64_t(_seed));
+        out.write(std::uint64_t(_analysis_seed));
+        out.write(std::uint64_t(_num_revisions));
+        out.write(_rewiring_count);
+
+        checkpoint::save_network(out, _nw_u, [](auto& out, const auto& u){
+            out.write(u.opinion);
+            out.write(u.tolerance);
+            out.write(u.susceptibility);
+            out.write(u.weight_sum);
+            out.write(u.age);
+            out.write(u.used_media);
+        });
+        checkpoint::save_network(out, _nw_m, [](auto& out, const auto& m){
+            out.write(m);
+        });
+        _ads_tree.save(out);
+        _scheduler.save(out);
+        _active.save(out);
+        _convergence.save(out);
+        out.commit();
+
+        this->_log->info("Wrote the checkpoint at time {} to '{}'.",
+                         this->get_time(), _checkpoint_path);
+    }
 
-        /*
-        auto get_edges_u = std::make_tuple(
-            std::make_tuple("_sources",
-                [](auto& _nw_u, auto& ed){
-                    return boost::get(boost::vertex_index_t(),
-                                                 _nw_u,
-                                                 boost::source(ed, _nw_u));}
-            ),
-            std::make_tuple("_targets",
-                [](auto& _nw_u, auto& ed){
-                                      boost::get(boost::vertex_index_t(),
-                                                 _nw_u,
-                                                 boost::target(ed, _nw_u));}
-            )
-        );
-
-        DataIO::save_graph_properties<Network_u::edge_descriptor>(_nw_u,
-                        _grp_nw_u, std::to_string(get_time()), get_edges_u);
-        */
-
-        // Get iterators
-        auto [v, v_end] = boost::vertices(_nw_u);
+    /// Continue from the state of a checkpoint
+    void restore (const std::string& path) {
+        checkpoint::Reader in(path);
+        const auto header = checkpoint::read_header(in);
+        if (header.model_mode != std::uint32_t(model_mode)
+            or header.network_backend != std::uint32_t(network_backend)
+            or header.real_size != sizeof(Real))
+        {
+            throw std::invalid_argument("The checkpoint '" + path + "' is of "
+                                        "a different model mode, network "
+                                        "backend or precision!");
+        }
+        this->_time = header.time;
+        _num_writes = header.num_writes;
+
+        std::istringstream rng_state(in.read<std::string>());
+        rng_state >> *_model_rng;
+        _seed = in.read<std::uint64_t>();
+        _analysis_seed = in.read<std::uint64_t>();
+        _num_revisions = in.read<std::uint64_t>();
+        in.read(_rewiring_count);
+
+        auto nw_u = checkpoint::load_network<NWType_u>(in,
+            [](auto& in, auto&& u){
+                in.read(u.opinion);
+                in.read(u.tolerance);
+                in.read(u.susceptibility);
+                in.read(u.weight_sum);
+                in.read(u.age);
+                in.read(u.used_media);
+            });
+        auto nw_m = checkpoint::load_network<Network_m>(in,
+            [](auto& in, auto& m){
+                in.read(m);
+            });
+        if (num_vertices(nw_u) != num_vertices(_nw_u)
+            or num_edges(nw_u) != num_edges(_nw_u)
+            or num_vertices(nw_m) != num_vertices(_nw_m))
+        {
+            throw std::invalid_argument("The networks of the checkpoint '"
+                                        + path + "' do not match the "
+                                        "configuration!");
+        }
+        _nw_u = std::move(nw_u);
+        _nw_m = std::move(nw_m);
+        _ads_tree.load(in);
+        _scheduler.load(in);
+        _active.load(in);
+        _convergence.load(in);
+        in.finish();
+
+        // the neighbour weights are cached anew
+        _nb_sampler.invalidate_all();
+
+        if (_edge_log) {
+            _edge_log->begin_step(this->get_time());
+            _edge_log->keyframe(_nw_u);
+        }
+
+        this->_log->info("Restarted from the checkpoint '{}' at time {}.",
+                         path, this->get_time());
+    }
+
+    // Output ..................................................................
+
+    /// Copy a property of all users into out: the member of each vertex
+    /// bundle, or the whole column of the flat backend
+    template<typename T, typename Field, typename Column>
+    void copy_users(std::vector<T>& out, Field field, Column column) const {
+        if constexpr (network_backend == NetworkBackend::flat) {
+            const auto& values = _nw_u.vertex_store().*column;
+            out.assign(values.begin(), values.end());
+        }
+        else {
+            out.clear();
+            for (auto [v, v_end] = vertices(_nw_u); v!=v_end; ++v) {
+                out.push_back(_nw_u[*v].*field);
+            }
+        }
+    }
+
+    /// Copy the data of the current state to be written into the buffer
+    void snapshot(WriteBuffer& buf) {
         auto [w, w_end] = boost::vertices(_nw_m);
-        auto [e, e_end] = boost::edges(_nw_u);
+        auto [e, e_end] = edges(_nw_u);
+
+        using Users = BasicUser<Real>;
+        using UserColumns = BasicUserColumns<Real>;
+
+        buf.opinion_u.clear();
+        if (_write_opinion_u or _observables) {
+            copy_users(buf.opinion_u, &Users::opinion, &UserColumns::opinion);
+        }
+
+        copy_users(buf.tolerance_u, &Users::tolerance,
+                   &UserColumns::tolerance);
+        copy_users(buf.susceptibility_u, &Users::susceptibility,
+                   &UserColumns::susceptibility);
+
+        buf.age_u.clear();
+        if constexpr (model_mode == Ageing or Ageing_and_Media){
+            copy_users(buf.age_u, &Users::age, &UserColumns::age);
+        }
+
+        buf.opinion_m.clear();
+        buf.user_count.clear();
+        buf.ads.clear();
+        if constexpr (model_mode == Media or Ageing_and_Media) {
+            for (auto it = w; it != w_end; ++it) {
+                buf.opinion_m.push_back(_nw_m[*it].opinion);
+                buf.user_count.push_back((int)_nw_m[*it].users);
+            }
+            revision::normalize_ads(_nw_m, buf.ads);
+        }
+
+        buf.indicators = _convergence.indicators();
+        buf.convergence_time = _convergence.convergence_time();
+        buf.profile = _profile.summary();
+
+        // final edges of user network, also written after convergence
+        buf.final = (_convergence.converged()
+                     or this->get_time() + this->get_write_every()
+                        > this->get_time_max());
+        buf.sources.clear();
+        buf.targets.clear();
+        if (buf.final) {
+            this->_log->debug("Writing {} edges ....", num_edges(_nw_u));
+            for (auto it = e; it != e_end; ++it) {
+                buf.sources.push_back(get(boost::vertex_index_t(), _nw_u,
+                                          source(*it, _nw_u)));
+                buf.targets.push_back(get(boost::vertex_index_t(), _nw_u,
+                                          target(*it, _nw_u)));
+            }
+        }
+
+        // relative betweenness centrality
+        if (_betweenness) {
+            auto rng = streams::stream(_analysis_seed, _num_revisions, 0,
+                                       streams::Phase::analysis);
+            auto rel_bc = Graph_Analysis::relative_betweenness_centrality(
+                                    _nw_u, _pool, _betweenness_samples, rng);
+            buf.rel_bc = std::move(rel_bc.centrality);
+            buf.rel_bc_error = std::move(rel_bc.error);
+        }
+
+        // number of opinion clusters, using the tolerance of the users
+        buf.num_opinion_clusters = Graph_Analysis::num_opinion_clusters(_nw_u);
+        buf.num_weighted_opinion_clusters =
+                        Graph_Analysis::num_weighted_opinion_clusters(_nw_u);
+    }
+
+    /// Write a snapshot to the datasets
+    void write_buffer(const WriteBuffer& buf) {
+        std::unique_lock<std::mutex> lock;
+        if (_write_mutex) {
+            lock = std::unique_lock<std::mutex>(*_write_mutex);
+        }
+        const profiling::Timer timer(_profile, profiling::Phase::write);
+
+        auto as_is = [](auto x) { return x; };
 
         // opinion_u
-        _dset_opinion_u->write( v, v_end,
-                                [this](auto vd) {
-                                return (float)_nw_u[vd].opinion;
-                                });
+        if (_write_opinion_u) {
+            output::write_unit_interval(*_dset_opinion_u, _out_opinion_u,
+                                        buf.opinion_u.begin(),
+                                        buf.opinion_u.end(), as_is);
+        }
+
+        // reductions of the opinion distribution
+        if (_observables) {
+            const auto first = buf.opinion_u.begin();
+            const auto last = buf.opinion_u.end();
+            const auto m = observables::moments(first, last, as_is);
+            const auto hist = observables::histogram(first, last, as_is,
+                                                     _num_bins);
+
+            _dset_opinion_histogram->write(hist.begin(), hist.end(), as_is);
+            _dset_opinion_variance->write(m.variance);
+            _dset_opinion_range->write(m.range());
+            _dset_localization->write(observables::localization(hist));
+            _dset_polarization->write(m.polarization());
+            _dset_number_of_peaks->write(
+                    observables::number_of_peaks(hist, _peak_prominence,
+                                                 _peak_distance));
+        }
 
+        // convergence indicators of the last sweep
+        if (_detect_convergence) {
+            _dset_max_opinion_change->write(buf.indicators.max_opinion_change);
+            _dset_mean_opinion_change->write(
+                                        buf.indicators.mean_opinion_change);
+            _dset_rewiring_rate->write(buf.indicators.rewiring_rate);
+        }
 
         //tolerance
-        _dset_tolerance_u->write(v, v_end,
-                                      [this](auto vd) {
-                                          return (float)_nw_u[vd].tolerance;
-                                      });
+        output::write_unit_interval(*_dset_tolerance_u, _out_tolerance_u,
+                                    buf.tolerance_u.begin(),
+                                    buf.tolerance_u.end(), as_is);
 
         //susceptibility
-        _dset_susceptibility_u->write(v, v_end,
-                                      [this](auto vd) {
-                                          return (float)_nw_u[vd].susceptibility;
-                                      });
-
+        output::write_unit_interval(*_dset_susceptibility_u,
+                                    _out_susceptibility_u,
+                                    buf.susceptibility_u.begin(),
+                                    buf.susceptibility_u.end(), as_is);
 
         if constexpr (model_mode == Ageing or Ageing_and_Media){
             //user age
-            _dset_age_u->write(v, v_end,
-                                          [this](auto vd) {
-                                              return (unsigned int)_nw_u[vd].age;
-                                      });
+            _dset_age_u->write(buf.age_u.begin(), buf.age_u.end(), as_is);
         }
 
         if constexpr (model_mode == Media or Ageing_and_Media) {
             // opinion_m
-            _dset_opinion_m->write( w, w_end,
-                                     [this](auto vd){
-                                     return (float)_nw_m[vd].opinion;
-                                     });
+            output::write_unit_interval(*_dset_opinion_m, _out_opinion_m,
+                                        buf.opinion_m.begin(),
+                                        buf.opinion_m.end(), as_is);
 
             // user numbers
-            _dset_users->write( w, w_end,
-                                     [this](auto vd) -> int {
-                                     return (int)_nw_m[vd].users;
-                                     });
+            _dset_users->write(buf.user_count.begin(), buf.user_count.end(),
+                               as_is);
+
+            // ad fractions
+            _dset_ads->write(buf.ads.begin(), buf.ads.end(),
+                             [](double x) { return (float)x; });
         }
 
         // average neighbored opinion
@@ -555,29 +1609,22 @@ public:
         //     });
 
         // final edges of user network
-
-        this->_log->debug("Writing {} edges ....", num_edges(_nw_u));
-
-        if (this->get_time() + this->get_write_every() > this->get_time_max()) {
-            _dset_edges_u_final->write(e, e_end,
-                [&](auto ed){
-                    return boost::get(boost::vertex_index_t(), _nw_u,
-                                      boost::source(ed, _nw_u));
-                }
-            );
-
-            _dset_edges_u_final->write(e, e_end,
-                [&](auto ed){
-                    return boost::get(boost::vertex_index_t(), _nw_u,
-                                      boost::target(ed, _nw_u));
-                }
-            );
+        if (buf.final) {
+            _dset_edges_u_final->write(buf.sources.begin(), buf.sources.end(),
+                                       as_is);
+            _dset_edges_u_final->write(buf.targets.begin(), buf.targets.end(),
+                                       as_is);
+            if (_detect_convergence) {
+                _dset_convergence_time->write(buf.convergence_time);
+            }
+            if constexpr (profiling::enabled) {
+                write_profile(buf.profile);
+            }
 
             this->_log->debug("All datasets have been written!");
 
             // std::vector<std::vector<size_t>> oc =
-            //                 Graph_Analysis::opinion_clusters( _nw_u,
-            //                                                  _tolerance_u);
+            //                 Graph_Analysis::opinion_clusters(_nw_u);
 
             // _dset_final_opinion_clusters =
             //             _grp_nw_u->open_dataset("final_clusters", {oc.size()});
@@ -587,23 +1634,6 @@ public:
             //                     return (float)c.size();
             //                     });
 
-            /*auto oc = Graph_Analysis::opinion_clusters( _nw_u,
-                                                        _tolerance_u);
-            _dset_num_opinion_clusters->write(oc.size());
-
-            auto woc = Graph_Analysis::weighted_opinion_clusters(
-                                                        _nw_u,
-                                                        _tolerance_u);
-            _dset_num_weighted_opinion_clusters->write(woc.size()); */ //this graph analysis uses old tolerance_u value, need to look at this in detail some time!!!! 24/10/19
-
-            // auto rel_bc = Graph_Analysis::relative_betweenness_centrality(
-            //                                                             _nw_u);
-
-            // _dset_rel_bc->write(v, v_end,
-            //                     [&](auto vd) -> double {
-            //                     return rel_bc.at(vd);
-            //                     });
-
             // _dset_weights->write(   e, e_end,
             //                         [this](auto ed) -> double {
             //                         return (float)_nw_u[ed].attr;
@@ -617,12 +1647,6 @@ public:
         //                         return (float)_nw_u[ed].attr;
         //                         });
 
-        // ads
-        //_dset_ads->write(  w, w_end,
-        //                    [this](auto vd) -> double {
-        //                    return (float)_nw_m[vd].ads;
-        //                    });
-
         // rewiring count
         // _dset_rewiring_count->write(_rewiring_count);
 
@@ -631,18 +1655,45 @@ public:
         //                        return in_degree(vd, _nw_u);
         //                        });
 
-        // auto oc = Graph_Analysis::opinion_clusters( _nw_u,
-        //                                             _tolerance_u);
-        // _dset_num_opinion_clusters->write(oc.size());
+        // relative betweenness centrality
+        if (_betweenness) {
+            _dset_rel_bc->write(buf.rel_bc.begin(), buf.rel_bc.end(), as_is);
+            if (_dset_rel_bc_error) {
+                _dset_rel_bc_error->write(buf.rel_bc_error.begin(),
+                                          buf.rel_bc_error.end(), as_is);
+            }
+        }
+
+        // number of opinion clusters
+        _dset_num_opinion_clusters->write(buf.num_opinion_clusters);
+        _dset_num_weighted_opinion_clusters->write(
+                                    buf.num_weighted_opinion_clusters);
+    }
 
-        // auto woc = Graph_Analysis::weighted_opinion_clusters(
-        //                                             _nw_u,
-        //                                             _tolerance_u);
-        // _dset_num_weighted_opinion_clusters->write(woc.size());
+    /// Write the totals of the profile, as of the final snapshot, to a
+    /// dataset per phase and counter in the profile group
+    void write_profile(const profiling::Summary& profile) {
+        auto grp = this->_hdfgrp->open_group("profile");
+        for (std::size_t i=0; i<profiling::num_phases; ++i) {
+            const std::string name = profiling::phase_names[i];
+            grp->open_dataset(name + "_seconds", {1})->write(
+                                    profile.seconds(profiling::Phase(i)));
+            grp->open_dataset(name + "_calls", {1})->write(profile.calls[i]);
+        }
+        for (std::size_t i=0; i<profiling::num_counters; ++i) {
+            grp->open_dataset(profiling::counter_names[i], {1})->write(
+                                                        profile.counts[i]);
+        }
     }
 
+public:
     // Getters and setters ....................................................
     // Add getters and setters here to interface with other model
+
+    /// The user network
+    const NWType_u& get_nw_u() const {
+        return _nw_u;
+    }
 };
 
 } //namespace
@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "events.hh"
+
+using namespace Utopia::Models::OpDyn;
+
+/*! Reads an edge event log written by the OpDyn model (see the 'edge_events'
+entry of the model configuration and events.hh).
+
+    OpDyn_edges <file>          lists the number of vertices, the last step
+                                and the steps of the keyframes
+    OpDyn_edges <file> <step>   prints the edges "source target" of the user
+                                network at the end of the step, one per line
+*/
+int main (int argc, char** argv)
+{
+    if (argc != 2 and argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <edge event log> [<step>]"
+                  << std::endl;
+        return 1;
+    }
+
+    try {
+        events::EdgeLogReader reader(argv[1]);
+
+        if (argc == 2) {
+            std::cout << "vertices: " << reader.num_vertices() << "\n"
+                      << "last step: " << reader.last_step() << "\n"
+                      << "keyframes:";
+            for (const auto step : reader.keyframe_steps()) {
+                std::cout << " " << step;
+            }
+            std::cout << std::endl;
+            return 0;
+        }
+
+        const std::uint64_t step = std::stoull(argv[2]);
+        if (step > reader.last_step()) {
+            std::cerr << "Warning: the log ends at step " << reader.last_step()
+                      << "." << std::endl;
+        }
+        for (const auto& [source, target] : reader.edges_at(step)) {
+            std::cout << source << " " << target << "\n";
+        }
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (...) {
+        std::cerr << "Exception occured!" << std::endl;
+        return 1;
+    }
+}
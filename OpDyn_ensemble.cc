@@ -0,0 +1,239 @@
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "OpDyn.hh"
+
+using namespace Utopia::Models::OpDyn;
+using Config = Utopia::DataIO::Config;
+
+/*! Runs an ensemble of OpDyn models in a single process, writing to a single
+file. The parameter space of the run configuration holds the usual OpDyn
+model configuration, and next to it an 'ensemble' entry:
+
+    ensemble:
+      num_threads: 0                # 0: one thread per hardware thread
+      share_initial_network: true   # all members start from the same network
+      members:
+        - seed: 1
+        - seed: 2
+          parameters:               # merged into the model configuration
+            radicalisation_parameter: 1.
+
+Each member has its own RNG, and writes into its own group 'member_<i>'. The
+model mode, the network backend and the precision are the same for all
+members. Members that
+override the 'nw_u' entry create their own initial network. A member only
+exists while its task runs, and only its steps run concurrently with those of
+other members.
+*/
+
+/// A deep copy of base, with the entries of update merged in recursively
+Config merged(const Config& base, const Config& update) {
+    Config cfg = YAML::Clone(base);
+    if (not update) {
+        return cfg;
+    }
+    for (const auto& kv : update) {
+        const auto key = kv.first.as<std::string>();
+        if (kv.second.IsMap() and cfg[key] and cfg[key].IsMap()) {
+            cfg[key] = merged(cfg[key], kv.second);
+        }
+        else {
+            cfg[key] = YAML::Clone(kv.second);
+        }
+    }
+    return cfg;
+}
+
+
+/// Construct, run and destroy each member in its own task on a thread pool
+template<Mode model_mode, NetworkBackend network_backend, typename Real>
+void run_ensemble(Utopia::PseudoParent& pp,
+                  const Config& model_cfg,
+                  const Config& ensemble_cfg)
+{
+    using Model = OpDyn<model_mode, network_backend, Real>;
+    using Network_u = typename Model::Network_u;
+    using RNG = typename Model::RNG;
+
+    const auto members = ensemble_cfg["members"];
+    if (not members or not members.IsSequence() or members.size() == 0) {
+        throw std::invalid_argument("The ensemble needs a non-empty list of "
+                                    "members!");
+    }
+
+    if (model_cfg["checkpoint"]
+        and not Utopia::get_as<std::string>("restart_from",
+                                            model_cfg["checkpoint"]).empty())
+    {
+        throw std::invalid_argument("An ensemble cannot be restarted from a "
+                                    "checkpoint!");
+    }
+
+    // The initial network is immutable input and can be shared
+    std::shared_ptr<const Network_u> initial_nw_u;
+    if (Utopia::get_as<bool>("share_initial_network", ensemble_cfg)) {
+        initial_nw_u = std::make_shared<const Network_u>(
+                Utopia::Graph::create_graph<Network_u>(model_cfg["nw_u"],
+                                                       *pp.get_rng()));
+    }
+
+    // Members may take very different times; idle threads take the next one
+    parallel::ThreadPool pool(
+                    Utopia::get_as<std::size_t>("num_threads", ensemble_cfg));
+
+    // The parent (its file, monitor and RNG) is not thread-safe: a task holds
+    // it while constructing, running and destroying its member, and the
+    // member releases it during its steps (see OpDyn::perform_step). The
+    // writes, which may happen on the writer threads, are serialised apart.
+    auto parent_mutex = std::make_shared<std::mutex>();
+    auto write_mutex = std::make_shared<std::mutex>();
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    pool.parallel_for_dynamic(members.size(), [&](std::size_t i, std::size_t){
+        try {
+            std::unique_lock<std::mutex> lock(*parent_mutex);
+
+            // only one member at a time is held in memory per thread
+            const auto member = members[i];
+            const auto seed = Utopia::get_as<unsigned int>("seed", member);
+            const auto cfg = merged(model_cfg, member["parameters"]);
+            const bool own_nw = member["parameters"]
+                                and member["parameters"]["nw_u"];
+
+            auto model = std::make_unique<Model>(
+                                "member_" + std::to_string(i),
+                                pp,
+                                cfg,
+                                std::make_shared<RNG>(seed),
+                                own_nw ? nullptr : initial_nw_u,
+                                write_mutex,
+                                parent_mutex);
+            model->get_hdfgrp()->add_attribute("seed", seed);
+            model->run();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (not error) {
+                error = std::current_exception();
+            }
+        }
+    });
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+
+/// Run the ensemble with the configured precision of the model state
+template<Mode model_mode, NetworkBackend network_backend>
+void run_with_precision(Utopia::PseudoParent& pp,
+                        const Config& model_cfg,
+                        const Config& ensemble_cfg)
+{
+    const auto precision = Utopia::get_as<std::string>("precision",
+                                                       model_cfg);
+    if (precision == "double") {
+        run_ensemble<model_mode, network_backend, double>(pp, model_cfg,
+                                                          ensemble_cfg);
+    }
+    else if (precision == "float") {
+        run_ensemble<model_mode, network_backend, float>(pp, model_cfg,
+                                                         ensemble_cfg);
+    }
+    else {
+        throw std::invalid_argument("Precision '" + precision + "' unknown "
+                                    "or not available for ensembles! Set "
+                                    "precision to either 'double' or "
+                                    "'float'");
+    }
+}
+
+/// Run the ensemble with the configured user network backend
+template<Mode model_mode>
+void run_with_backend(Utopia::PseudoParent& pp,
+                      const Config& model_cfg,
+                      const Config& ensemble_cfg)
+{
+    const auto backend = Utopia::get_as<std::string>("backend",
+                                                     model_cfg["nw_u"]);
+    if (backend == "adjacency_list") {
+        run_with_precision<model_mode, NetworkBackend::adjacency_list>(
+                                                pp, model_cfg, ensemble_cfg);
+    }
+    else if (backend == "flat") {
+        run_with_precision<model_mode, NetworkBackend::flat>(pp, model_cfg,
+                                                             ensemble_cfg);
+    }
+    else {
+        throw std::invalid_argument("Network backend '" + backend + "' "
+                                    "unknown! Set backend to either "
+                                    "'adjacency_list' or 'flat'");
+    }
+}
+
+
+int main (int argc, char** argv)
+{
+    try {
+        // Initialize the PseudoParent from config file path
+        Utopia::PseudoParent pp(argv[1]);
+
+        // The revision functions log to the logger of the OpDyn model
+        if (not spdlog::get("root.OpDyn")) {
+            spdlog::stdout_color_mt("root.OpDyn");
+        }
+
+        const auto model_cfg = pp.get_cfg()["OpDyn"];
+        const auto ensemble_cfg = pp.get_cfg()["ensemble"];
+        auto ageing = Utopia::get_as<std::string>("user_ageing", model_cfg);
+        auto media = Utopia::get_as<std::string>("media_status", model_cfg);
+
+        if (ageing=="on") {
+            if (media=="on") {
+                run_with_backend<Ageing_and_Media>(pp, model_cfg,
+                                                   ensemble_cfg);
+            }
+            else if (media=="off") {
+                run_with_backend<Ageing>(pp, model_cfg, ensemble_cfg);
+            }
+            else {
+                throw std::invalid_argument("Media mode {} unknown! Set media "
+                                            "to either 'on' or 'off'");
+            }
+        }
+
+        else if (ageing=="off") {
+            if (media=="on") {
+                run_with_backend<Media>(pp, model_cfg, ensemble_cfg);
+            }
+            else if (media=="off") {
+                run_with_backend<None>(pp, model_cfg, ensemble_cfg);
+            }
+            else {
+                throw std::invalid_argument("Media mode {} unknown! Set media "
+                                            "to either 'on' or 'off'");
+            }
+        }
+
+        else {
+            throw std::invalid_argument("Ageing mode {} unkown! Set ageing "
+                                        " to either 'on' or 'off'");
+        }
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (...) {
+        std::cerr << "Exception occured!" << std::endl;
+        return 1;
+    }
+}
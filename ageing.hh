@@ -10,6 +10,8 @@
 #include <boost/graph/graph_traits.hpp>
 #include <boost/assert.hpp>
 
+#include "events.hh"
+#include "profiling.hh"
 #include "utils.hh"
 #include "revision.hh"
 
@@ -18,7 +20,7 @@ namespace Utopia::Models::OpDyn::ageing {
 using pair_int = std::pair<int, int>;
 
 // USER AGEING .................................................................
-template <typename VertexDescType, typename NWType, typename RNGType, typename Config>
+template <typename VertexDescType, typename NWType, typename RNGType>
 void user_selection_and_ageing( std::vector<VertexDescType> &children,
                                 std::vector<VertexDescType> &parents,
                                 std::vector<VertexDescType> &peers,
@@ -28,7 +30,7 @@ void user_selection_and_ageing( std::vector<VertexDescType> &children,
                                 const double replacement_rate,
                                 NWType& nw,
                                 RNGType& rng,
-                                const Config& cfg) {
+                                const utils::SusceptibilityTable& susceptibility) {
 
 
     /*!
@@ -36,20 +38,26 @@ void user_selection_and_ageing( std::vector<VertexDescType> &children,
      of peers to rewire to. It concurrently increases the age of each user by 1.
     */
 
-    const int vertices_to_remove = (int)(boost::num_vertices(nw)*replacement_rate);
-    int peers_to_add = 0;
+    const int vertices_to_remove = (int)(num_vertices(nw)*replacement_rate);
+    std::size_t peers_to_add = 0;
 
     /*find old nodes to reinitialise as children, find an equal number of
     parents, and collect a sufficient number of young peers to reconnect to the
-    children */
-    apply_rule<IterateOver::vertices, Update::async, Shuffle::on>(
-    [&children, &parents, &peers, &child_ages, &parent_ages, &senior_ages, &vertices_to_remove, &peers_to_add, &cfg]
-    (const VertexDescType v, NWType& nw){
+    children. The vertices are visited in random order (as an asynchronous,
+    shuffled rule application would); this works for both network backends */
+    std::vector<VertexDescType> shuffled;
+    shuffled.reserve(num_vertices(nw));
+    for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+        shuffled.push_back(*v);
+    }
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    for (const VertexDescType v : shuffled) {
 
         /* increase the age of every user
         and adjust the susceptibility accordingly */
         ++nw[v].age;
-        nw[v].susceptibility=utils::susceptibility(cfg, nw[v].age);
+        nw[v].susceptibility=susceptibility(nw[v].age);
 
         if(peers.size() < peers_to_add
            or children.size() < vertices_to_remove
@@ -64,8 +72,11 @@ void user_selection_and_ageing( std::vector<VertexDescType> &children,
             if (senior_ages.first<=nw[v].age && children.size()<vertices_to_remove) {
                    children.push_back(v);
                    /* because we also have a parent with an in- and out-edge,
-                   we need two fewer peers per child than before */
-                   peers_to_add+=degree(v,nw)-2;
+                   we need two fewer peers per child than before, and none
+                   for a degree of two or less */
+                   if (degree(v,nw) > 2) {
+                       peers_to_add+=degree(v,nw)-2;
+                   }
                }
 
                //select parents
@@ -79,24 +90,32 @@ void user_selection_and_ageing( std::vector<VertexDescType> &children,
                    peers.push_back(v);
                }
         }
-    },
-    nw,
-    rng
-    );
+    }
 }
 
-/// Removes in- and out-edges to old vertex and normalise the previous peers' weights
+/// Removes in- and out-edges to old vertex and removes their weights from the
+/// weight sums of the previous peers
 template <typename VertexDescType, typename NWType>
-void remove_edges (VertexDescType v, NWType& nw) {
-    for (auto e : range<IterateOver::in_edges>(v, nw)) {
-        VertexDescType w = source(e, nw);
-        nw[e].attr = 0.;
+void remove_edges (VertexDescType v, NWType& nw,
+                   events::EdgeLog* edge_log = nullptr) {
+    for (auto [e, e_end] = in_edges(v, nw); e!=e_end; ++e) {
+        VertexDescType w = source(*e, nw);
+        revision::remove_weight(w, *e, nw);
 
         if (out_degree(w, nw) > 1) {
             revision::normalize_weights(w, nw);
         }
+        if (edge_log) {
+            edge_log->remove(w, v);
+        }
+    }
+    if (edge_log) {
+        for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+            edge_log->remove(v, target(*e, nw));
+        }
     }
     clear_vertex(v, nw);
+    nw[v].weight_sum = 0.;
 }
 
 
@@ -108,22 +127,27 @@ void add_edges( const VertexDescType child,
                 int iter_number,
                 NWType& nw,
                 LoggerType& log,
-                RNGType& rng) {
+                RNGType& rng,
+                events::EdgeLog* edge_log = nullptr) {
 
     /// Add edges to new peers in such a way that degree is preserved
+    /// (and record them in the edge log, if given)
 
     /*add child-parent edge and set weight to 1 if no other out-edges will be
     added, 0.5 else */
     double init_weight = 0.5;
     if (deg <= 2 or out_deg<=1) {init_weight = 1.;}
-    add_edge(child, parent, {init_weight}, nw);
+    add_edge(child, parent, revision::weight<NWType>(init_weight), nw);
+    if (edge_log) {edge_log->add(child, parent);}
+    revision::sum_weights(child, nw);
 
     //keep track of how many peers still need to be added
     if(out_deg>0) {--out_deg;}
     else {--in_deg;}
 
     if(in_deg>0 or out_deg>0) {
-      add_edge(parent, child, {0.1}, nw);
+      revision::add_relative_edge(parent, child, 0.1, nw);
+      if (edge_log) {edge_log->add(parent, child);}
       revision::normalize_weights(parent, nw);
     }
 
@@ -154,10 +178,12 @@ void add_edges( const VertexDescType child,
             peer=random_vertex(nw, rng);
             rewire_fail = true;
           }
-          add_edge(child, peer, {0.5/out_deg}, nw);
+          add_edge(child, peer, revision::weight<NWType>(0.5/out_deg), nw);
+          if (edge_log) {edge_log->add(child, peer);}
           revision::normalize_weights(peer, nw);
           peer_opinions += nw[peer].opinion;
     }
+    revision::sum_weights(child, nw);
 
     //in-edges
     for (int j=out_deg+iter_number; j<in_deg+out_deg+iter_number; ++j) {
@@ -166,7 +192,8 @@ void add_edges( const VertexDescType child,
             peer=random_vertex(nw, rng );
             rewire_fail = true;
           }
-          add_edge(peer, child, {0.5/in_deg}, nw);
+          revision::add_relative_edge(peer, child, 0.5/in_deg, nw);
+          if (edge_log) {edge_log->add(peer, child);}
           revision::normalize_weights(peer, nw);
           peer_opinions += nw[peer].opinion;
     }
@@ -184,13 +211,13 @@ count or decreasing replacement rate!");
     }
 }
 
-template <typename VertexDescType, typename RNGType, typename NWType, typename Config>
+template <typename VertexDescType, typename RNGType, typename NWType>
 void reinitialize( VertexDescType child,
                    VertexDescType parent,
                    int num_media,
                    NWType& nw,
                    RNGType& rng,
-                   Config& cfg){
+                   const utils::SusceptibilityTable& susceptibility){
 
     nw[child].age=1;
 
@@ -202,7 +229,7 @@ void reinitialize( VertexDescType child,
 
     /* Set the child susceptibility to the value for the susceptibility
     function at age 1 */
-    nw[child].susceptibility=utils::susceptibility(cfg, 1);
+    nw[child].susceptibility=susceptibility(1);
     nw[child].used_media=utils::get_rand_int(0, num_media, rng);
 }
 
@@ -228,12 +255,18 @@ void check_and_test( const VertexDescType child,
 
     if (deg!=0) {assert((out_deg_after>=1));}
 
+    // the weights may be of float (see update::sum_tolerance); they are not
+    // normalised, but must add up to the weight sum
+    using Real = decltype(nw[*out_edges(child, nw).first].attr);
+
     double weight_sum=0.;
     for(auto [e, e_end]=out_edges(child, nw); e!=e_end; ++e){
       weight_sum+=nw[*e].attr;
     }
-    if(fabs(weight_sum-1)>1e-12) {
-      log->info("Child weight sum is {}!", weight_sum);
+    if(fabs(weight_sum/nw[child].weight_sum-1)
+       >update::sum_tolerance<Real>(out_deg_after)) {
+      log->info("Child weight sum is {}, not {}!", weight_sum,
+                nw[child].weight_sum);
     }
 
     if(out_degree(parent, nw)!=0) {
@@ -241,14 +274,16 @@ void check_and_test( const VertexDescType child,
         for(auto [e, e_end]=out_edges(parent, nw); e!=e_end; ++e){
           weight_sum+=nw[*e].attr;
         }
-        if(fabs(weight_sum-1)>1e-12) {
-          log->info("Parent weight sum is {}!", weight_sum);
+        if(fabs(weight_sum/nw[parent].weight_sum-1)
+           >update::sum_tolerance<Real>(out_degree(parent, nw))) {
+          log->info("Parent weight sum is {}, not {}!", weight_sum,
+                    nw[parent].weight_sum);
         }
     }
 }
 //..............................................................................
 
-template <typename NWType, typename LoggerType, typename RNGType, typename Config>
+template <typename NWType, typename LoggerType, typename RNGType>
 void ageing ( const double replacement_rate,
               int num_media,
               pair_int child_ages,
@@ -257,7 +292,8 @@ void ageing ( const double replacement_rate,
               NWType& nw,
               LoggerType& log,
               RNGType& rng,
-              Config& cfg) {
+              const utils::SusceptibilityTable& susceptibility,
+              events::EdgeLog* edge_log = nullptr) {
 
       using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
 
@@ -274,13 +310,24 @@ void ageing ( const double replacement_rate,
                                 replacement_rate,
                                 nw,
                                 rng,
-                                cfg);
+                                susceptibility);
+
+      profiling::count(profiling::Counter::ageing_children, children.size());
+      profiling::count(profiling::Counter::ageing_parents, parents.size());
+      profiling::count(profiling::Counter::ageing_peers, peers.size());
 
       //check user ageing is possible in this step
       if(parents.size()==0) {
           log->info("There are no parent nodes: no user ageing possible in this step.");
           return;
       }
+      // peers are only rewired to children with a degree above two
+      if(peers.empty()
+         and std::any_of(children.begin(), children.end(),
+                         [&](const vertex v){ return degree(v, nw) > 2; })) {
+          log->info("There are no peer nodes: no user ageing possible in this step.");
+          return;
+      }
       if(children.size() > parents.size()){
           log->debug("Discrepancy between children and parent node numbers: \
 have {} more children than parents.", children.size()-parents.size());
@@ -306,15 +353,16 @@ have {} more children than parents.", children.size()-parents.size());
           const int in_deg = in_degree(child, nw);
           const int out_deg = out_degree(child, nw);
 
-          reinitialize(child, parent, num_media, nw, rng, cfg);
+          reinitialize(child, parent, num_media, nw, rng, susceptibility);
 
           /*if a child has no social connections, cannot rewire, since we must
           preserve the edge count*/
           if(deg==0) {continue; }
 
-          remove_edges(child, nw);
+          remove_edges(child, nw, edge_log);
 
-          add_edges(child, parent, peers, out_deg, in_deg, deg, at_peer, nw, log, rng);
+          add_edges(child, parent, peers, out_deg, in_deg, deg, at_peer, nw, log, rng,
+                    edge_log);
 
           check_and_test(child, parent, deg, in_deg, out_deg, nw);
 
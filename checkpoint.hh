@@ -0,0 +1,319 @@
+#ifndef UTOPIA_MODELS_OPDYN_CHECKPOINT
+#define UTOPIA_MODELS_OPDYN_CHECKPOINT
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <hdf5.h>
+
+namespace Utopia::Models::OpDyn::checkpoint {
+
+/*! Checkpoints hold the full state of a model in a native-endian binary file,
+such that a restarted run continues bit-identically (see OpDyn::restore). A
+checkpoint starts with a header, which is needed before the model is
+constructed, followed by the state written by the model:
+
+    magic, version      "OPDYNCK1", 7
+    Header              mode, backend, size of the real-valued state, time,
+                        number of writes, and the paths
+                        of the datasets that got a row at every write
+    state               the RNG, counters, networks (see save_network), the
+                        schedulers and the convergence indicators
+
+A checkpoint is written to <path>.tmp and only renamed to <path> once it is
+complete, so a run interrupted while writing keeps the previous checkpoint.
+*/
+
+/// "OPDYNCK1"; reads differently if the byte order does not match
+constexpr std::uint64_t magic = 0x4f5044594e434b31;
+constexpr std::uint64_t version = 7;
+
+
+// WRITER AND READER ...........................................................
+
+/// Writes values, vectors and strings to a checkpoint
+class Writer {
+    const std::string _path;
+    std::ofstream _out;
+
+public:
+    explicit Writer(const std::string& path)
+    :
+        _path(path),
+        _out(path + ".tmp", std::ios::binary | std::ios::trunc)
+    {
+        if (not _out) {
+            throw std::runtime_error("Could not open the checkpoint '" + path
+                                     + ".tmp'!");
+        }
+        write(magic);
+        write(version);
+    }
+
+    template<typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Only trivially copyable values can be written!");
+        _out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void write(const std::vector<T>& values) {
+        write(std::uint64_t(values.size()));
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            _out.write(reinterpret_cast<const char*>(values.data()),
+                       std::streamsize(values.size() * sizeof(T)));
+        }
+        else {
+            for (const auto& value : values) {
+                write(value);
+            }
+        }
+    }
+
+    void write(const std::string& str) {
+        write(std::uint64_t(str.size()));
+        _out.write(str.data(), std::streamsize(str.size()));
+    }
+
+    /// Complete the checkpoint, replacing the previous one
+    void commit() {
+        write(magic);
+        _out.close();
+        if (_out.fail()) {
+            throw std::runtime_error("Could not write the checkpoint '"
+                                     + _path + ".tmp'!");
+        }
+        if (std::rename((_path + ".tmp").c_str(), _path.c_str()) != 0) {
+            throw std::runtime_error("Could not rename the checkpoint to '"
+                                     + _path + "'!");
+        }
+    }
+};
+
+/// Reads what a Writer has written, throwing if the checkpoint ends early
+class Reader {
+    const std::string _path;
+    std::ifstream _in;
+
+public:
+    explicit Reader(const std::string& path)
+    :
+        _path(path),
+        _in(path, std::ios::binary)
+    {
+        if (not _in) {
+            throw std::runtime_error("Could not open the checkpoint '" + path
+                                     + "'!");
+        }
+        if (read<std::uint64_t>() != magic) {
+            throw std::runtime_error("'" + path + "' is not a checkpoint of "
+                                     "this byte order!");
+        }
+        if (read<std::uint64_t>() != version) {
+            throw std::runtime_error("The checkpoint '" + path + "' has an "
+                                     "unsupported version!");
+        }
+    }
+
+    template<typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Only trivially copyable values can be read!");
+        _in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        check();
+    }
+
+    template<typename T>
+    void read(std::vector<T>& values) {
+        values.resize(read<std::uint64_t>());
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            _in.read(reinterpret_cast<char*>(values.data()),
+                     std::streamsize(values.size() * sizeof(T)));
+            check();
+        }
+        else {
+            for (auto& value : values) {
+                read(value);
+            }
+        }
+    }
+
+    void read(std::string& str) {
+        str.resize(read<std::uint64_t>());
+        _in.read(str.data(), std::streamsize(str.size()));
+        check();
+    }
+
+    template<typename T>
+    T read() {
+        T value;
+        read(value);
+        return value;
+    }
+
+    /// Check that the whole checkpoint was read
+    void finish() {
+        if (read<std::uint64_t>() != magic or _in.peek() != EOF) {
+            throw std::runtime_error("The checkpoint '" + _path + "' is "
+                                     "corrupt!");
+        }
+    }
+
+private:
+    void check() {
+        if (not _in) {
+            throw std::runtime_error("The checkpoint '" + _path + "' is "
+                                     "truncated!");
+        }
+    }
+};
+
+
+// HEADER ......................................................................
+
+struct Header {
+    std::uint32_t model_mode = 0;
+    std::uint32_t network_backend = 0;
+    std::uint32_t real_size = sizeof(double);
+    std::uint64_t time = 0;
+    std::uint64_t num_writes = 0;
+
+    /// The datasets that got a row at each of the num_writes writes
+    std::vector<std::string> time_series;
+};
+
+inline void write_header(Writer& out, const Header& header) {
+    out.write(header.model_mode);
+    out.write(header.network_backend);
+    out.write(header.real_size);
+    out.write(header.time);
+    out.write(header.num_writes);
+    out.write(header.time_series);
+}
+
+inline Header read_header(Reader& in) {
+    Header header;
+    in.read(header.model_mode);
+    in.read(header.network_backend);
+    in.read(header.real_size);
+    in.read(header.time);
+    in.read(header.num_writes);
+    in.read(header.time_series);
+    return header;
+}
+
+/// The header of the checkpoint at path
+inline Header read_header(const std::string& path) {
+    Reader in(path);
+    return read_header(in);
+}
+
+
+// NETWORKS ....................................................................
+
+/// Write the vertices, with their properties written by save_vertex, and the
+/// edges with their properties, in the order of edges(nw)
+template<typename NWType, typename SaveVertex>
+void save_network(Writer& out, const NWType& nw, SaveVertex&& save_vertex) {
+    out.write(std::uint64_t(num_vertices(nw)));
+    for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+        save_vertex(out, nw[*v]);
+    }
+
+    out.write(std::uint64_t(num_edges(nw)));
+    for (auto [e, e_end] = edges(nw); e!=e_end; ++e) {
+        out.write(std::uint64_t(source(*e, nw)));
+        out.write(std::uint64_t(target(*e, nw)));
+        out.write(nw[*e]);
+    }
+}
+
+/// Read a network written by save_network. Since the edges are added in the
+/// order of edges(nw), they are iterated in the same order as before.
+template<typename NWType, typename LoadVertex>
+NWType load_network(Reader& in, LoadVertex&& load_vertex) {
+    NWType nw(in.read<std::uint64_t>());
+    for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+        load_vertex(in, nw[*v]);
+    }
+
+    const auto num_edges = in.read<std::uint64_t>();
+    for (std::uint64_t i=0; i!=num_edges; ++i) {
+        const auto u = in.read<std::uint64_t>();
+        const auto w = in.read<std::uint64_t>();
+        if (u >= num_vertices(nw) or w >= num_vertices(nw)) {
+            throw std::runtime_error("Invalid edge in the checkpoint!");
+        }
+        const auto [e, added] = add_edge(u, w, nw);
+        if (not added) {
+            throw std::runtime_error("Duplicate edge in the checkpoint!");
+        }
+        in.read(nw[e]);
+    }
+    return nw;
+}
+
+
+// OUTPUT ......................................................................
+
+/// Shrink the time series datasets of the header in the HDF5 file to the
+/// rows written up to the checkpoint, removing the rows a run wrote after
+/// it. Other datasets are left as they are. Throws if a dataset has fewer
+/// rows than the checkpoint records, as a restarted run would then append
+/// to misaligned time series.
+inline void truncate_datasets(const std::string& file_path,
+                              const Header& header)
+{
+    const hid_t file = H5Fopen(file_path.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    if (file < 0) {
+        throw std::runtime_error("Could not open the output file '"
+                                 + file_path + "' to restart!");
+    }
+
+    bool failed = false;
+    std::string short_path;
+    for (const auto& path : header.time_series) {
+        const hid_t dset = H5Dopen2(file, path.c_str(), H5P_DEFAULT);
+        if (dset < 0) {
+            failed = true;
+            break;
+        }
+        const hid_t space = H5Dget_space(dset);
+        std::vector<hsize_t> extent(H5Sget_simple_extent_ndims(space));
+        H5Sget_simple_extent_dims(space, extent.data(), nullptr);
+        H5Sclose(space);
+
+        if (not extent.empty() and extent[0] < header.num_writes) {
+            short_path = path;
+        }
+        else if (not extent.empty() and extent[0] > header.num_writes) {
+            extent[0] = header.num_writes;
+            failed = (H5Dset_extent(dset, extent.data()) < 0);
+        }
+        H5Dclose(dset);
+        if (failed or not short_path.empty()) {
+            break;
+        }
+    }
+    H5Fclose(file);
+
+    if (not short_path.empty()) {
+        throw std::runtime_error("The dataset '" + short_path + "' of '"
+                                 + file_path + "' has fewer rows than the "
+                                 "checkpoint records; cannot restart!");
+    }
+    if (failed) {
+        throw std::runtime_error("Could not truncate the datasets of '"
+                                 + file_path + "' to the checkpoint!");
+    }
+}
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_CHECKPOINT
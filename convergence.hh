@@ -0,0 +1,176 @@
+#ifndef UTOPIA_MODELS_OPDYN_CONVERGENCE
+#define UTOPIA_MODELS_OPDYN_CONVERGENCE
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace Utopia::Models::OpDyn::convergence {
+
+/*! Cheap running indicators of how much the users still change, and a
+quiescence criterion on them. The indicators are evaluated once per sweep,
+i.e. once at least as many revisions as there are users have been performed
+since the previous evaluation, by comparing the opinions with those of the
+previous evaluation. Between the evaluations, nothing is done.
+
+A run has converged once, for patience sweeps in a row, no opinion changed by
+more than max_opinion_change over the sweep and there were at most
+max_rewiring_rate rewirings per revision.
+*/
+
+/// The indicators of the last sweep; NaN before the first one
+struct Indicators {
+    double max_opinion_change = std::numeric_limits<double>::quiet_NaN();
+    double mean_opinion_change = std::numeric_limits<double>::quiet_NaN();
+
+    /// The rewirings per revision
+    double rewiring_rate = std::numeric_limits<double>::quiet_NaN();
+};
+
+class Monitor {
+    const double _max_opinion_change;
+    const double _max_rewiring_rate;
+    const std::size_t _patience;
+
+    // The state at the previous evaluation
+    std::vector<double> _opinions;
+    std::uint64_t _revisions;
+    std::uint64_t _rewirings;
+
+    Indicators _indicators;
+    std::uint64_t _quiet_sweeps;
+
+    /// The time at which the criterion was met, or -1
+    std::int64_t _convergence_time;
+
+public:
+    Monitor(const double max_opinion_change,
+            const double max_rewiring_rate,
+            const std::size_t patience)
+    :
+        _max_opinion_change(max_opinion_change),
+        _max_rewiring_rate(max_rewiring_rate),
+        _patience(patience),
+        _opinions(),
+        _revisions(0),
+        _rewirings(0),
+        _indicators(),
+        _quiet_sweeps(0),
+        _convergence_time(-1)
+    {
+        if (_patience == 0) {
+            throw std::invalid_argument("The convergence patience must be "
+                                        "positive!");
+        }
+    }
+
+    /// Start the first sweep from the current state of the network
+    template<typename NWType>
+    void reset(const NWType& nw,
+               const std::uint64_t revisions,
+               const std::uint64_t rewirings)
+    {
+        _opinions.clear();
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+            _opinions.push_back(nw[*v].opinion);
+        }
+        _revisions = revisions;
+        _rewirings = rewirings;
+    }
+
+    /// Evaluate the indicators if a sweep has passed since the previous
+    /// evaluation. Returns whether the run has just converged, at the time
+    /// given.
+    template<typename NWType>
+    bool update(const NWType& nw,
+                const std::uint64_t time,
+                const std::uint64_t revisions,
+                const std::uint64_t rewirings)
+    {
+        if (converged() or revisions - _revisions < _opinions.size()
+            or revisions == _revisions)
+        {
+            return false;
+        }
+
+        double max_change = 0.;
+        double sum_change = 0.;
+        auto prev = _opinions.begin();
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v, ++prev) {
+            const double change = std::fabs(nw[*v].opinion - *prev);
+            max_change = std::max(max_change, change);
+            sum_change += change;
+            *prev = nw[*v].opinion;
+        }
+
+        _indicators.max_opinion_change = max_change;
+        _indicators.mean_opinion_change = _opinions.empty() ? 0.
+                                    : sum_change / double(_opinions.size());
+        _indicators.rewiring_rate = double(rewirings - _rewirings)
+                                    / double(revisions - _revisions);
+        _revisions = revisions;
+        _rewirings = rewirings;
+
+        if (_indicators.max_opinion_change <= _max_opinion_change
+            and _indicators.rewiring_rate <= _max_rewiring_rate)
+        {
+            ++_quiet_sweeps;
+        }
+        else {
+            _quiet_sweeps = 0;
+        }
+
+        if (_quiet_sweeps >= _patience) {
+            _convergence_time = std::int64_t(time);
+            return true;
+        }
+        return false;
+    }
+
+    bool converged() const {
+        return _convergence_time >= 0;
+    }
+
+    /// The time at which the run converged, or -1 if it has not
+    std::int64_t convergence_time() const {
+        return _convergence_time;
+    }
+
+    const Indicators& indicators() const {
+        return _indicators;
+    }
+
+    /// The number of quiet sweeps in a row up to now
+    std::uint64_t quiet_sweeps() const {
+        return _quiet_sweeps;
+    }
+
+    /// Write the state to a checkpoint (see checkpoint.hh)
+    template<typename Writer>
+    void save(Writer& out) const {
+        out.write(_opinions);
+        out.write(_revisions);
+        out.write(_rewirings);
+        out.write(_indicators);
+        out.write(_quiet_sweeps);
+        out.write(_convergence_time);
+    }
+
+    /// Restore the state written by save
+    template<typename Reader>
+    void load(Reader& in) {
+        in.read(_opinions);
+        in.read(_revisions);
+        in.read(_rewirings);
+        in.read(_indicators);
+        in.read(_quiet_sweeps);
+        in.read(_convergence_time);
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_CONVERGENCE
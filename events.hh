@@ -0,0 +1,347 @@
+#ifndef UTOPIA_MODELS_OPDYN_EVENTS
+#define UTOPIA_MODELS_OPDYN_EVENTS
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Utopia::Models::OpDyn::events {
+
+/*! The changes of the user network topology, as an append-only binary stream
+of edge events, from which the network at any time step can be reconstructed
+without writing the full edge list at every write.
+
+The file is a sequence of native-endian 64 bit words: a header of two words,
+the magic number and the number of vertices, followed by records, each
+starting with a head word (type << 56 | step):
+
+    add, remove:  the head and one word (source | target << 32)
+    keyframe:     the head, the number of edges E, and E words as above,
+                  the full edge list at the end of the step
+
+An event stamped with step t happened while performing step t, i.e. between
+the states written at times t-1 and t. A keyframe stamped t holds the state
+at time t; the first one (step 0) holds the initial network.
+
+A run restarted from a checkpoint at time t appends a keyframe stamped t.
+It supersedes the records the interrupted run wrote after the checkpoint.
+*/
+
+/// "OPDYNEV1"; reads differently if the byte order does not match
+constexpr std::uint64_t magic = 0x4f5044594e455631;
+
+/// The type of a record, in the topmost byte of its head
+enum class Record : std::uint8_t {
+    add = 1,
+    remove = 2,
+    keyframe = 3
+};
+
+constexpr std::uint64_t max_step = (std::uint64_t(1) << 56) - 1;
+
+/// The head word of a record
+inline std::uint64_t head(const Record type, const std::uint64_t step) {
+    return (std::uint64_t(type) << 56) | step;
+}
+
+/// The edge (source, target) as a single word
+inline std::uint64_t pack(const std::uint64_t source,
+                          const std::uint64_t target)
+{
+    return source | (target << 32);
+}
+
+using Edge = std::pair<std::uint32_t, std::uint32_t>;
+
+inline Edge unpack(const std::uint64_t word) {
+    return {std::uint32_t(word), std::uint32_t(word >> 32)};
+}
+
+
+// WRITER ......................................................................
+
+/*! Appends the edge events of a network to a file. The events are collected
+in a buffer of buffer_size words, which is written when full, after each
+keyframe, and on destruction. If append is set, an existing log of a network
+with the same number of vertices is continued.
+*/
+class EdgeLog {
+    std::ofstream _out;
+    std::vector<std::uint64_t> _buffer;
+    const std::size_t _buffer_size;
+    std::uint64_t _step;
+
+public:
+    EdgeLog(const std::string& path,
+            const std::size_t num_vertices,
+            const bool append = false,
+            const std::size_t buffer_size = 1 << 16)
+    :
+        _out(),
+        _buffer(),
+        _buffer_size(std::max<std::size_t>(buffer_size, 2)),
+        _step(0)
+    {
+        if (num_vertices > (std::uint64_t(1) << 32)) {
+            throw std::invalid_argument("The edge event log can only store "
+                                        "networks of up to 2^32 vertices!");
+        }
+        if (append) {
+            std::ifstream in(path, std::ios::binary);
+            std::uint64_t header[2] = {0, 0};
+            in.read(reinterpret_cast<char*>(header), sizeof(header));
+            if (not in or header[0] != magic or header[1] != num_vertices) {
+                throw std::runtime_error("'" + path + "' is not an edge "
+                                         "event log of this network!");
+            }
+        }
+
+        _out.open(path, std::ios::binary
+                        | (append ? std::ios::app : std::ios::trunc));
+        if (not _out) {
+            throw std::runtime_error("Could not open the edge event log '"
+                                     + path + "'!");
+        }
+        _buffer.reserve(_buffer_size);
+        if (not append) {
+            _buffer.push_back(magic);
+            _buffer.push_back(num_vertices);
+        }
+    }
+
+    EdgeLog(const EdgeLog&) = delete;
+    EdgeLog& operator=(const EdgeLog&) = delete;
+
+    ~EdgeLog() {
+        try {
+            flush();
+        }
+        catch (std::exception& e) {
+            std::cerr << "Writing the edge event log failed: " << e.what()
+                      << std::endl;
+        }
+    }
+
+    /// Stamp the following events with this step
+    void begin_step(const std::uint64_t step) {
+        if (step > max_step) {
+            throw std::out_of_range("The step is too large for the edge "
+                                    "event log!");
+        }
+        _step = step;
+    }
+
+    /// The step the events are currently stamped with
+    std::uint64_t step() const {
+        return _step;
+    }
+
+    /// Record that the edge (source, target) was added
+    template<typename VertexDescType>
+    void add(const VertexDescType source, const VertexDescType target) {
+        record(Record::add, source, target);
+    }
+
+    /// Record that the edge (source, target) was removed
+    template<typename VertexDescType>
+    void remove(const VertexDescType source, const VertexDescType target) {
+        record(Record::remove, source, target);
+    }
+
+    /// Record all edges of the network, and write the buffer
+    template<typename NWType>
+    void keyframe(const NWType& nw) {
+        reserve(2);
+        _buffer.push_back(head(Record::keyframe, _step));
+        _buffer.push_back(num_edges(nw));
+        for (auto [e, e_end] = edges(nw); e!=e_end; ++e) {
+            reserve(1);
+            _buffer.push_back(pack(source(*e, nw), target(*e, nw)));
+        }
+        flush();
+    }
+
+    /// Write the buffered records to the file
+    void flush() {
+        if (_buffer.empty()) {
+            return;
+        }
+        _out.write(reinterpret_cast<const char*>(_buffer.data()),
+                   std::streamsize(_buffer.size() * sizeof(std::uint64_t)));
+        _out.flush();
+        _buffer.clear();
+        if (not _out) {
+            throw std::runtime_error("Could not write the edge event log!");
+        }
+    }
+
+private:
+    void record(const Record type,
+                const std::uint64_t source,
+                const std::uint64_t target)
+    {
+        reserve(2);
+        _buffer.push_back(head(type, _step));
+        _buffer.push_back(pack(source, target));
+    }
+
+    /// Make room for n more words, writing the buffer if needed
+    void reserve(const std::size_t n) {
+        if (_buffer.size() + n > _buffer_size) {
+            flush();
+        }
+    }
+};
+
+
+// READER ......................................................................
+
+/*! Reconstructs the network at any step from an edge event log: starting
+from the last keyframe at or before the step, the events up to and including
+the step are applied. The keyframes are indexed on construction.
+*/
+class EdgeLogReader {
+    std::ifstream _in;
+    std::uint64_t _num_vertices;
+    std::uint64_t _last_step;
+
+    /// The steps of the keyframes and the positions of their heads
+    std::vector<std::pair<std::uint64_t, std::streamoff>> _keyframes;
+
+public:
+    explicit EdgeLogReader(const std::string& path)
+    :
+        _in(path, std::ios::binary),
+        _num_vertices(0),
+        _last_step(0),
+        _keyframes()
+    {
+        if (not _in) {
+            throw std::runtime_error("Could not open the edge event log '"
+                                     + path + "'!");
+        }
+        std::uint64_t word;
+        if (not read(word) or word != magic) {
+            throw std::runtime_error("'" + path + "' is not an edge event log "
+                                     "of this byte order!");
+        }
+        if (not read(_num_vertices)) {
+            throw std::runtime_error("The edge event log is truncated!");
+        }
+
+        const std::streamoff record_size = sizeof(std::uint64_t);
+        std::streamoff pos = 2 * record_size;
+        while (read(word)) {
+            const auto type = Record(word >> 56);
+            const std::uint64_t step = word & max_step;
+            _last_step = std::max(_last_step, step);
+
+            std::uint64_t skip = 1;
+            if (type == Record::keyframe) {
+                // a keyframe not after the previous ones is that of a
+                // restart, and supersedes them
+                while (not _keyframes.empty()
+                       and _keyframes.back().first >= step)
+                {
+                    _keyframes.pop_back();
+                }
+                _keyframes.emplace_back(step, pos);
+                std::uint64_t num_edges;
+                if (not read(num_edges)) {
+                    throw std::runtime_error("The edge event log is "
+                                             "truncated!");
+                }
+                skip = 1 + num_edges;
+            }
+            else if (type != Record::add and type != Record::remove) {
+                throw std::runtime_error("The edge event log is corrupt!");
+            }
+            pos += std::streamoff(1 + skip) * record_size;
+            _in.seekg(pos);
+        }
+        _in.clear();
+
+        if (_keyframes.empty() or _keyframes.front().first != 0) {
+            throw std::runtime_error("The edge event log does not start with "
+                                     "a keyframe!");
+        }
+    }
+
+    std::uint64_t num_vertices() const {
+        return _num_vertices;
+    }
+
+    /// The step of the last record
+    std::uint64_t last_step() const {
+        return _last_step;
+    }
+
+    /// The steps at which keyframes were written
+    std::vector<std::uint64_t> keyframe_steps() const {
+        std::vector<std::uint64_t> steps;
+        for (const auto& kf : _keyframes) {
+            steps.push_back(kf.first);
+        }
+        return steps;
+    }
+
+    /// The edges of the network at the end of the step, sorted
+    std::vector<Edge> edges_at(const std::uint64_t step) {
+        auto kf = std::upper_bound(_keyframes.begin(), _keyframes.end(),
+                                   std::make_pair(step, std::streamoff(-1)),
+                                   [](const auto& a, const auto& b){
+                                       return a.first < b.first;
+                                   });
+        --kf;
+
+        _in.clear();
+        _in.seekg(kf->second);
+        std::uint64_t word, num_edges;
+        read(word);
+        read(num_edges);
+
+        std::set<Edge> edge_set;
+        for (std::uint64_t i=0; i!=num_edges; ++i) {
+            read(word);
+            edge_set.insert(unpack(word));
+        }
+
+        while (read(word)) {
+            const auto type = Record(word >> 56);
+            if ((word & max_step) > step) {
+                break;
+            }
+            if (type == Record::keyframe) {
+                read(num_edges);
+                _in.seekg(std::streamoff(num_edges * sizeof(std::uint64_t)),
+                          std::ios::cur);
+                continue;
+            }
+            read(word);
+            if (type == Record::add) {
+                edge_set.insert(unpack(word));
+            }
+            else {
+                edge_set.erase(unpack(word));
+            }
+        }
+        _in.clear();
+
+        return {edge_set.begin(), edge_set.end()};
+    }
+
+private:
+    bool read(std::uint64_t& word) {
+        return bool(_in.read(reinterpret_cast<char*>(&word), sizeof(word)));
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_EVENTS
@@ -0,0 +1,524 @@
+#ifndef UTOPIA_MODELS_OPDYN_FLAT_NETWORK
+#define UTOPIA_MODELS_OPDYN_FLAT_NETWORK
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/properties.hpp>
+#include <boost/graph/random.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+namespace Utopia::Models::OpDyn::flat {
+
+/*! This header provides an alternative to the boost::adjacency_list used for
+the user network. Each vertex owns a contiguous block of 32-bit targets, and
+the edge properties are stored in a parallel array at the same offsets. The
+blocks have some spare capacity so that the rewiring in update_weights and the
+edge surgery in the ageing step rarely need to move them; a block that
+overflows is moved to the end of the arrays, and the arrays are compacted once
+the abandoned blocks make up half of them.
+
+The out-blocks are kept sorted by target (and the in-blocks by source), which
+is the order of the boost::setS edge lists. Iteration and thus consumption of
+random numbers is identical for both backends.
+
+The free functions below mirror the boost graph interface used by the model,
+and are found via argument-dependent lookup. Edge descriptors are invalidated
+by any structural change to their source or target vertex.
+*/
+
+using index_t = std::uint32_t;
+
+/// Empty payload of the in-blocks
+struct NoPayload {};
+
+// ADJACENCY BLOCKS ............................................................
+
+/// Per-vertex blocks of sorted 32-bit neighbour ids with an optional payload
+template<typename Payload>
+struct AdjacencyBlocks {
+    static constexpr bool has_payload = not std::is_same_v<Payload, NoPayload>;
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    std::vector<std::size_t> begin;
+    std::vector<index_t> size;
+    std::vector<index_t> cap;
+    std::vector<index_t> ids;
+    std::vector<Payload> payload;
+
+    // number of slots in abandoned blocks
+    std::size_t dead = 0;
+
+    // spare slots given to every block on (re)allocation
+    static index_t slack(index_t n) {
+        return std::max<index_t>(4, n / 4);
+    }
+
+    void init(const std::vector<index_t>& degrees) {
+        const auto n = degrees.size();
+        begin.assign(n, 0);
+        size.assign(n, 0);
+        cap.assign(n, 0);
+
+        std::size_t total = 0;
+        for (std::size_t u=0; u!=n; ++u) {
+            begin[u] = total;
+            cap[u] = degrees[u] + slack(degrees[u]);
+            total += cap[u];
+        }
+        ids.assign(total, 0);
+        if constexpr (has_payload) {
+            payload.assign(total, Payload{});
+        }
+        dead = 0;
+    }
+
+    const index_t* first(index_t u) const { return ids.data() + begin[u]; }
+    const index_t* last(index_t u) const { return first(u) + size[u]; }
+
+    // binary search for the slot holding id, npos if there is none
+    std::size_t find(index_t u, index_t id) const {
+        auto it = std::lower_bound(first(u), last(u), id);
+        if (it != last(u) and *it == id) {
+            return it - ids.data();
+        }
+        return npos;
+    }
+
+    // insert id at its sorted position and return the slot
+    std::size_t insert(index_t u, index_t id, const Payload& p) {
+        if (size[u] == cap[u]) {
+            grow(u);
+        }
+        const std::size_t b = begin[u];
+        const std::size_t pos = std::lower_bound(first(u), last(u), id)
+                                - ids.data();
+        const std::size_t end = b + size[u];
+
+        std::move_backward(ids.begin() + pos, ids.begin() + end,
+                           ids.begin() + end + 1);
+        ids[pos] = id;
+        if constexpr (has_payload) {
+            std::move_backward(payload.begin() + pos, payload.begin() + end,
+                               payload.begin() + end + 1);
+            payload[pos] = p;
+        }
+        ++size[u];
+        return pos;
+    }
+
+    void erase(index_t u, index_t id) {
+        const std::size_t pos = find(u, id);
+        if (pos == npos) {
+            return;
+        }
+        const std::size_t end = begin[u] + size[u];
+        std::move(ids.begin() + pos + 1, ids.begin() + end, ids.begin() + pos);
+        if constexpr (has_payload) {
+            std::move(payload.begin() + pos + 1, payload.begin() + end,
+                      payload.begin() + pos);
+        }
+        --size[u];
+    }
+
+    // move the block of u to the end of the arrays with doubled capacity
+    void grow(index_t u) {
+        if (dead > ids.size() / 2) {
+            compact();
+        }
+        const index_t new_cap = std::max<index_t>(2 * cap[u], 4);
+        const std::size_t new_begin = ids.size();
+        ids.resize(new_begin + new_cap);
+        std::copy_n(ids.begin() + begin[u], size[u], ids.begin() + new_begin);
+        if constexpr (has_payload) {
+            payload.resize(new_begin + new_cap);
+            std::copy_n(payload.begin() + begin[u], size[u],
+                        payload.begin() + new_begin);
+        }
+        dead += cap[u];
+        begin[u] = new_begin;
+        cap[u] = new_cap;
+    }
+
+    // repack all blocks, dropping the abandoned ones
+    void compact() {
+        std::vector<index_t> new_ids;
+        std::vector<Payload> new_payload;
+        std::size_t total = 0;
+        for (std::size_t u=0; u!=size.size(); ++u) {
+            total += size[u] + slack(size[u]);
+        }
+        new_ids.resize(total);
+        if constexpr (has_payload) {
+            new_payload.resize(total);
+        }
+
+        std::size_t b = 0;
+        for (std::size_t u=0; u!=size.size(); ++u) {
+            std::copy_n(ids.begin() + begin[u], size[u], new_ids.begin() + b);
+            if constexpr (has_payload) {
+                std::copy_n(payload.begin() + begin[u], size[u],
+                            new_payload.begin() + b);
+            }
+            begin[u] = b;
+            cap[u] = size[u] + slack(size[u]);
+            b += cap[u];
+        }
+        ids.swap(new_ids);
+        payload.swap(new_payload);
+        dead = 0;
+    }
+};
+
+
+// THE NETWORK .................................................................
+
+template<typename VertexStore, typename EdgeProperty>
+class FlatNetwork {
+public:
+    using vertex_descriptor = index_t;
+
+    struct edge_descriptor {
+        index_t src;
+        index_t tgt;
+        std::size_t slot;
+
+        bool operator==(const edge_descriptor& other) const {
+            return src == other.src and tgt == other.tgt;
+        }
+        bool operator!=(const edge_descriptor& other) const {
+            return not (*this == other);
+        }
+    };
+
+    // boost graph traits
+    using directed_category = boost::bidirectional_tag;
+    using edge_parallel_category = boost::disallow_parallel_edge_tag;
+    struct traversal_category:
+        public virtual boost::bidirectional_graph_tag,
+        public virtual boost::adjacency_graph_tag,
+        public virtual boost::vertex_list_graph_tag,
+        public virtual boost::edge_list_graph_tag {};
+    using vertices_size_type = std::size_t;
+    using edges_size_type = std::size_t;
+    using degree_size_type = std::size_t;
+
+    static vertex_descriptor null_vertex() {
+        return std::numeric_limits<vertex_descriptor>::max();
+    }
+
+private:
+    struct OutEdgeMaker {
+        const FlatNetwork* nw = nullptr;
+        index_t v = 0;
+        edge_descriptor operator()(std::size_t slot) const {
+            return {v, nw->_out.ids[slot], slot};
+        }
+    };
+
+    struct InEdgeMaker {
+        const FlatNetwork* nw = nullptr;
+        index_t v = 0;
+        edge_descriptor operator()(std::size_t pos) const {
+            const index_t s = nw->_in.ids[pos];
+            return {s, v, nw->_out.find(s, v)};
+        }
+    };
+
+public:
+    using vertex_iterator = boost::counting_iterator<vertex_descriptor>;
+    using adjacency_iterator = const index_t*;
+    using out_edge_iterator = boost::transform_iterator<
+                                OutEdgeMaker,
+                                boost::counting_iterator<std::size_t>,
+                                edge_descriptor,
+                                edge_descriptor>;
+    using in_edge_iterator = boost::transform_iterator<
+                                InEdgeMaker,
+                                boost::counting_iterator<std::size_t>,
+                                edge_descriptor,
+                                edge_descriptor>;
+
+    /// Iterates over all edges, grouped by source
+    class edge_iterator:
+        public boost::iterator_facade<edge_iterator,
+                                      edge_descriptor,
+                                      boost::forward_traversal_tag,
+                                      edge_descriptor>
+    {
+    public:
+        edge_iterator() = default;
+        edge_iterator(const FlatNetwork* nw, index_t u, index_t k)
+        :   _nw(nw), _u(u), _k(k)
+        {
+            skip_empty();
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        void skip_empty() {
+            while (_u < _nw->_out.size.size() and _k == _nw->_out.size[_u]) {
+                ++_u;
+                _k = 0;
+            }
+        }
+        void increment() {
+            ++_k;
+            skip_empty();
+        }
+        bool equal(const edge_iterator& other) const {
+            return _u == other._u and _k == other._k;
+        }
+        edge_descriptor dereference() const {
+            const std::size_t slot = _nw->_out.begin[_u] + _k;
+            return {_u, _nw->_out.ids[slot], slot};
+        }
+
+        const FlatNetwork* _nw = nullptr;
+        index_t _u = 0;
+        index_t _k = 0;
+    };
+
+private:
+    VertexStore _vertices;
+    AdjacencyBlocks<EdgeProperty> _out;
+    AdjacencyBlocks<NoPayload> _in;
+    std::size_t _num_edges = 0;
+
+public:
+    FlatNetwork() = default;
+
+    /// Construct a network with num_vertices vertices and no edges
+    explicit FlatNetwork(std::size_t num_vertices) {
+        _vertices.resize(num_vertices);
+        const std::vector<index_t> zeros(num_vertices, 0);
+        _out.init(zeros);
+        _in.init(zeros);
+    }
+
+    /// Pack an existing boost graph (structure and edge properties)
+    template<typename Graph>
+    static FlatNetwork from(const Graph& g) {
+        const std::size_t n = boost::num_vertices(g);
+        FlatNetwork nw;
+        nw._vertices.resize(n);
+
+        std::vector<index_t> out_deg(n, 0), in_deg(n, 0);
+        for (auto [e, e_end] = boost::edges(g); e!=e_end; ++e) {
+            ++out_deg[boost::source(*e, g)];
+            ++in_deg[boost::target(*e, g)];
+        }
+        nw._out.init(out_deg);
+        nw._in.init(in_deg);
+
+        for (auto [e, e_end] = boost::edges(g); e!=e_end; ++e) {
+            nw.add(boost::source(*e, g), boost::target(*e, g), g[*e]);
+        }
+        return nw;
+    }
+
+    // Properties
+    decltype(auto) operator[](vertex_descriptor v) { return _vertices[v]; }
+    decltype(auto) operator[](vertex_descriptor v) const {
+        return _vertices[v];
+    }
+    EdgeProperty& operator[](const edge_descriptor& e) {
+        return _out.payload[e.slot];
+    }
+    const EdgeProperty& operator[](const edge_descriptor& e) const {
+        return _out.payload[e.slot];
+    }
+
+    VertexStore& vertex_store() { return _vertices; }
+    const VertexStore& vertex_store() const { return _vertices; }
+
+    // Structure
+    std::size_t n_vertices() const { return _out.size.size(); }
+    std::size_t n_edges() const { return _num_edges; }
+    std::size_t out_deg(index_t v) const { return _out.size[v]; }
+    std::size_t in_deg(index_t v) const { return _in.size[v]; }
+
+    std::pair<adjacency_iterator, adjacency_iterator>
+    targets(index_t v) const {
+        return {_out.first(v), _out.last(v)};
+    }
+
+    // the properties of the out-edges of v, at the offsets of targets(v)
+    const EdgeProperty* out_properties(index_t v) const {
+        return _out.payload.data() + _out.begin[v];
+    }
+
+    std::pair<out_edge_iterator, out_edge_iterator>
+    out_edge_range(index_t v) const {
+        const OutEdgeMaker f{this, v};
+        const std::size_t b = _out.begin[v];
+        return {out_edge_iterator(boost::counting_iterator<std::size_t>(b), f),
+                out_edge_iterator(
+                    boost::counting_iterator<std::size_t>(b + _out.size[v]),
+                    f)};
+    }
+
+    std::pair<in_edge_iterator, in_edge_iterator>
+    in_edge_range(index_t v) const {
+        const InEdgeMaker f{this, v};
+        const std::size_t b = _in.begin[v];
+        return {in_edge_iterator(boost::counting_iterator<std::size_t>(b), f),
+                in_edge_iterator(
+                    boost::counting_iterator<std::size_t>(b + _in.size[v]),
+                    f)};
+    }
+
+    std::pair<edge_iterator, edge_iterator> edge_range() const {
+        const auto n = static_cast<index_t>(n_vertices());
+        return {edge_iterator(this, 0, 0), edge_iterator(this, n, 0)};
+    }
+
+    std::pair<edge_descriptor, bool> find(index_t u, index_t v) const {
+        const std::size_t slot = _out.find(u, v);
+        return {{u, v, slot}, slot != _out.npos};
+    }
+
+    std::pair<edge_descriptor, bool> add(index_t u, index_t v,
+                                         const EdgeProperty& p) {
+        if (auto existing = find(u, v); existing.second) {
+            return {existing.first, false};
+        }
+        _in.insert(v, u, NoPayload{});
+        const std::size_t slot = _out.insert(u, v, p);
+        ++_num_edges;
+        return {{u, v, slot}, true};
+    }
+
+    void remove(index_t u, index_t v) {
+        if (_out.find(u, v) == _out.npos) {
+            return;
+        }
+        _out.erase(u, v);
+        _in.erase(v, u);
+        --_num_edges;
+    }
+
+    void clear(index_t v) {
+        for (auto t = _out.first(v); t != _out.last(v); ++t) {
+            _in.erase(*t, v);
+        }
+        for (auto s = _in.first(v); s != _in.last(v); ++s) {
+            _out.erase(*s, v);
+        }
+        _num_edges -= _out.size[v] + _in.size[v];
+        _out.size[v] = 0;
+        _in.size[v] = 0;
+    }
+};
+
+
+// BOOST-STYLE FREE FUNCTIONS ..................................................
+
+template<typename V, typename E>
+auto vertices(const FlatNetwork<V, E>& nw) {
+    using It = typename FlatNetwork<V, E>::vertex_iterator;
+    return std::make_pair(It(0), It(static_cast<index_t>(nw.n_vertices())));
+}
+
+template<typename V, typename E>
+std::size_t num_vertices(const FlatNetwork<V, E>& nw) {
+    return nw.n_vertices();
+}
+
+template<typename V, typename E>
+auto edges(const FlatNetwork<V, E>& nw) {
+    return nw.edge_range();
+}
+
+template<typename V, typename E>
+std::size_t num_edges(const FlatNetwork<V, E>& nw) {
+    return nw.n_edges();
+}
+
+template<typename V, typename E>
+auto out_edges(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.out_edge_range(v);
+}
+
+template<typename V, typename E>
+auto in_edges(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.in_edge_range(v);
+}
+
+template<typename V, typename E>
+auto adjacent_vertices(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.targets(v);
+}
+
+template<typename V, typename E>
+std::size_t out_degree(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.out_deg(v);
+}
+
+template<typename V, typename E>
+std::size_t in_degree(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.in_deg(v);
+}
+
+template<typename V, typename E>
+std::size_t degree(index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.out_deg(v) + nw.in_deg(v);
+}
+
+template<typename V, typename E>
+index_t source(const typename FlatNetwork<V, E>::edge_descriptor& e,
+               const FlatNetwork<V, E>&) {
+    return e.src;
+}
+
+template<typename V, typename E>
+index_t target(const typename FlatNetwork<V, E>::edge_descriptor& e,
+               const FlatNetwork<V, E>&) {
+    return e.tgt;
+}
+
+template<typename V, typename E>
+auto edge(index_t u, index_t v, const FlatNetwork<V, E>& nw) {
+    return nw.find(u, v);
+}
+
+template<typename V, typename E>
+auto add_edge(index_t u, index_t v, const E& p, FlatNetwork<V, E>& nw) {
+    return nw.add(u, v, p);
+}
+
+template<typename V, typename E>
+auto add_edge(index_t u, index_t v, FlatNetwork<V, E>& nw) {
+    return nw.add(u, v, E{});
+}
+
+template<typename V, typename E>
+void remove_edge(index_t u, index_t v, FlatNetwork<V, E>& nw) {
+    nw.remove(u, v);
+}
+
+template<typename V, typename E>
+void clear_vertex(index_t v, FlatNetwork<V, E>& nw) {
+    nw.clear(v);
+}
+
+template<typename V, typename E, typename RNGType>
+index_t random_vertex(const FlatNetwork<V, E>& nw, RNGType& rng) {
+    return boost::random_vertex(nw, rng);
+}
+
+template<typename V, typename E>
+index_t get(boost::vertex_index_t, const FlatNetwork<V, E>&, index_t v) {
+    return v;
+}
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_FLAT_NETWORK
@@ -1,5 +1,5 @@
-#ifndef UTOPIA_MODELS_OPINIONET_GRAPH_ANALYSIS
-#define UTOPIA_MODELS_OPINIONET_GRAPH_ANALYSIS
+#ifndef UTOPIA_MODELS_OPDYN_GRAPH_ANALYSIS
+#define UTOPIA_MODELS_OPDYN_GRAPH_ANALYSIS
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_traits.hpp>
@@ -8,71 +8,125 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "parallel.hh"
 
 namespace Utopia {
 namespace Models {
-namespace Opinionet {
+namespace OpDyn {
 namespace Graph_Analysis {
 
 // HELPER FUNCTIONS ............................................................
 
 
-// Starting from a given vertex, iteratively collect all vertices in tolerance
-// range that are connected through an in edge or out edge.
-template<typename NWType>
-void fill_opinion_cluster(  size_t v,
-                            std::vector<size_t>& c,
-                            double tolerance,
-                            NWType& nw) {
+/*! Disjoint sets of the vertex indices 0, ..., n-1, with union by size and
+path halving; a sequence of m operations takes O(m α(n)) time and needs no
+recursion. */
+class DisjointSets {
+    std::vector<size_t> _parent;
+    std::vector<size_t> _size;
+    size_t _num_sets;
+
+public:
+    explicit DisjointSets(size_t n)
+    :
+        _parent(n),
+        _size(n, 1),
+        _num_sets(n)
+    {
+        std::iota(_parent.begin(), _parent.end(), 0);
+    }
 
-    if (std::find(c.begin(), c.end(), v) == c.end()) {
-        c.push_back(v);
-        for (auto [w, w_end]=adjacent_vertices(v, nw); w!=w_end; w++) {
-            if (fabs(nw[v].opinion - nw[*w].opinion) <= nw[v].susceptibility) {
-                fill_opinion_cluster(*w, c, nw[v].susceptibility, nw);
-            }
-        }
-        for (auto [e, e_end]=in_edges(v, nw); e!=e_end; e++) {
-            if (fabs(nw[v].opinion - nw[source(*e, nw)].opinion) <= nw[v].susceptibility) {
-                fill_opinion_cluster(source(*e, nw), c, nw[v].susceptibility, nw);
-            }
+    /// The representative of the set containing v
+    size_t find(size_t v) {
+        while (_parent[v] != v) {
+            _parent[v] = _parent[_parent[v]];
+            v = _parent[v];
         }
+        return v;
     }
-}
 
+    /// Merge the sets containing u and v
+    void unite(size_t u, size_t v) {
+        u = find(u);
+        v = find(v);
+        if (u == v) {
+            return;
+        }
+        if (_size[u] < _size[v]) {
+            std::swap(u, v);
+        }
+        _parent[v] = u;
+        _size[u] += _size[v];
+        --_num_sets;
+    }
 
-// Starting from a given vertex, iteratively collect all vertices in tolerance
-// rangethat are connected through an in edge or out edge that have a weight
-// larger than a certain threshold.
-template<typename NWType>
-void fill_weighted_opinion_cluster( size_t v,
-                                    std::vector<size_t>& c,
-                                    double min_weight,
-                                    NWType& nw) {
+    size_t num_sets() const {
+        return _num_sets;
+    }
 
-    if (std::find(c.begin(), c.end(), v) == c.end()) {
-        c.push_back(v);
-        for (auto [w, w_end]=adjacent_vertices(v, nw); w!=w_end; w++) {
-            if ((fabs(nw[v].opinion - nw[*w].opinion) <= nw[v].susceptibility)
-                and (nw[edge(v, *w, nw).first].attr
-                     * out_degree(v, nw) >= min_weight)) {
-                fill_weighted_opinion_cluster(  *w,
-                                                c,
-                                                min_weight,
-                                                nw);
+    /// The members of each set, ordered by their smallest member
+    std::vector<std::vector<size_t>> sets() {
+        std::vector<std::vector<size_t>> s;
+        std::vector<size_t> set_of(_parent.size(), _parent.size());
+        for (size_t v=0; v<_parent.size(); ++v) {
+            const size_t r = find(v);
+            if (set_of[r] == _parent.size()) {
+                set_of[r] = s.size();
+                s.emplace_back();
+                s.back().reserve(_size[r]);
             }
+            s[set_of[r]].push_back(v);
         }
-        for (auto [e, e_end]=in_edges(v, nw); e!=e_end; e++) {
-            if ((fabs(nw[v].opinion - nw[source(*e, nw)].opinion) <= nw[v].susceptibility)
-                and (nw[*e].attr
-                     * out_degree(source(*e, nw), nw) >= min_weight)) {
-                fill_weighted_opinion_cluster(  source(*e, nw),
-                                                c,
-                                                min_weight,
-                                                nw);
-            }
+        return s;
+    }
+};
+
+
+// Join the end points of all edges (i.e. along in and out edges) for which
+// the predicate holds.
+template<typename NWType, typename EdgePredicate>
+DisjointSets edge_clusters(const NWType& nw, EdgePredicate&& joins) {
+    DisjointSets ds(num_vertices(nw));
+    for (auto [e, e_end]=edges(nw); e!=e_end; ++e) {
+        if (joins(*e)) {
+            ds.unite(source(*e, nw), target(*e, nw));
         }
     }
+    return ds;
+}
+
+
+// Two users are in the same opinion cluster if their opinions are within the
+// tolerance range; a negative tolerance uses the tolerance of the user at the
+// source of the edge, i.e. the one that would listen to the other.
+template<typename NWType>
+auto opinion_predicate(const NWType& nw, double tolerance) {
+    return [&nw, tolerance](const auto& e) {
+        const auto s = source(e, nw);
+        const double tol = (tolerance < 0.) ? nw[s].tolerance : tolerance;
+        return fabs(nw[s].opinion - nw[target(e, nw)].opinion) <= tol;
+    };
+}
+
+
+// As opinion_predicate, and the normalised weight of the edge relative to the
+// uniform weight 1/out_degree is at least min_weight. The weights are
+// normalised by the weight sum of the source (see revision::normalize_weights).
+template<typename NWType>
+auto weighted_opinion_predicate(const NWType& nw,
+                                double tolerance,
+                                double min_weight) {
+    return [&nw, min_weight, in_range=opinion_predicate(nw, tolerance)]
+           (const auto& e) {
+        const auto s = source(e, nw);
+        return in_range(e)
+               and (nw[e].attr * out_degree(s, nw)
+                    >= min_weight * nw[s].weight_sum);
+    };
 }
 
 
@@ -171,6 +225,174 @@ std::vector<double> relative_betweenness_centrality(NWType& nw) {
 }
 
 
+// The working memory of the single-source Brandes step, one per thread: the
+// distances, path counts and dependencies of the vertices reached from the
+// source, in the order they were reached, and the accumulated dependencies
+// (and their squares, for the error of the sampled estimate).
+struct BrandesWorkspace {
+    std::vector<long> dist;
+    std::vector<double> sigma;
+    std::vector<double> delta;
+    std::vector<size_t> order;
+    std::vector<double> sum;
+    std::vector<double> sum_sq;
+
+    explicit BrandesWorkspace(size_t n = 0)
+    :
+        dist(n, -1),
+        sigma(n, 0.),
+        delta(n, 0.),
+        order(),
+        sum(n, 0.),
+        sum_sq()
+    { }
+};
+
+
+// Add the dependencies of all vertices on the shortest paths from source s to
+// the workspace (Brandes 2001): a breadth-first search along the out-edges
+// counts the shortest paths, and the dependencies are accumulated from the
+// successors in reverse order. Only the vertices reached are reset, so a
+// single step costs O(edges reached).
+template<typename NWType>
+void brandes_single_source(size_t s, const NWType& nw, BrandesWorkspace& ws) {
+    ws.order.clear();
+    ws.order.push_back(s);
+    ws.dist[s] = 0;
+    ws.sigma[s] = 1.;
+
+    // the order vector doubles as the queue
+    for (size_t head=0; head<ws.order.size(); ++head) {
+        const size_t v = ws.order[head];
+        for (auto [w, w_end]=adjacent_vertices(v, nw); w!=w_end; ++w) {
+            if (ws.dist[*w] < 0) {
+                ws.dist[*w] = ws.dist[v] + 1;
+                ws.order.push_back(*w);
+            }
+            if (ws.dist[*w] == ws.dist[v] + 1) {
+                ws.sigma[*w] += ws.sigma[v];
+            }
+        }
+    }
+
+    for (auto it=ws.order.rbegin(); it!=ws.order.rend(); ++it) {
+        const size_t v = *it;
+        for (auto [w, w_end]=adjacent_vertices(v, nw); w!=w_end; ++w) {
+            if (ws.dist[*w] == ws.dist[v] + 1) {
+                ws.delta[v] += ws.sigma[v] / ws.sigma[*w] * (1. + ws.delta[*w]);
+            }
+        }
+        if (v != s) {
+            ws.sum[v] += ws.delta[v];
+            if (not ws.sum_sq.empty()) {
+                ws.sum_sq[v] += ws.delta[v] * ws.delta[v];
+            }
+        }
+    }
+
+    for (const size_t v : ws.order) {
+        ws.dist[v] = -1;
+        ws.sigma[v] = 0.;
+        ws.delta[v] = 0.;
+    }
+}
+
+
+// The betweenness centrality of each vertex, and the standard error of the
+// estimate if it is computed from a sample of source vertices.
+struct BetweennessEstimate {
+    std::vector<double> centrality;
+    std::vector<double> error;
+};
+
+
+// Calculate the betweenness centrality of each vertex with the source vertices
+// spread across the threads of the pool. If num_samples is positive and
+// smaller than the number of vertices, only that many source vertices are
+// drawn (without replacement) and the sums over sources are extrapolated
+// (Brandes & Pich 2007); the error is then the standard error of this
+// estimate, else it is 0. The result does not depend on the number of threads,
+// up to rounding.
+template<typename NWType, typename RNGType>
+BetweennessEstimate betweenness_centrality(const NWType& nw,
+                                           parallel::ThreadPool& pool,
+                                           size_t num_samples,
+                                           RNGType& rng) {
+    const size_t n = num_vertices(nw);
+    const bool sampled = (num_samples > 0) and (num_samples < n);
+
+    std::vector<size_t> sources(n);
+    std::iota(sources.begin(), sources.end(), 0);
+    if (sampled) {
+        // partial Fisher-Yates shuffle
+        for (size_t i=0; i<num_samples; ++i) {
+            std::uniform_int_distribution<size_t> pick(i, n-1);
+            std::swap(sources[i], sources[pick(rng)]);
+        }
+        sources.resize(num_samples);
+    }
+
+    std::vector<BrandesWorkspace> ws(pool.num_threads(), BrandesWorkspace(n));
+    if (sampled) {
+        for (auto& w : ws) {
+            w.sum_sq.assign(n, 0.);
+        }
+    }
+
+    pool.parallel_for_dynamic(sources.size(), [&](size_t i, size_t t){
+        brandes_single_source(sources[i], nw, ws[t]);
+    });
+
+    BetweennessEstimate bc{std::vector<double>(n, 0.),
+                           std::vector<double>(n, 0.)};
+    for (const auto& w : ws) {
+        for (size_t v=0; v<n; ++v) {
+            bc.centrality[v] += w.sum[v];
+        }
+    }
+    if (not sampled) {
+        return bc;
+    }
+
+    // The sum over all sources is estimated as n times the sample mean; its
+    // variance follows from the sample variance with the finite population
+    // correction.
+    const double k = double(num_samples);
+    for (size_t v=0; v<n; ++v) {
+        double sum_sq = 0.;
+        for (const auto& w : ws) {
+            sum_sq += w.sum_sq[v];
+        }
+        const double mean = bc.centrality[v] / k;
+        const double var = (k > 1.) ?
+                std::max(0., (sum_sq - k * mean * mean) / (k - 1.)) : 0.;
+        bc.centrality[v] = double(n) * mean;
+        bc.error[v] = double(n) * std::sqrt(var / k * (1. - k / double(n)));
+    }
+    return bc;
+}
+
+
+// As betweenness_centrality, relative to the highest possible value
+// (n-1)(n-2) of a directed graph, i.e. to a vertex on all shortest paths.
+template<typename NWType, typename RNGType>
+BetweennessEstimate relative_betweenness_centrality(const NWType& nw,
+                                                    parallel::ThreadPool& pool,
+                                                    size_t num_samples,
+                                                    RNGType& rng) {
+    auto bc = betweenness_centrality(nw, pool, num_samples, rng);
+    const double n = double(num_vertices(nw));
+    const double norm = (n > 2.) ? (n - 1.) * (n - 2.) : 1.;
+    for (auto& val : bc.centrality) {
+        val /= norm;
+    }
+    for (auto& val : bc.error) {
+        val /= norm;
+    }
+    return bc;
+}
+
+
 // Identify groups of agents with similar (within tolerance range) opinions.
 template<typename NWType>
 std::vector<std::vector<size_t>> opinion_groups(NWType nw,
@@ -216,43 +438,19 @@ std::vector<std::vector<size_t>> opinion_groups(NWType nw,
 
 
 // Identify groups of agents with similar (within tolerance range) opinions
-// that are connected on the network.
+// that are connected on the network. A negative tolerance uses the tolerance
+// of the users (see opinion_predicate).
 template<typename NWType>
-std::vector<std::vector<size_t>> opinion_clusters(NWType nw,
-                                                  double tolerance) {
-    
-    std::vector<std::vector<size_t>> opinion_clusters;
-    std::vector<size_t> temp_c;
-    bool next;
-
-    // Find all opinion clusters through a loop over all vertices as the
-    // source of the cluster.
-    for (auto [v, v_end]=vertices(nw); v!=v_end; v++) {
-
-        next = false;
-
-        // If vertex is part of an already discovered opinion cluster
-        // its cluster is the same (by definition).
-        for (auto& c: opinion_clusters) {
-            if (std::find(c.begin(), c.end(), *v) != c.end()) {
-                next = true;
-            }
-        }
-
-        if (next) {
-            continue;
-        }
+std::vector<std::vector<size_t>> opinion_clusters(const NWType& nw,
+                                                  double tolerance = -1.) {
+    return edge_clusters(nw, opinion_predicate(nw, tolerance)).sets();
+}
 
-        // Else get the opinion cluster around this vertex.
-        else {
 
-            temp_c.clear();
-            fill_opinion_cluster(*v, temp_c, tolerance, nw);
-            opinion_clusters.push_back(temp_c);
-        }
-    }
-
-    return opinion_clusters;
+// The number of opinion clusters, without collecting their members.
+template<typename NWType>
+size_t num_opinion_clusters(const NWType& nw, double tolerance = -1.) {
+    return edge_clusters(nw, opinion_predicate(nw, tolerance)).num_sets();
 }
 
 
@@ -260,50 +458,32 @@ std::vector<std::vector<size_t>> opinion_clusters(NWType nw,
 // that are connected on the network (with in or out edges that have a weight
 // larger than a certain threshold).
 template<typename NWType>
-std::vector<std::vector<size_t>> weighted_opinion_clusters( 
-                                    NWType nw,
-                                    double tolerance,
+std::vector<std::vector<size_t>> weighted_opinion_clusters(
+                                    const NWType& nw,
+                                    double tolerance = -1.,
                                     double min_weight = -1.) {
-    
-    std::vector<std::vector<size_t>> opinion_clusters;
-    std::vector<size_t> temp_c;
-    bool next;
 
     if (min_weight < 0.) {
         min_weight = 0.1;
     }
 
-    // Find all opinion clusters through a loop over all vertices as the
-    // source of the cluster.
-    for (auto [v, v_end]=vertices(nw); v!=v_end; v++) {
-
-        next = false;
-
-        // If vertex is part of an already discovered opinion cluster
-        // its cluster is the same (by definition).
-        for (auto& c: opinion_clusters) {
-            if (std::find(c.begin(), c.end(), *v) != c.end()) {
-                next = true;
-            }
-        }
+    return edge_clusters(nw, weighted_opinion_predicate(nw, tolerance,
+                                                        min_weight)).sets();
+}
 
-        if (next) {
-            continue;
-        }
 
-        // Else get the opinion cluster around this vertex.
-        else {
+// The number of weighted opinion clusters, without collecting their members.
+template<typename NWType>
+size_t num_weighted_opinion_clusters(const NWType& nw,
+                                     double tolerance = -1.,
+                                     double min_weight = -1.) {
 
-            temp_c.clear();
-            fill_weighted_opinion_cluster(  *v,
-                                            temp_c,
-                                            min_weight,
-                                            nw);
-            opinion_clusters.push_back(temp_c);
-        }
+    if (min_weight < 0.) {
+        min_weight = 0.1;
     }
 
-    return opinion_clusters;
+    return edge_clusters(nw, weighted_opinion_predicate(nw, tolerance,
+                                                        min_weight)).num_sets();
 }
 
 
@@ -364,8 +544,8 @@ std::vector<std::vector<size_t>> closed_communities(NWType nw) {
 
 
 } // namespace Graph_Analysis
-} // namespace Opinionet
+} // namespace OpDyn
 } // namespace Models
 } // namespace Utopia
 
-#endif // UTOPIA_MODELS_OPINIONET_GRAPH_ANALYSIS
+#endif // UTOPIA_MODELS_OPDYN_GRAPH_ANALYSIS
@@ -186,6 +186,12 @@ def sweep( dm: DataManager, *,
         return var
 
     def get_convergence_time(raw_data):
+        # written by the model if its convergence detection is enabled;
+        # -1 if the run did not converge
+        if raw_data.name == 'convergence_time':
+            ct = float(raw_data.values.flat[0])
+            return ct if ct >= 0 else np.nan
+
         max_tol = 0.05
         min_tol = 0.005
         ct = 0.
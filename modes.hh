@@ -11,6 +11,13 @@ enum Mode {
     Ageing_and_Media
 };
 
+/*! The data structures available for the user network: the boost adjacency
+list, or the flat per-vertex blocks of flat_network.hh. */
+enum class NetworkBackend {
+    adjacency_list,
+    flat
+};
+
 }
 
 #endif // UTOPIA_MODELS_OPDYN_MODES
@@ -0,0 +1,193 @@
+#ifndef UTOPIA_MODELS_OPDYN_OBSERVABLES
+#define UTOPIA_MODELS_OPDYN_OBSERVABLES
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace Utopia::Models::OpDyn::observables {
+
+/*! Reductions of the opinion distribution, computed during the simulation so
+that the full per-vertex opinions need not be written. They reproduce the
+measures of model_plots/sweep.py: the values are passed as an iterator range
+and an accessor, e.g. the vertices of a network and a lambda returning the
+opinion of a vertex.
+*/
+
+// MOMENTS .....................................................................
+
+/// The first two moments and the range of a set of values
+struct Moments {
+    std::size_t n = 0;
+    double mean = 0.;
+    double variance = 0.;
+    double min = std::numeric_limits<double>::quiet_NaN();
+    double max = std::numeric_limits<double>::quiet_NaN();
+
+    /// The largest distance between two values
+    double range() const {
+        return max - min;
+    }
+
+    /// The sum of the squared differences over all ordered pairs of values,
+    /// sum_ij (x_i - x_j)^2 = 2 n^2 var
+    double polarization() const {
+        return 2. * double(n) * double(n) * variance;
+    }
+};
+
+/// The moments of value(*it) over [first, last), computed in two passes;
+/// the variance is the population variance (as numpy.var)
+template<typename It, typename Value>
+Moments moments(It first, It last, Value&& value) {
+    Moments m;
+    double sum = 0.;
+    for (It it = first; it != last; ++it) {
+        const double x = value(*it);
+        if (m.n == 0) {
+            m.min = x;
+            m.max = x;
+        }
+        m.min = std::min(m.min, x);
+        m.max = std::max(m.max, x);
+        sum += x;
+        ++m.n;
+    }
+    if (m.n == 0) {
+        return m;
+    }
+    m.mean = sum / double(m.n);
+
+    double sq = 0.;
+    for (It it = first; it != last; ++it) {
+        const double d = value(*it) - m.mean;
+        sq += d * d;
+    }
+    m.variance = sq / double(m.n);
+    return m;
+}
+
+// HISTOGRAM ...................................................................
+
+/// The counts of value(*it) in num_bins equal bins over [lo, hi]; as in
+/// numpy.histogram, the last bin includes hi, and values outside are dropped
+template<typename It, typename Value>
+std::vector<std::size_t> histogram(It first, It last, Value&& value,
+                                   const std::size_t num_bins,
+                                   const double lo = 0.,
+                                   const double hi = 1.)
+{
+    std::vector<std::size_t> counts(num_bins, 0);
+    for (It it = first; it != last; ++it) {
+        const double x = value(*it);
+        if (not (x >= lo and x <= hi)) {
+            continue;
+        }
+        auto bin = std::size_t((x - lo) / (hi - lo) * double(num_bins));
+        counts[std::min(bin, num_bins - 1)] += 1;
+    }
+    return counts;
+}
+
+/// The localization sum_i p_i^4 / (sum_i p_i^2)^2 of the histogram, with
+/// p_i the fraction of values in bin i
+inline double localization(const std::vector<std::size_t>& counts) {
+    const double total = std::accumulate(counts.begin(), counts.end(), 0.);
+    double p2 = 0.;
+    double p4 = 0.;
+    for (const auto c : counts) {
+        const double p = double(c) / total;
+        p2 += p * p;
+        p4 += p * p * p * p;
+    }
+    return p4 / (p2 * p2);
+}
+
+/// The number of peaks of the histogram, as found by scipy.signal.find_peaks
+/// with the given minimal prominence and distance (in bins): the local maxima
+/// (the middle of flat maxima), of which the highest are kept such that no two
+/// are closer than the distance, and only those standing out by at least the
+/// prominence from the higher of the minima towards the next higher bin on
+/// either side.
+inline std::size_t number_of_peaks(const std::vector<std::size_t>& counts,
+                                   const double prominence,
+                                   const std::size_t distance)
+{
+    const std::size_t n = counts.size();
+
+    // local maxima
+    std::vector<std::size_t> peaks;
+    for (std::size_t i = 1; i + 1 < n; ++i) {
+        if (counts[i - 1] >= counts[i]) {
+            continue;
+        }
+        std::size_t ahead = i + 1;
+        while (ahead + 1 < n and counts[ahead] == counts[i]) {
+            ++ahead;
+        }
+        if (counts[ahead] < counts[i]) {
+            peaks.push_back((i + ahead - 1) / 2);
+            i = ahead;
+        }
+    }
+
+    // distance: going from the highest peak down, remove the lower peaks
+    // within the distance
+    std::vector<bool> keep(peaks.size(), true);
+    if (distance > 1) {
+        std::vector<std::size_t> order(peaks.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&](std::size_t a, std::size_t b){
+                return counts[peaks[a]] < counts[peaks[b]];
+            });
+
+        for (auto o = order.rbegin(); o != order.rend(); ++o) {
+            const std::size_t j = *o;
+            if (not keep[j]) {
+                continue;
+            }
+            for (std::size_t k = j; k > 0 and peaks[j] - peaks[k-1] < distance;
+                 --k)
+            {
+                keep[k-1] = false;
+            }
+            for (std::size_t k = j + 1;
+                 k < peaks.size() and peaks[k] - peaks[j] < distance; ++k)
+            {
+                keep[k] = false;
+            }
+        }
+    }
+
+    // prominence
+    std::size_t num_peaks = 0;
+    for (std::size_t j = 0; j < peaks.size(); ++j) {
+        if (not keep[j]) {
+            continue;
+        }
+        const std::size_t p = peaks[j];
+
+        std::size_t left_min = counts[p];
+        for (std::size_t i = p + 1; i > 0 and counts[i-1] <= counts[p]; --i) {
+            left_min = std::min(left_min, counts[i-1]);
+        }
+        std::size_t right_min = counts[p];
+        for (std::size_t i = p; i < n and counts[i] <= counts[p]; ++i) {
+            right_min = std::min(right_min, counts[i]);
+        }
+
+        const double prom = double(counts[p])
+                            - double(std::max(left_min, right_min));
+        if (prom >= prominence) {
+            ++num_peaks;
+        }
+    }
+    return num_peaks;
+}
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_OBSERVABLES
@@ -0,0 +1,284 @@
+#ifndef UTOPIA_MODELS_OPDYN_OUTPUT
+#define UTOPIA_MODELS_OPDYN_OUTPUT
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hdf5.h>
+
+#include <utopia/core/types.hh>
+
+namespace Utopia::Models::OpDyn::output {
+
+/*! The storage settings of a per-vertex dataset, read from its entry in the
+'output' config node:
+
+    chunksize:     the chunk shape [time, vertex]; [] lets HDF5 choose
+    compression:   the deflate level, 0 (none) to 9
+    quantization:  0, 8 or 16; with 8 or 16, values in the unit interval are
+                   stored as unsigned integers of this many bits, x -> round(x
+                   (2^bits - 1)), and the dataset gets the attributes
+                   scale_factor and add_offset to undo this (CF convention)
+
+Quantization is lossy (the error is at most half a step, i.e. 0.002 for 8 and
+8e-6 for 16 bits) and only allowed for datasets of unit-interval quantities.
+*/
+struct DatasetSpec {
+    std::vector<hsize_t> chunksize;
+    std::size_t compression;
+    unsigned int quantization;
+
+    template<typename Config>
+    DatasetSpec(const std::string& name,
+                const Config& cfg,
+                const bool unit_interval)
+    :
+        chunksize(get_as<std::vector<hsize_t>>("chunksize", cfg[name])),
+        compression(get_as<std::size_t>("compression", cfg[name])),
+        quantization(get_as<unsigned int>("quantization", cfg[name]))
+    {
+        if (compression > 9) {
+            throw std::invalid_argument("The compression level of dataset '"
+                                        + name + "' must be in [0, 9]!");
+        }
+        if (quantization != 0 and quantization != 8 and quantization != 16) {
+            throw std::invalid_argument("The quantization of dataset '" + name
+                                        + "' must be 0, 8 or 16 (bits)!");
+        }
+        if (quantization != 0 and not unit_interval) {
+            throw std::invalid_argument("Dataset '" + name + "' does not hold "
+                                        "values in the unit interval and can "
+                                        "not be quantized!");
+        }
+    }
+
+    /// The step between two quantized values
+    double scale_factor() const {
+        return 1. / double((std::uint32_t(1) << quantization) - 1);
+    }
+};
+
+/// The unsigned integer representing x in [0, 1] (values outside are clamped)
+template<typename UInt>
+UInt quantize(const double x) {
+    constexpr double max = double(UInt(-1));
+    return UInt(std::lround(std::clamp(x, 0., 1.) * max));
+}
+
+/// Add the attributes needed to decode a quantized dataset
+template<typename DataSet>
+void add_attributes(DataSet& dset, const DatasetSpec& spec) {
+    if (spec.quantization != 0) {
+        dset.add_attribute("quantization_bits", spec.quantization);
+        dset.add_attribute("scale_factor", spec.scale_factor());
+        dset.add_attribute("add_offset", 0.);
+    }
+}
+
+/// Write value(*it) for all it in [first, last) with the given settings: as
+/// float, or quantized to 8 or 16 bits
+template<typename DataSet, typename It, typename Value>
+void write_unit_interval(DataSet& dset,
+                         const DatasetSpec& spec,
+                         It first,
+                         It last,
+                         Value&& value)
+{
+    switch (spec.quantization) {
+        case 8:
+            dset.write(first, last, [&](auto x) {
+                return quantize<std::uint8_t>(value(x));
+            });
+            break;
+        case 16:
+            dset.write(first, last, [&](auto x) {
+                return quantize<std::uint16_t>(value(x));
+            });
+            break;
+        default:
+            dset.write(first, last, [&](auto x) {
+                return (float)value(x);
+            });
+    }
+}
+
+
+// BUFFERED WRITER .............................................................
+
+/*! Hands buffers of output data to a drain function, which writes them to the
+datasets. A buffer is acquired, filled with a snapshot of the data, and
+submitted; buffers are reused, so after the first writes no memory is
+allocated.
+
+If asynchronous, a writer thread drains the submitted buffers in order, while
+the caller continues. There are queue_depth buffers (2: double buffering);
+if all of them are pending, acquire blocks until the writer has drained one.
+An exception thrown by the drain function is rethrown by the next call to
+acquire or flush. The destructor drains all pending buffers.
+
+If not asynchronous, there is a single buffer, and submit drains it right
+away.
+*/
+template<typename Buffer>
+class BufferedWriter {
+    std::function<void(const Buffer&)> _drain;
+    const bool _asynchronous;
+
+    std::mutex _mutex;
+    std::condition_variable _submitted;
+    std::condition_variable _drained;
+    std::vector<std::unique_ptr<Buffer>> _free;
+    std::deque<std::unique_ptr<Buffer>> _queue;
+    bool _busy;
+    bool _stop;
+    std::exception_ptr _error;
+
+    std::thread _thread;
+
+public:
+    BufferedWriter(std::function<void(const Buffer&)> drain,
+                   const bool asynchronous,
+                   const std::size_t queue_depth = 2)
+    :
+        _drain(std::move(drain)),
+        _asynchronous(asynchronous),
+        _busy(false),
+        _stop(false)
+    {
+        if (_asynchronous and queue_depth == 0) {
+            throw std::invalid_argument("The queue depth of the asynchronous "
+                                        "writer must be positive!");
+        }
+        for (std::size_t i = 0; i < (_asynchronous ? queue_depth : 1); ++i) {
+            _free.push_back(std::make_unique<Buffer>());
+        }
+        if (_asynchronous) {
+            _thread = std::thread([this](){ this->work(); });
+        }
+    }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    ~BufferedWriter() {
+        if (not _asynchronous) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _submitted.notify_one();
+        _thread.join();
+
+        if (_error) {
+            try {
+                std::rethrow_exception(_error);
+            }
+            catch (std::exception& e) {
+                std::cerr << "Writing the output failed: " << e.what()
+                          << std::endl;
+            }
+            catch (...) {
+                std::cerr << "Writing the output failed!" << std::endl;
+            }
+        }
+    }
+
+    /// A buffer to fill, waiting until one is free
+    std::unique_ptr<Buffer> acquire() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _drained.wait(lock, [this](){
+            return not _free.empty() or _error;
+        });
+        rethrow();
+        auto buf = std::move(_free.back());
+        _free.pop_back();
+        return buf;
+    }
+
+    /// Hand a filled buffer to the writer
+    void submit(std::unique_ptr<Buffer> buf) {
+        if (not _asynchronous) {
+            _drain(*buf);
+            _free.push_back(std::move(buf));
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(std::move(buf));
+        }
+        _submitted.notify_one();
+    }
+
+    /// Wait until all submitted buffers are drained
+    void flush() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _drained.wait(lock, [this](){
+            return (_queue.empty() and not _busy) or _error;
+        });
+        rethrow();
+    }
+
+private:
+    /// Throw the error of the writer, if any (with the lock held)
+    void rethrow() {
+        if (_error) {
+            auto error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    void work() {
+        while (true) {
+            std::unique_ptr<Buffer> buf;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _submitted.wait(lock, [this](){
+                    return _stop or not _queue.empty();
+                });
+                if (_queue.empty()) {
+                    return;
+                }
+                buf = std::move(_queue.front());
+                _queue.pop_front();
+                _busy = true;
+            }
+
+            std::exception_ptr error;
+            try {
+                _drain(*buf);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _free.push_back(std::move(buf));
+                _busy = false;
+                if (error and not _error) {
+                    _error = error;
+                }
+            }
+            _drained.notify_all();
+        }
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_OUTPUT
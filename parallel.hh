@@ -0,0 +1,320 @@
+#ifndef UTOPIA_MODELS_OPDYN_PARALLEL
+#define UTOPIA_MODELS_OPDYN_PARALLEL
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+namespace Utopia::Models::OpDyn::parallel {
+
+// THREAD POOL .................................................................
+
+/*! A fixed set of worker threads that execute loops over index ranges. The
+calling thread takes part as thread 0, so a pool of one thread runs everything
+inline. In parallel_for, the range is split into contiguous, equally sized
+chunks, one per thread; which thread handles an index thus only depends on the
+range length and the number of threads. In parallel_for_dynamic, idle threads
+take the next index from a shared counter, which balances tasks of very
+different length, e.g. whole model runs.
+
+The job is passed to the workers by reference, without being copied, and an
+exception thrown on any thread is rethrown on the calling thread once all
+threads are done.
+*/
+class ThreadPool {
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+
+    // the current job, called with the thread index, how many workers have
+    // yet to finish it, and the exception each thread threw
+    void (*_call)(const void*, std::size_t);
+    const void* _job;
+    std::uint64_t _generation;
+    std::size_t _pending;
+    std::vector<std::exception_ptr> _errors;
+    bool _stop;
+
+public:
+    /// Construct a pool with num_threads threads (0: one per hardware thread)
+    explicit ThreadPool(std::size_t num_threads = 1)
+    :
+        _call(nullptr),
+        _job(nullptr),
+        _generation(0),
+        _pending(0),
+        _stop(false)
+    {
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        _errors.resize(num_threads);
+        for (std::size_t t = 1; t < num_threads; ++t) {
+            _workers.emplace_back([this, t](){ this->work(t); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _start.notify_all();
+        for (auto& w : _workers) {
+            w.join();
+        }
+    }
+
+    std::size_t num_threads() const {
+        return _workers.size() + 1;
+    }
+
+    /// Call f(i, thread) for all i in [0, n), and wait until all are done
+    template<typename F>
+    void parallel_for(std::size_t n, F&& f) {
+        const std::size_t T = num_threads();
+        auto chunk = [&f, n, T](std::size_t t) {
+            for (std::size_t i = n * t / T; i < n * (t + 1) / T; ++i) {
+                f(i, t);
+            }
+        };
+
+        if (T == 1 or n < 2) {
+            for (std::size_t i = 0; i < n; ++i) {
+                f(i, 0);
+            }
+            return;
+        }
+        run_on_all(chunk);
+    }
+
+    /// Call f(i, thread) for all i in [0, n), handing out the indices in
+    /// order to whichever thread is idle, and wait until all are done
+    template<typename F>
+    void parallel_for_dynamic(std::size_t n, F&& f) {
+        std::atomic<std::size_t> next(0);
+        auto take = [&f, &next, n](std::size_t t) {
+            for (std::size_t i = next++; i < n; i = next++) {
+                f(i, t);
+            }
+        };
+
+        if (num_threads() == 1 or n < 2) {
+            take(0);
+            return;
+        }
+        run_on_all(take);
+    }
+
+private:
+    /// Run job(t) on every thread t, including the calling thread as 0, and
+    /// rethrow the first exception thrown, after all threads are done
+    template<typename Job>
+    void run_on_all(const Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _call = [](const void* j, std::size_t t){
+                (*static_cast<const Job*>(j))(t);
+            };
+            _job = &job;
+            _pending = _workers.size();
+            ++_generation;
+        }
+        _start.notify_all();
+
+        try {
+            job(0);
+        }
+        catch (...) {
+            _errors[0] = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this](){ return _pending == 0; });
+        _call = nullptr;
+        _job = nullptr;
+
+        for (auto& error : _errors) {
+            if (error) {
+                const auto first = error;
+                std::fill(_errors.begin(), _errors.end(), nullptr);
+                std::rethrow_exception(first);
+            }
+        }
+    }
+
+    void work(std::size_t t) {
+        std::uint64_t seen = 0;
+        while (true) {
+            void (*call)(const void*, std::size_t);
+            const void* job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _start.wait(lock, [&](){
+                    return _stop or _generation != seen;
+                });
+                if (_stop) {
+                    return;
+                }
+                seen = _generation;
+                call = _call;
+                job = _job;
+            }
+
+            try {
+                call(job, t);
+            }
+            catch (...) {
+                _errors[t] = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                --_pending;
+            }
+            _done.notify_one();
+        }
+    }
+};
+
+/// Releases a mutex that the calling thread holds, and takes it back when it
+/// goes out of scope, also on an exception; does nothing for a nullptr
+class Unlock {
+    std::mutex* const _mutex;
+
+public:
+    explicit Unlock(std::mutex* mutex)
+    :
+        _mutex(mutex)
+    {
+        if (_mutex) {
+            _mutex->unlock();
+        }
+    }
+
+    Unlock(const Unlock&) = delete;
+    Unlock& operator=(const Unlock&) = delete;
+
+    ~Unlock() {
+        if (_mutex) {
+            _mutex->lock();
+        }
+    }
+};
+
+
+// CONFLICT-FREE SCHEDULING ....................................................
+
+/*! Splits a sequence of user revisions into levels of independent revisions.
+The revision of v writes the opinion and tolerance of v and the weights of its
+out-edges, and it reads the opinions of its out-neighbours. Two revisions
+u and v thus conflict if u is an out-neighbour of v or vice versa.
+
+A revision is placed one level above the highest earlier revision it conflicts
+with. Executing the levels in order is hence equivalent to executing the
+revisions in sequence, as long as no vertex appears twice: the rewiring of a
+vertex changes its out-neighbours, which the colouring cannot know in advance.
+The sequence is therefore cut at the first repeated vertex (see batch_end).
+*/
+template<typename NWType>
+class ConflictColouring {
+public:
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+private:
+    // the level of the vertices in the batch, and the highest level of a
+    // batch vertex pointing to each vertex; -1 if there is none
+    std::vector<int> _level;
+    std::vector<int> _in_level;
+    std::vector<vertex> _touched;
+
+    // the revisions of each level, as indices into the batch
+    std::vector<std::vector<std::size_t>> _levels;
+
+public:
+    explicit ConflictColouring(std::size_t num_vertices)
+    :
+        _level(num_vertices, -1),
+        _in_level(num_vertices, -1)
+    { }
+
+    /// The end of the longest prefix of [first, last) without repetitions
+    template<typename It>
+    It batch_end(It first, It last) {
+        It it = first;
+        for (; it != last; ++it) {
+            if (_level[*it] == -2) {
+                break;
+            }
+            _level[*it] = -2;
+        }
+        for (It jt = first; jt != it; ++jt) {
+            _level[*jt] = -1;
+        }
+        return it;
+    }
+
+    /// Assign the levels of a batch of distinct vertices
+    template<typename It>
+    void colour(It first, It last, const NWType& nw) {
+        for (auto& l : _levels) {
+            l.clear();
+        }
+
+        std::size_t i = 0;
+        for (It it = first; it != last; ++it, ++i) {
+            const vertex v = *it;
+
+            int lvl = _in_level[v] + 1;
+            for (auto [w, w_end] = adjacent_vertices(v, nw); w!=w_end; ++w) {
+                lvl = std::max(lvl, _level[*w] + 1);
+            }
+
+            _level[v] = lvl;
+            _touched.push_back(v);
+            for (auto [w, w_end] = adjacent_vertices(v, nw); w!=w_end; ++w) {
+                if (_in_level[*w] == -1) {
+                    _touched.push_back(*w);
+                }
+                _in_level[*w] = std::max(_in_level[*w], lvl);
+            }
+
+            if (std::size_t(lvl) >= _levels.size()) {
+                _levels.resize(lvl + 1);
+            }
+            _levels[lvl].push_back(i);
+        }
+
+        // reset the marks for the next batch
+        for (const vertex v : _touched) {
+            _level[v] = -1;
+            _in_level[v] = -1;
+        }
+        _touched.clear();
+
+        while (not _levels.empty() and _levels.back().empty()) {
+            _levels.pop_back();
+        }
+    }
+
+    /// The levels of the last coloured batch, to be executed in order
+    const std::vector<std::vector<std::size_t>>& levels() const {
+        return _levels;
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_PARALLEL
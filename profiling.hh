@@ -0,0 +1,205 @@
+#ifndef UTOPIA_MODELS_OPDYN_PROFILING
+#define UTOPIA_MODELS_OPDYN_PROFILING
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Utopia::Models::OpDyn::profiling {
+
+/*! Timers of the phases of the model and counters of events in them. They
+are only compiled in if OPDYN_PROFILING is defined (see the CMake option of
+the same name); otherwise, the timers and count() are empty and optimised
+away, and nothing is recorded.
+
+The model times its phases with Timer objects on its own Profile. The kernels
+of revision.hh and ageing.hh count events with count(), which adds to the
+Profile bound to the calling thread (see Bind), if any. Both may be used from
+several threads at once, e.g. from the thread pool or the asynchronous
+writer.
+*/
+
+#ifdef OPDYN_PROFILING
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+/// The timed phases; the revisions and the ageing are part of a step
+enum class Phase : std::size_t {
+    step,
+    user_revision,
+    information_revision,
+    media_revision,
+    ageing,
+    snapshot,
+    write,
+    checkpoint
+};
+
+inline constexpr std::size_t num_phases = 8;
+
+inline constexpr std::array<const char*, num_phases> phase_names = {
+    "step", "user_revision", "information_revision", "media_revision",
+    "ageing", "snapshot", "write", "checkpoint"
+};
+
+/// The counted events
+enum class Counter : std::size_t {
+    revisions,                  ///< Revisions of the model
+    user_revisions,             ///< User revisions, two per revision
+    rewirings,                  ///< Edges rewired in the user revisions
+    noop_interactions,          ///< User interactions without opinion change
+    noop_media_interactions,    ///< Media beyond the tolerance of the user
+    nan_weights,                ///< Normalisations with a NaN weight sum
+    zero_weights,               ///< Normalisations with all weights zero
+    ageing_children,            ///< Users reinitialised as children
+    ageing_parents,             ///< Parents found for them
+    ageing_peers                ///< Peers found for them
+};
+
+inline constexpr std::size_t num_counters = 10;
+
+inline constexpr std::array<const char*, num_counters> counter_names = {
+    "revisions", "user_revisions", "rewirings", "noop_interactions",
+    "noop_media_interactions", "nan_weights", "zero_weights",
+    "ageing_children", "ageing_parents", "ageing_peers"
+};
+
+/// A copy of the values of a Profile at one time
+struct Summary {
+    std::array<std::uint64_t, num_phases> nanoseconds = {};
+    std::array<std::uint64_t, num_phases> calls = {};
+    std::array<std::uint64_t, num_counters> counts = {};
+
+    double seconds(const Phase phase) const {
+        return 1e-9 * double(nanoseconds[std::size_t(phase)]);
+    }
+
+    std::uint64_t count(const Counter counter) const {
+        return counts[std::size_t(counter)];
+    }
+};
+
+/// The total time and number of calls of each phase, and the counters
+class Profile {
+    std::array<std::atomic<std::uint64_t>, num_phases> _nanoseconds;
+    std::array<std::atomic<std::uint64_t>, num_phases> _calls;
+    std::array<std::atomic<std::uint64_t>, num_counters> _counts;
+
+public:
+    Profile() {
+        for (std::size_t i=0; i<num_phases; ++i) {
+            _nanoseconds[i] = 0;
+            _calls[i] = 0;
+        }
+        for (auto& c : _counts) {
+            c = 0;
+        }
+    }
+
+    Profile(const Profile&) = delete;
+    Profile& operator=(const Profile&) = delete;
+
+    void add_time(const Phase phase, const std::uint64_t nanoseconds) {
+        const auto i = std::size_t(phase);
+        _nanoseconds[i].fetch_add(nanoseconds, std::memory_order_relaxed);
+        _calls[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void add(const Counter counter, const std::uint64_t n) {
+        _counts[std::size_t(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    Summary summary() const {
+        Summary s;
+        for (std::size_t i=0; i<num_phases; ++i) {
+            s.nanoseconds[i] = _nanoseconds[i].load(std::memory_order_relaxed);
+            s.calls[i] = _calls[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t i=0; i<num_counters; ++i) {
+            s.counts[i] = _counts[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+};
+
+/// The profile that count() adds to on the calling thread; nullptr if none
+inline Profile*& current() {
+    static thread_local Profile* profile = nullptr;
+    return profile;
+}
+
+/// Binds a profile to the calling thread for the lifetime of this object
+class Bind {
+#ifdef OPDYN_PROFILING
+    Profile* const _previous;
+
+public:
+    explicit Bind(Profile* profile)
+    :
+        _previous(current())
+    {
+        current() = profile;
+    }
+
+    ~Bind() {
+        current() = _previous;
+    }
+#else
+public:
+    explicit Bind(Profile*) {}
+#endif
+
+    Bind(const Bind&) = delete;
+    Bind& operator=(const Bind&) = delete;
+};
+
+/// Add n events to the counter of the profile bound to this thread
+inline void count([[maybe_unused]] const Counter counter,
+                  [[maybe_unused]] const std::uint64_t n = 1)
+{
+    if constexpr (enabled) {
+        if (auto profile = current()) {
+            profile->add(counter, n);
+        }
+    }
+}
+
+/// Adds the time from its construction to its destruction to a phase
+class Timer {
+#ifdef OPDYN_PROFILING
+    using Clock = std::chrono::steady_clock;
+
+    Profile& _profile;
+    const Phase _phase;
+    const Clock::time_point _start;
+
+public:
+    Timer(Profile& profile, const Phase phase)
+    :
+        _profile(profile),
+        _phase(phase),
+        _start(Clock::now())
+    { }
+
+    ~Timer() {
+        const auto elapsed = Clock::now() - _start;
+        _profile.add_time(_phase,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count());
+    }
+#else
+public:
+    Timer(Profile&, Phase) {}
+#endif
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_PROFILING
@@ -4,13 +4,22 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <stdlib.h>
 #include <spdlog/spdlog.h>
 
+#include "events.hh"
 #include "modes.hh"
+#include "parallel.hh"
+#include "profiling.hh"
+#include "rewiring.hh"
+#include "sampling.hh"
+#include "streams.hh"
 #include "update.hh"
 #include "utils.hh"
 
@@ -20,6 +29,16 @@ using modes::Mode;
 using modes::Mode::Ageing;
 using modes::Mode::Ageing_and_Media;
 
+// The edge property of NWType with the weight w, which is rounded if the
+// weights are of float (see OpDyn)
+template<typename NWType>
+auto weight(const double w) {
+    using edge = typename boost::graph_traits<NWType>::edge_descriptor;
+    using Weight = std::decay_t<decltype(std::declval<NWType&>()[
+                                                    std::declval<edge>()])>;
+    return Weight{static_cast<decltype(Weight::attr)>(w)};
+}
+
 // STEP FUNCTIONS ..............................................................
 
 template <typename VertexDescType, typename NWType, typename RNGType>
@@ -28,24 +47,16 @@ void pairwise_weighted_update(
                 NWType& nw,
                 std::uniform_real_distribution<double>& prob_distr,
                 RNGType& rng,
-                const double radicalisation_parameter)
+                const double radicalisation_parameter,
+                sampling::NeighbourSampler<NWType>& nb_sampler)
 {
-    auto nb = v;
-
 // Choose interaction partner. The probability for choosing neighbour w
-// is given by the weight on the edge (v, w).
+// is given by the weight on the edge (v, w) relative to the weight sum of v;
+// the sampler finds it by binary search over the cumulative weights of v.
 
     double nb_prob_frac = prob_distr(rng);
-    double cumulative_weights = 0.;
-    for (auto [w, w_end] = adjacent_vertices(v, nw); w!=w_end; ++w) {
-        if (cumulative_weights < nb_prob_frac) {
-            cumulative_weights += nw[edge(v, *w, nw).first].attr;
-        }
-        if (cumulative_weights >= nb_prob_frac) {
-            nb = *w;
-            break;
-        }
-    }
+    VertexDescType nb = nb_sampler.sample(v, nb_prob_frac * nw[v].weight_sum,
+                                          nw);
 
 // The opinion update takes the tolerance and the susceptibility into account.
 // The tolerance is updated by considering the change in opinion distance
@@ -55,6 +66,9 @@ void pairwise_weighted_update(
 
     //Opinion update
     update::opinion(v, nb, nw);
+    if (nw[v].opinion == old_opinion) {
+        profiling::count(profiling::Counter::noop_interactions);
+    }
 
     //Tolerance update
     update::tolerance(v, nw, old_opinion, radicalisation_parameter);
@@ -62,135 +76,270 @@ void pairwise_weighted_update(
 }
 
 // The weights are updated proportionally to the distance from a neighbour's
-// opinion to the user's current opinion.
+// opinion to the user's current opinion. The targets of the edges that are to
+// be cut are collected in to_drop, and the sum of the reduced weights is
+// returned in sum_of_reduced_weights. The cumulative weights of v in the
+// neighbour sampler are refilled along the way, so they stay valid unless
+// edges are cut or the weights are rescaled.
 template<Mode model_mode, typename NWType, typename VertexDescType, typename RNGType>
-void update_weights(VertexDescType v,
+void reduce_weights(VertexDescType v,
                     NWType& nw,
                     const double weighting,
                     const double rewiring,
-                    unsigned int rewiring_count,
-                    std::uniform_real_distribution<double> prob_distr,
-                    RNGType& rng)
+                    std::uniform_real_distribution<double>& prob_distr,
+                    RNGType& rng,
+                    sampling::NeighbourSampler<NWType>& nb_sampler,
+                    std::vector<VertexDescType>& to_drop,
+                    double& sum_of_reduced_weights)
 {
-
-    if (out_degree(v, nw) != 0) {
-        // Reduce weight dependent on the opinion distance and identify
-        // edges that will be cut.
-        std::vector<VertexDescType> to_drop;
-        double sum_of_reduced_weights = 0.;
-
-        auto [e, e_end] = out_edges(v, nw);
-        for (auto next = e; e!=e_end; e = next) {
-            ++next;
-
-            // If opinion distance is larger than tolerance, rewire with
-            // probability 'rewiring'.
-            if (fabs(nw[target(*e, nw)].opinion - nw[source(*e, nw)].opinion)
-                                > nw[source(*e, nw)].tolerance) {
-                if (prob_distr(rng) < rewiring) {
-                    to_drop.push_back(target(*e, nw));
-                }
-            }
-
-            // Change weight proportionally to the opinion distance and the age difference.
-            // Both factors are weighted by 50%.
-            // NOTE that for weighting > 1, weights can reach Zero.
-            if constexpr (model_mode == Mode::Ageing or Mode::Ageing_and_Media) {
-              nw[*e].attr *= (1. - weighting
-                              * fabs(nw[target(*e, nw)].opinion - nw[v].opinion))
-                              + std::exp(std::log(0.5)/0.5
-                              *fabs(nw[target(*e, nw)].age - nw[v].age)/nw[v].age);
-            }
-            else {
-              nw[*e].attr *= (1. - weighting
-                              * fabs(nw[target(*e, nw)].opinion - nw[v].opinion));
+    sum_of_reduced_weights = 0.;
+    nb_sampler.begin(v);
+
+    for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+
+        // If opinion distance is larger than tolerance, rewire with
+        // probability 'rewiring'.
+        if (not update::within(nw[target(*e, nw)].opinion,
+                               nw[source(*e, nw)].opinion,
+                               nw[source(*e, nw)].tolerance)) {
+            if (prob_distr(rng) < rewiring) {
+                to_drop.push_back(target(*e, nw));
             }
+        }
 
-            if (nw[*e].attr < 0.) {
-                nw[*e].attr = 0.;
-            }
+        // Change weight proportionally to the opinion distance and the age difference.
+        // Both factors are weighted by 50%.
+        // NOTE that for weighting > 1, weights can reach Zero.
+        if constexpr (model_mode == Mode::Ageing or Mode::Ageing_and_Media) {
+          nw[*e].attr *= (1. - weighting
+                          * fabs(nw[target(*e, nw)].opinion - nw[v].opinion))
+                          + std::exp(std::log(0.5)/0.5
+                          *fabs(nw[target(*e, nw)].age - nw[v].age)/nw[v].age);
+        }
+        else {
+          nw[*e].attr *= (1. - weighting
+                          * fabs(nw[target(*e, nw)].opinion - nw[v].opinion));
+        }
 
-            sum_of_reduced_weights += nw[*e].attr;
+        if (nw[*e].attr < 0.) {
+            nw[*e].attr = 0.;
         }
 
-        // Try to find suitable new neighbors for rewiring.
-        std::vector<VertexDescType> to_add;
-        for (size_t i=0; i!=to_drop.size(); i++) {
+        sum_of_reduced_weights += nw[*e].attr;
+        nb_sampler.push(v, nw[*e].attr, target(*e, nw));
+    }
+}
+
+// Cut the edges from v to the vertices in to_drop and try to find suitable
+// new neighbours to rewire to: a neighbour of a neighbour of v (triadic
+// closure), else a random vertex. Returns the number of edges rewired. If
+// given, the removed and added edges are recorded in the edge log. The
+// neighbours are drawn from the scratch space and the neighbour sampler, and
+// the membership tests are marks in the scratch space (see rewiring::Scratch),
+// which costs O(out-degree) per rewiring; nothing is done beyond setting the
+// weight sum if there is nothing to drop. The weights of the new edges are
+// relative to the weight sum of v before the reduction; the weight sum is
+// then set to that of the reduced and the new weights.
+template<typename NWType, typename VertexDescType, typename RNGType>
+std::size_t rewire_edges(VertexDescType v,
+                         NWType& nw,
+                         const std::vector<VertexDescType>& to_drop,
+                         double sum_of_reduced_weights,
+                         RNGType& rng,
+                         sampling::NeighbourSampler<NWType>& nb_sampler,
+                         rewiring::Scratch<NWType>& scratch,
+                         events::EdgeLog* edge_log = nullptr)
+{
+    using Scratch = rewiring::Scratch<NWType>;
 
-            auto w = utils::get_rand_nb(nw, v, rng);
-            if (std::find(  to_drop.begin(),
-                            to_drop.end(), w) == to_drop.end()) {
-                if (out_degree(w, nw) != 0) {
-                    w = utils::get_rand_nb(nw, w, rng);
-                }
-                if (edge(v, w, nw).second or (v==w)) {
-                    w = random_vertex(nw, rng);
-                }
+    if (to_drop.empty()) {
+        nw[v].weight_sum = sum_of_reduced_weights;
+        return 0;
+    }
+
+    scratch.begin(v, nw, to_drop);
+    auto& to_add = scratch.to_add();
+    for (size_t i=0; i!=to_drop.size(); i++) {
+
+        auto w = scratch.random_neighbour(v, nw, rng);
+        if (not scratch.is(w, Scratch::dropped)) {
+            if (out_degree(w, nw) != 0) {
+                w = nb_sampler.neighbour(w,
+                        utils::get_rand_int<RNGType>(0, out_degree(w, nw),
+                                                     rng),
+                        nw);
             }
-            else {
+            if (scratch.is(w, Scratch::neighbour) or (v==w)) {
                 w = random_vertex(nw, rng);
             }
+        }
+        else {
+            w = random_vertex(nw, rng);
+        }
 
-            if ((not edge(v, w, nw).second)
-                and (std::find( to_add.begin(),
-                                to_add.end(), w) == to_add.end())
-                and (v!=w)) {
-
-                to_add.push_back(w);
-                sum_of_reduced_weights -=
-                                nw[edge(v, to_drop[i], nw).first].attr;
-                remove_edge(v, to_drop[i], nw);
+        if ((not scratch.is(w, Scratch::neighbour))
+            and (not scratch.is(w, Scratch::added))
+            and (v!=w)) {
+
+            to_add.push_back(w);
+            scratch.mark(w, Scratch::added);
+            sum_of_reduced_weights -=
+                            nw[edge(v, to_drop[i], nw).first].attr;
+            remove_edge(v, to_drop[i], nw);
+            scratch.remove_neighbour(to_drop[i]);
+            if (edge_log) {
+                edge_log->remove(v, to_drop[i]);
             }
         }
+    }
 
-        // Determine the initial weight which is given to the added edges.
-        double init_weight = 0.;
-        if (out_degree(v, nw) != 0) {
-            // precision threshold due to possible rounding errors
-            if (sum_of_reduced_weights < 10e-5) {
-                init_weight = 1. / double(to_add.size());
-            }
-            else {
-                init_weight = sum_of_reduced_weights
-                                / double(out_degree(v, nw));
-            }
+    // Determine the initial weight which is given to the added edges. The
+    // weights are on the scale of the previous weight sum, as if normalised;
+    // if all weights had vanished, the scale is that of normalised weights.
+    const double scale = (nw[v].weight_sum > 0.) ? double(nw[v].weight_sum)
+                                                 : 1.;
+    double init_weight = 0.;
+    if (out_degree(v, nw) != 0) {
+        // precision threshold due to possible rounding errors
+        if (sum_of_reduced_weights < 10e-5 * scale) {
+            init_weight = scale / double(to_add.size());
         }
         else {
-            init_weight = 1. / double(to_add.size());
+            init_weight = sum_of_reduced_weights
+                            / double(out_degree(v, nw));
         }
+    }
+    else {
+        init_weight = scale / double(to_add.size());
+    }
 
-        for (size_t i=0; i!=to_add.size(); i++) {
-            add_edge(v, to_add[i], {init_weight}, nw);
-            rewiring_count ++;
+    const auto added = weight<NWType>(init_weight);
+    for (size_t i=0; i!=to_add.size(); i++) {
+        add_edge(v, to_add[i], added, nw);
+        if (edge_log) {
+            edge_log->add(v, to_add[i]);
         }
     }
+    nw[v].weight_sum = sum_of_reduced_weights
+                       + double(to_add.size()) * double(added.attr);
+    profiling::count(profiling::Counter::rewirings, to_add.size());
+    return to_add.size();
+}
+
+// The weights are updated (see reduce_weights) and edges to far-off
+// neighbours are rewired (see rewire_edges). Returns whether any edge of v
+// has been rewired, after which its cached cumulative weights are outdated.
+template<Mode model_mode, typename NWType, typename VertexDescType, typename RNGType>
+bool update_weights(VertexDescType v,
+                    NWType& nw,
+                    const double weighting,
+                    const double rewiring,
+                    unsigned int& rewiring_count,
+                    std::uniform_real_distribution<double> prob_distr,
+                    RNGType& rng,
+                    sampling::NeighbourSampler<NWType>& nb_sampler,
+                    rewiring::Scratch<NWType>& scratch,
+                    events::EdgeLog* edge_log = nullptr)
+{
+
+    std::size_t rewired = 0;
+
+    if (out_degree(v, nw) != 0) {
+        auto& to_drop = scratch.to_drop();
+        to_drop.clear();
+        double sum_of_reduced_weights = 0.;
+
+        reduce_weights<model_mode>(v, nw, weighting, rewiring, prob_distr,
+                                   rng, nb_sampler, to_drop,
+                                   sum_of_reduced_weights);
+
+        rewired = rewire_edges(v, nw, to_drop, sum_of_reduced_weights, rng,
+                               nb_sampler, scratch, edge_log);
+        rewiring_count += rewired;
+    }
+
+    return rewired != 0;
 }
 
 
-// This function normalizes the weights of vertex v to 1.
+// The sum of the weights of v, which is also set as its weight sum, e.g.
+// after the weights have been set directly. O(out-degree).
 template<typename VertexDescType, typename NWType>
-void normalize_weights(VertexDescType v, NWType& nw) {
+double sum_weights(VertexDescType v, NWType& nw) {
+    double sum = 0.;
+    for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+        sum += nw[*e].attr;
+    }
+    nw[v].weight_sum = sum;
+    return sum;
+}
+
+// Sets the weight of the out-edge e of v to zero, before it is cut, and
+// removes it from the weight sum of v. If most of the sum is removed, the
+// difference would be mostly rounding, so the sum is taken anew.
+template<typename VertexDescType, typename EdgeDescType, typename NWType>
+void remove_weight(VertexDescType v, EdgeDescType e, NWType& nw) {
+    const double weight_sum = nw[v].weight_sum;
+    const double remaining = weight_sum - nw[e].attr;
+    nw[e].attr = 0.;
+    if (remaining > 1e-3 * weight_sum) {
+        nw[v].weight_sum = remaining;
+    }
+    else {
+        sum_weights(v, nw);
+    }
+}
+
+// Adds the edge from v to w with a weight on the scale of normalised weights,
+// i.e. scaled by the weight sum of v, and adds it to the sum. The weights of
+// v then are as if they had been normalised before adding the edge.
+template<typename VertexDescType, typename NWType>
+void add_relative_edge(VertexDescType v, VertexDescType w, double w_vw,
+                       NWType& nw)
+{
+    const double scale = (nw[v].weight_sum > 0.) ? double(nw[v].weight_sum)
+                                                 : 1.;
+    const auto added = weight<NWType>(w_vw * scale);
+    add_edge(v, w, added, nw);
+    nw[v].weight_sum += added.attr;
+}
+
+// The weights of v are not normalised after each revision: the partners are
+// drawn against the weight sum of v (see pairwise_weighted_update), which the
+// weight update and the rewiring keep. This function checks the weight sum for
+// NaN and all-zero weights in O(1), and only rescales the weights to the sum 1
+// once the sum leaves [2^-32, 2^32], before the weights would under- or
+// overflow. Returns whether the weights have changed.
+template<typename VertexDescType, typename NWType>
+bool normalize_weights(VertexDescType v, NWType& nw) {
     const auto log = spdlog::get("root.OpDyn");
 
-    if (out_degree(v, nw) != 0) {
-        double weight_norm = 0.;
-        for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
-            weight_norm += nw[*e].attr;
-        }
+    if (out_degree(v, nw) == 0) {
+        return false;
+    }
 
-        if (weight_norm != 0.) {
-            for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
-                  nw[*e].attr /= weight_norm;
-                // This should be part of a test case...
-                if (std::isnan(nw[*e].attr)) {
-                  log->error("NAN weight!");
-                }
-            }
-        }
-        else {
-            log->warn("All weights are Zero! This node's age: {}", nw[v].age );
-        }
+    const double weight_norm = nw[v].weight_sum;
+    if (std::isnan(weight_norm)) {
+        log->error("NAN weight!");
+        profiling::count(profiling::Counter::nan_weights);
+        return false;
+    }
+    if (not (weight_norm > 0.)) {
+        log->warn("All weights are Zero! This node's age: {}", nw[v].age );
+        profiling::count(profiling::Counter::zero_weights);
+        return false;
+    }
+    if (weight_norm >= 0x1p-32 and weight_norm <= 0x1p32) {
+        return false;
     }
+
+    double sum = 0.;
+    for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+        nw[*e].attr /= weight_norm;
+        sum += nw[*e].attr;
+    }
+    nw[v].weight_sum = sum;
+    return true;
 }
 
 double make_periodic(double val) {
@@ -211,15 +360,18 @@ double distance_periodic(double x, double y) {
 }
 
 // normalize ad values so that the ad fractions represent
-// interaction probabilities
+// interaction probabilities. The revisions sample from the raw ad values
+// (see sampling::FenwickTree), so the fractions are only computed for the
+// output, into ad_fractions.
 template<typename NWType_m>
-void normalize_ads(NWType_m& nw_m) {
+void normalize_ads(const NWType_m& nw_m, std::vector<double>& ad_fractions) {
     double sum = 0.;
     for (auto [v, v_end] = vertices(nw_m); v!=v_end; ++v) {
         sum += nw_m[*v].ads;
     }
+    ad_fractions.clear();
     for (auto [v, v_end] = vertices(nw_m); v!=v_end; ++v) {
-        nw_m[*v].ads_normalized = nw_m[*v].ads/sum;
+        ad_fractions.push_back(nw_m[*v].ads/sum);
     }
 }
 
@@ -238,7 +390,7 @@ std::pair<double,bool> user_char_BC(    double own_opinion,
         }
     }
     else {
-        if (fabs(new_opinion - own_opinion) <= tolerance) {
+        if (update::within(new_opinion, own_opinion, tolerance)) {
             return std::make_pair(1., true);
         }
         else {
@@ -254,17 +406,23 @@ std::pair<double,bool> user_char_BC(    double own_opinion,
 // processes: user-revision, information-revision (between users and media)
 // and media-revision.
 
-template<Mode model_mode, typename NWType, typename RNGType>
-void user_revision( NWType& nw_u,
+// The revision of user v: the opinion update with a partner drawn by the
+// weights, and the update of the weights and the rewiring.
+template<Mode model_mode, typename NWType, typename VertexDescType,
+         typename RNGType>
+void revise_user(   VertexDescType v,
+                    NWType& nw_u,
                     double weighting,
                     double rewiring,
                     unsigned int& rewiring_count,
-                    std::uniform_real_distribution<double> prob_distr,
+                    std::uniform_real_distribution<double>& prob_distr,
                     double radicalisation_parameter,
-                    RNGType& rng) {
+                    RNGType& rng,
+                    sampling::NeighbourSampler<NWType>& nb_sampler,
+                    rewiring::Scratch<NWType>& scratch,
+                    events::EdgeLog* edge_log = nullptr) {
 
-    // choose random vertex that gets a revision opportunity
-    auto v = random_vertex(nw_u, rng);
+    profiling::count(profiling::Counter::user_revisions);
 
     if (out_degree(v, nw_u) != 0) {
 
@@ -273,25 +431,192 @@ void user_revision( NWType& nw_u,
                                     nw_u,
                                     prob_distr,
                                     rng,
-                                    radicalisation_parameter);
+                                    radicalisation_parameter,
+                                    nb_sampler);
 
 //update the weights depending on the opinion distance
-        update_weights<model_mode>( v,
+        const bool rewired = update_weights<model_mode>( v,
                         nw_u,
                         weighting,
                         rewiring,
                         rewiring_count,
                         prob_distr,
-                        rng);
+                        rng,
+                        nb_sampler,
+                        scratch,
+                        edge_log);
+
+        const bool normalized = normalize_weights(v, nw_u);
+
+        // the partner of the next revision of v is drawn from the new weights,
+        // which are already in the sampler unless the edges or scale changed
+        if (rewired or normalized) {
+            nb_sampler.invalidate(v);
+        }
+    }
+}
+
+// The revision of a user drawn uniformly at random (see revise_user)
+template<Mode model_mode, typename NWType, typename RNGType>
+void user_revision( NWType& nw_u,
+                    double weighting,
+                    double rewiring,
+                    unsigned int& rewiring_count,
+                    std::uniform_real_distribution<double> prob_distr,
+                    double radicalisation_parameter,
+                    RNGType& rng,
+                    sampling::NeighbourSampler<NWType>& nb_sampler,
+                    rewiring::Scratch<NWType>& scratch,
+                    events::EdgeLog* edge_log = nullptr) {
+
+    // choose random vertex that gets a revision opportunity
+    auto v = random_vertex(nw_u, rng);
+    revise_user<model_mode>(v, nw_u, weighting, rewiring, rewiring_count,
+                            prob_distr, radicalisation_parameter, rng,
+                            nb_sampler, scratch, edge_log);
+}
 
+/*! The buffers of parallel_user_revision, kept from one batch to the next,
+so that the parallel revisions do not allocate once the buffers have grown to
+the largest batch and level.
+*/
+template<typename NWType>
+struct BatchScratch {
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+    /// The random number stream of each revision in the batch
+    std::vector<streams::Philox4x32> revision_rngs;
+
+    /// The edges to cut and the reduced weight sum of each revision in a
+    /// level
+    std::vector<std::vector<vertex>> to_drop;
+    std::vector<double> sum_of_reduced_weights;
+};
+
+/*! Revises the users in batch in order, and with the same result as a
+sequence of user_revision calls for these users would have (though with
+different random numbers). The batch is split at repeated users, each part is
+split into levels of non-conflicting revisions (see
+parallel::ConflictColouring), and each level is revised concurrently on the
+thread pool. The opinion and weight updates run in parallel; the structural
+part of the rewiring changes shared adjacency storage and is done
+sequentially after each level, in the one scratch space, and the rewired
+edges are added to rewiring_count. The buffers of the batch are kept in
+batch_scratch.
+
+The revision at position i of the batch draws all its random numbers from
+the stream (seed, step, i) of the user revision phase, so the result does not
+depend on the number of threads.
+*/
+template<Mode model_mode, typename NWType>
+void parallel_user_revision(
+                    NWType& nw_u,
+                    const std::vector<typename boost::graph_traits<NWType>::
+                                      vertex_descriptor>& batch,
+                    double weighting,
+                    double rewiring,
+                    unsigned int& rewiring_count,
+                    std::uniform_real_distribution<double> prob_distr,
+                    double radicalisation_parameter,
+                    const std::uint64_t seed,
+                    const std::uint64_t step,
+                    sampling::NeighbourSampler<NWType>& nb_sampler,
+                    parallel::ConflictColouring<NWType>& colouring,
+                    rewiring::Scratch<NWType>& scratch,
+                    BatchScratch<NWType>& batch_scratch,
+                    parallel::ThreadPool& pool,
+                    events::EdgeLog* edge_log = nullptr)
+{
+    // the random number stream of each revision in the batch
+    auto& revision_rngs = batch_scratch.revision_rngs;
+    revision_rngs.clear();
+    for (std::size_t i=0; i!=batch.size(); ++i) {
+        revision_rngs.push_back(streams::stream(seed, step, i,
+                                            streams::Phase::user_revision));
+    }
+    profiling::count(profiling::Counter::user_revisions, batch.size());
+
+    // the workers count into the profile of the calling thread
+    const auto profile = profiling::current();
+
+    // the edges to cut and the reduced weight of each revision in a level
+    auto& to_drop = batch_scratch.to_drop;
+    auto& sum_of_reduced_weights = batch_scratch.sum_of_reduced_weights;
+
+    auto first = batch.begin();
+    while (first != batch.end()) {
+        const auto last = colouring.batch_end(first, batch.end());
+        colouring.colour(first, last, nw_u);
+
+        for (const auto& level : colouring.levels()) {
+            to_drop.resize(std::max(to_drop.size(), level.size()));
+            sum_of_reduced_weights.assign(level.size(), 0.);
+
+            pool.parallel_for(level.size(), [&](std::size_t i, std::size_t){
+                const profiling::Bind bind(profile);
+                const std::size_t pos = (first - batch.begin()) + level[i];
+                auto v = batch[pos];
+                to_drop[i].clear();
+                if (out_degree(v, nw_u) == 0) {
+                    return;
+                }
+                auto& revision_rng = revision_rngs[pos];
+                auto thread_distr = prob_distr;
+
+                pairwise_weighted_update(v,
+                                         nw_u,
+                                         thread_distr,
+                                         revision_rng,
+                                         radicalisation_parameter,
+                                         nb_sampler);
+
+                // the weight update only refills the sampler cache of v
+                reduce_weights<model_mode>(v,
+                                           nw_u,
+                                           weighting,
+                                           rewiring,
+                                           thread_distr,
+                                           revision_rng,
+                                           nb_sampler,
+                                           to_drop[i],
+                                           sum_of_reduced_weights[i]);
+
+                // without rewiring, the revision can be completed right away
+                if (to_drop[i].empty()) {
+                    nw_u[v].weight_sum = sum_of_reduced_weights[i];
+                    if (normalize_weights(v, nw_u)) {
+                        nb_sampler.invalidate(v);
+                    }
+                }
+            });
 
-        normalize_weights(v, nw_u);
+            for (std::size_t i=0; i!=level.size(); ++i) {
+                if (to_drop[i].empty()) {
+                    continue;
+                }
+                const std::size_t pos = (first - batch.begin()) + level[i];
+                const auto v = batch[pos];
+                const auto rewired = rewire_edges(v, nw_u, to_drop[i],
+                                                  sum_of_reduced_weights[i],
+                                                  revision_rngs[pos],
+                                                  nb_sampler, scratch,
+                                                  edge_log);
+                rewiring_count += rewired;
+                const bool normalized = normalize_weights(v, nw_u);
+                if (rewired != 0 or normalized) {
+                    nb_sampler.invalidate(v);
+                }
+            }
+        }
 
+        first = last;
     }
 }
 
 template<typename NWType_m, typename RNGType>
-void media_revision(NWType_m& nw_m, RNGType& rng) {
+void media_revision(NWType_m& nw_m,
+                    RNGType& rng,
+                    sampling::FenwickTree& ads_tree) {
 
 // choose random vertex for revision
     auto v = random_vertex(nw_m, rng);
@@ -307,7 +632,8 @@ void media_revision(NWType_m& nw_m, RNGType& rng) {
         auto fittest_nb = v;
         bool found = false;
         for (auto [w, w_end] = adjacent_vertices(v, nw_m); w!=w_end; ++w) {
-            if (fabs(nw_m[v].opinion - nw_m[*w].opinion) <= nw_m[v].tolerance
+            if (update::within(nw_m[v].opinion, nw_m[*w].opinion,
+                               nw_m[v].tolerance)
                 && nw_m[*w].users > nw_m[fittest_nb].users) {
                   fittest_nb = *w;
                   found = true;
@@ -315,7 +641,8 @@ void media_revision(NWType_m& nw_m, RNGType& rng) {
         }
 // a medium shifts its stance towards the more popular competitor.
         if (found) {
-            if(fabs(nw_m[v].opinion-nw_m[fittest_nb].opinion)>nw_m[v].tolerance/3) {
+            if(not update::within(nw_m[v].opinion, nw_m[fittest_nb].opinion,
+                                  nw_m[v].tolerance/3.)) {
               nw_m[v].opinion += nw_m[v].susceptibility
                               * nw_m[edge(v, fittest_nb, nw_m).first].attr
                               * (nw_m[fittest_nb].opinion - nw_m[v].opinion);
@@ -327,7 +654,7 @@ void media_revision(NWType_m& nw_m, RNGType& rng) {
                   sgn = -1;
               }
               if (nw_m[v].opinion == nw_m[fittest_nb].opinion) {
-                sgn = rand() % 2;
+                sgn = utils::get_rand_int(0, 2, rng);
                 sgn = 2*sgn-1;
               }
               nw_m[v].opinion = nw_m[fittest_nb].opinion +
@@ -347,10 +674,7 @@ void media_revision(NWType_m& nw_m, RNGType& rng) {
 // The more users a medium has, the more it can spend on ads,
 //which increases its presence
     nw_m[v].ads = nw_m[v].users;
-// normalize advertisment values to probabilities
-    normalize_ads(nw_m);
-// store current user number for comparison at the next revision opportunity
-    nw_m[v].users_previous = nw_m[v].users;
+    ads_tree.set(v, nw_m[v].ads);
 }
 
     enum class UserChartype {
@@ -359,31 +683,23 @@ void media_revision(NWType_m& nw_m, RNGType& rng) {
         gaussian
     };
 
+// The information revision of a user drawn uniformly at random. Returns the
+// user and its opinion before the revision.
 template<typename NWType_u, typename NWType_m, typename RNGType>
-void information_revision(  NWType_u& nw_u,
+std::pair<typename boost::graph_traits<NWType_u>::vertex_descriptor, double>
+information_revision(       NWType_u& nw_u,
                             NWType_m& nw_m,
                             std::uniform_real_distribution<double> prob_distr,
                             const double radicalisation_parameter,
-                            RNGType& rng) {
+                            RNGType& rng,
+                            const sampling::FenwickTree& ads_tree) {
 
     auto v = random_vertex(nw_u, rng);
-    size_t new_medium = 0;
-    bool found = false;
 
     // choose new medium. The probability for choosing medium i is given by the
     // ad-fraction of medium i.
     double new_medium_ad_fraction = prob_distr(rng);
-    double sum_ad_fraction = 0.;
-    for (auto [m, m_end] = vertices(nw_m); m!=m_end; ++m) {
-        if (sum_ad_fraction < new_medium_ad_fraction) {
-            sum_ad_fraction += nw_m[*m].ads_normalized;
-        }
-        if (sum_ad_fraction >= new_medium_ad_fraction) {
-            new_medium = *m;
-            found = true;
-            break;
-        }
-    }
+    size_t new_medium = ads_tree.sample(new_medium_ad_fraction);
 
     std::pair<double, bool> user_char = user_char_BC(   nw_u[v].opinion,
                                     nw_m[new_medium].opinion,
@@ -393,18 +709,24 @@ void information_revision(  NWType_u& nw_u,
 // If so, switch to the new medium. The user is also influenced in her
 // opinion if the medium's opinion is close enough.
 // Users changing their opinions also leads to a change in user tolerance
+    if (not user_char.second) {
+        profiling::count(profiling::Counter::noop_media_interactions);
+    }
     double opinion_old = nw_u[v].opinion;
     if (prob_distr(rng) <= user_char.first) {
         if (user_char.second) {
             update::opinion(v, new_medium, nw_u, nw_m);
         }
 
+
         update::tolerance(v, nw_u, opinion_old, radicalisation_parameter);
 
         nw_m[nw_u[v].used_media].users -= 1;
         nw_m[new_medium].users += 1;
         nw_u[v].used_media = new_medium;
     }
+
+    return {v, opinion_old};
 }
 
 } // namespace
@@ -0,0 +1,156 @@
+#ifndef UTOPIA_MODELS_OPDYN_REWIRING
+#define UTOPIA_MODELS_OPDYN_REWIRING
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "sampling.hh"
+#include "utils.hh"
+
+namespace Utopia::Models::OpDyn::rewiring {
+
+/*! The scratch space of the rewiring (see revision::update_weights and
+revision::rewire_edges), kept from one revision to the next, so that the
+rewiring does not allocate once the buffers have grown to the largest degree.
+
+For the user being rewired, each vertex is marked as an out-neighbour, as a
+target of an edge to drop, and as a target of an edge to add. The marks carry
+the number of the rewiring they belong to, so testing a mark is a single array
+access, and all marks are reset at once by starting the next rewiring. Marking
+the out-neighbours makes begin O(out-degree), so it should only be called if
+there are edges to drop.
+
+If the out-neighbours of the user cannot be indexed, as on the adjacency list,
+they are copied in begin, in the order of its out-edges, with the position of
+each. A removed neighbour stays in the copy, but its position is kept in a
+sorted list, which the draws skip: removing and drawing a neighbour thus take
+O(number of removed edges) rather than O(out-degree), and the neighbours keep
+their order. The drawn neighbours are the same as those of utils::get_rand_nb.
+*/
+template<typename NWType>
+class Scratch {
+public:
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+    /// The marks of a vertex
+    enum Mark : std::uint8_t {
+        neighbour = 1,  ///< An out-neighbour of the user
+        dropped = 2,    ///< The target of an edge to drop
+        added = 4       ///< The target of an edge to add
+    };
+
+private:
+    static constexpr bool random_access_neighbours =
+                                sampling::random_access_adjacency<NWType>;
+
+    // the rewiring the marks of each vertex belong to, and the marks
+    std::vector<std::uint32_t> _rewiring;
+    std::vector<std::uint8_t> _marks;
+    std::uint32_t _current;
+
+    // the out-neighbours of the user, if they cannot be indexed, the
+    // position of each vertex among them, and the sorted positions of the
+    // removed ones
+    std::vector<vertex> _neighbours;
+    std::vector<std::uint32_t> _position;
+    std::vector<std::uint32_t> _removed;
+
+    std::vector<vertex> _to_drop;
+    std::vector<vertex> _to_add;
+
+public:
+    explicit Scratch(std::size_t num_vertices)
+    :
+        _rewiring(num_vertices, 0),
+        _marks(num_vertices, 0),
+        _current(0),
+        _position(random_access_neighbours ? 0 : num_vertices, 0)
+    { }
+
+    /// The targets of the edges to drop, to be filled by the weight update
+    std::vector<vertex>& to_drop() {
+        return _to_drop;
+    }
+
+    /// The targets of the edges to add
+    std::vector<vertex>& to_add() {
+        return _to_add;
+    }
+
+    /// Start the rewiring of v, dropping the edges to the targets in to_drop
+    void begin(const vertex v, const NWType& nw,
+               const std::vector<vertex>& to_drop)
+    {
+        if (++_current == 0) {
+            std::fill(_rewiring.begin(), _rewiring.end(), 0);
+            _current = 1;
+        }
+
+        if constexpr (not random_access_neighbours) {
+            _neighbours.clear();
+            _removed.clear();
+        }
+        for (auto [w, w_end] = adjacent_vertices(v, nw); w!=w_end; ++w) {
+            mark(*w, neighbour);
+            if constexpr (not random_access_neighbours) {
+                _position[*w] = _neighbours.size();
+                _neighbours.push_back(*w);
+            }
+        }
+        for (const auto w : to_drop) {
+            mark(w, dropped);
+        }
+        _to_add.clear();
+    }
+
+    /// Whether w has the given mark in the current rewiring
+    bool is(const vertex w, const Mark m) const {
+        return _rewiring[w] == _current and (_marks[w] & m);
+    }
+
+    void mark(const vertex w, const Mark m) {
+        if (_rewiring[w] != _current) {
+            _rewiring[w] = _current;
+            _marks[w] = 0;
+        }
+        _marks[w] |= m;
+    }
+
+    /// Record that the edge from v to w was removed from the network
+    void remove_neighbour(const vertex w) {
+        _marks[w] &= ~neighbour;
+        if constexpr (not random_access_neighbours) {
+            const auto pos = _position[w];
+            _removed.insert(std::upper_bound(_removed.begin(),
+                                             _removed.end(), pos), pos);
+        }
+    }
+
+    /// A uniformly drawn out-neighbour of v, the user of the rewiring
+    template<typename RNGType>
+    vertex random_neighbour(const vertex v, const NWType& nw, RNGType& rng) {
+        const int idx = utils::get_rand_int<RNGType>(0, out_degree(v, nw),
+                                                     rng);
+        if constexpr (random_access_neighbours) {
+            return adjacent_vertices(v, nw).first[idx];
+        }
+        else {
+            // the idx-th of the neighbours that are not removed
+            std::size_t pos = idx;
+            for (const auto removed : _removed) {
+                if (removed > pos) {
+                    break;
+                }
+                ++pos;
+            }
+            return _neighbours[pos];
+        }
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_REWIRING
@@ -0,0 +1,277 @@
+#ifndef UTOPIA_MODELS_OPDYN_SAMPLING
+#define UTOPIA_MODELS_OPDYN_SAMPLING
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+namespace Utopia::Models::OpDyn::sampling {
+
+/// Whether the out-neighbours of a vertex of NWType can be indexed
+template<typename NWType>
+inline constexpr bool random_access_adjacency = std::is_base_of_v<
+    std::random_access_iterator_tag,
+    typename std::iterator_traits<typename boost::graph_traits<NWType>::
+                                  adjacency_iterator>::iterator_category>;
+
+// WEIGHTED NEIGHBOUR SAMPLING .................................................
+
+/*! Draws the interaction partner of a vertex with probability proportional
+to the weight of the connecting out-edge. Each vertex caches the cumulative
+sums of its out-edge weights, so that a draw is a binary search. The weight
+update refills the cache of a vertex in its pass over the out-edges (see begin
+and push, and revision::reduce_weights), so only a change of the out-edges or
+a rescaling of the weights invalidates it; an invalid cache is rebuilt when it
+is next used.
+
+For a given value in [0, total weight), e.g. a random fraction of the weight
+sum of the vertex, the partner is the first neighbour whose cumulative weight
+reaches that value -- exactly the neighbour a linear scan over the out-edges
+would pick. The weights need not be normalised.
+*/
+template<typename NWType>
+class NeighbourSampler {
+public:
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+private:
+    // If the adjacency can be indexed, the targets need not be cached
+    static constexpr bool random_access_targets =
+                                        random_access_adjacency<NWType>;
+
+    std::vector<std::vector<double>> _cumulative;
+    std::vector<std::vector<vertex>> _targets;
+    std::vector<char> _valid;
+
+public:
+    explicit NeighbourSampler(std::size_t num_vertices)
+    :
+        _cumulative(num_vertices),
+        _targets(random_access_targets ? 0 : num_vertices),
+        _valid(num_vertices, false)
+    { }
+
+    /// Mark the cached weights of v as outdated
+    void invalidate(vertex v) {
+        _valid[v] = false;
+    }
+
+    /// Mark all cached weights as outdated, e.g. after the ageing step
+    void invalidate_all() {
+        std::fill(_valid.begin(), _valid.end(), false);
+    }
+
+    bool is_valid(vertex v) const {
+        return _valid[v];
+    }
+
+    /// Refill the cache of v in a pass over its out-edges: clear it here,
+    /// then push the weight and target of each out-edge, in their order.
+    /// The cache counts as valid from here on.
+    void begin(vertex v) {
+        _cumulative[v].clear();
+        if constexpr (not random_access_targets) {
+            _targets[v].clear();
+        }
+        _valid[v] = true;
+    }
+
+    /// Append the next out-edge of v (see begin)
+    void push(vertex v, double weight, [[maybe_unused]] vertex w) {
+        auto& cumulative = _cumulative[v];
+        cumulative.push_back((cumulative.empty() ? 0. : cumulative.back())
+                             + weight);
+        if constexpr (not random_access_targets) {
+            _targets[v].push_back(w);
+        }
+    }
+
+    /// The sum of the out-edge weights of v
+    template<typename NW>
+    double total_weight(vertex v, const NW& nw) {
+        rebuild_if_invalid(v, nw);
+        return _cumulative[v].empty() ? 0. : _cumulative[v].back();
+    }
+
+    /// Returns the neighbour at which the cumulative weight first reaches
+    /// value, or v itself if there is none (as for rounding errors).
+    template<typename NW>
+    vertex sample(vertex v, double value, const NW& nw) {
+        rebuild_if_invalid(v, nw);
+
+        const auto& cumulative = _cumulative[v];
+        const auto it = std::lower_bound(cumulative.begin(),
+                                         cumulative.end(), value);
+        if (it == cumulative.end()) {
+            return v;
+        }
+
+        const auto idx = it - cumulative.begin();
+        if constexpr (random_access_targets) {
+            return adjacent_vertices(v, nw).first[idx];
+        }
+        else {
+            return _targets[v][idx];
+        }
+    }
+
+    /// The out-neighbour of v at position idx in the order of its out-edges,
+    /// from the cache if the adjacency cannot be indexed
+    template<typename NW>
+    vertex neighbour(vertex v, std::size_t idx, const NW& nw) {
+        if constexpr (random_access_targets) {
+            return adjacent_vertices(v, nw).first[idx];
+        }
+        else {
+            rebuild_if_invalid(v, nw);
+            return _targets[v][idx];
+        }
+    }
+
+private:
+    template<typename NW>
+    void rebuild_if_invalid(vertex v, const NW& nw) {
+        if (_valid[v]) {
+            return;
+        }
+
+        begin(v);
+        for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+            push(v, nw[*e].attr, target(*e, nw));
+        }
+    }
+};
+
+
+// SAMPLING PROPORTIONAL TO VALUES .............................................
+
+/*! A binary indexed (Fenwick) tree over non-negative values, e.g. the ad
+values of the media. Changing a value and drawing an index with probability
+proportional to its value both cost O(log n), and the values need not be
+normalised.
+
+Changes are applied as differences; to keep rounding errors from piling up,
+the tree is rebuilt from the stored values once every n changes.
+*/
+class FenwickTree {
+    std::vector<double> _values;
+    std::vector<double> _tree;
+    std::size_t _changes;
+
+public:
+    explicit FenwickTree(std::size_t n = 0)
+    :
+        _values(n, 0.),
+        _tree(n + 1, 0.),
+        _changes(0)
+    { }
+
+    std::size_t size() const {
+        return _values.size();
+    }
+
+    double value(std::size_t i) const {
+        return _values[i];
+    }
+
+    /// Set the value at index i
+    void set(std::size_t i, double val) {
+        const double delta = val - _values[i];
+        _values[i] = val;
+
+        if (++_changes >= size()) {
+            rebuild();
+            return;
+        }
+        for (std::size_t k = i + 1; k < _tree.size(); k += k & (~k + 1)) {
+            _tree[k] += delta;
+        }
+    }
+
+    /// The sum of the values at indices [0, i)
+    double prefix_sum(std::size_t i) const {
+        double sum = 0.;
+        for (std::size_t k = i; k > 0; k -= k & (~k + 1)) {
+            sum += _tree[k];
+        }
+        return sum;
+    }
+
+    double total() const {
+        return prefix_sum(size());
+    }
+
+    /// The first index at which the prefix sum reaches frac * total. This is
+    /// the index a linear scan over the normalised values would return.
+    /// Throws std::invalid_argument if there are no values to draw from.
+    std::size_t sample(double frac) const {
+        if (size() == 0) {
+            throw std::invalid_argument("Cannot sample from an empty Fenwick "
+                                        "tree!");
+        }
+
+        double remaining = frac * total();
+
+        std::size_t step = 1;
+        while (2 * step <= size()) {
+            step *= 2;
+        }
+
+        std::size_t pos = 0;
+        for (; step > 0; step /= 2) {
+            if (pos + step <= size() and _tree[pos + step] < remaining) {
+                pos += step;
+                remaining -= _tree[pos];
+            }
+        }
+
+        // only reached through rounding errors
+        if (pos >= size()) {
+            pos = size() - 1;
+        }
+        return pos;
+    }
+
+    /// Recompute the tree from the stored values in O(n)
+    void rebuild() {
+        std::fill(_tree.begin(), _tree.end(), 0.);
+        for (std::size_t k = 1; k < _tree.size(); ++k) {
+            _tree[k] += _values[k - 1];
+            const std::size_t parent = k + (k & (~k + 1));
+            if (parent < _tree.size()) {
+                _tree[parent] += _tree[k];
+            }
+        }
+        _changes = 0;
+    }
+
+    /// Write the state to a checkpoint (see checkpoint.hh); the partial sums
+    /// are stored as they are, so that a restored tree samples identically
+    template<typename Writer>
+    void save(Writer& out) const {
+        out.write(_values);
+        out.write(_tree);
+        out.write(std::uint64_t(_changes));
+    }
+
+    /// Restore the state written by save
+    template<typename Reader>
+    void load(Reader& in) {
+        in.read(_values);
+        in.read(_tree);
+        _changes = in.template read<std::uint64_t>();
+        if (_tree.size() != _values.size() + 1) {
+            throw std::runtime_error("Inconsistent Fenwick tree in the "
+                                     "checkpoint!");
+        }
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_SAMPLING
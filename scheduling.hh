@@ -0,0 +1,410 @@
+#ifndef UTOPIA_MODELS_OPDYN_SCHEDULING
+#define UTOPIA_MODELS_OPDYN_SCHEDULING
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "sampling.hh"
+#include "update.hh"
+
+namespace Utopia::Models::OpDyn::scheduling {
+
+/// The scheduling of the user revisions (see OpDyn_cfg.yml)
+enum class Scheduler {
+    uniform,    ///< Each to a user drawn uniformly at random
+    kinetic,    ///< Rejection-free, see KineticScheduler
+    active      ///< Only to the active users, see ActiveSet
+};
+
+/// The slot of the next event if there is none
+inline constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+
+/// The slot of the first event from the given slot on, if there is one in
+/// each slot with probability p, and log_complement = log(1 - p); the number
+/// of slots before it is drawn by inversion of the geometric distribution
+template<typename RNGType>
+std::uint64_t first_event(const std::uint64_t slot,
+                          const double probability,
+                          const double log_complement,
+                          std::uniform_real_distribution<double>& uniform,
+                          RNGType& rng)
+{
+    if (probability <= 0.) {
+        return never;
+    }
+    if (probability >= 1.) {
+        return slot;
+    }
+    const double u = 1. - uniform(rng);
+    const double slots = std::floor(std::log(u) / log_complement);
+    if (slots >= double(never - slot)) {
+        return never;
+    }
+    return slot + std::uint64_t(slots);
+}
+
+/*! A rejection-free (kinetic Monte Carlo) scheduler of the user revisions.
+The uniform scheduler offers each user revision to a user drawn uniformly at
+random, whether or not the revision can change anything. This scheduler keeps
+the rate of each user, 1 if its revision may change the state and 0 if it
+cannot, in a sum tree (see sampling::FenwickTree). The user revisions are
+numbered by their slots; an event, i.e. a user revision that may change the
+state, happens in a slot with probability p = (sum of the rates) / (number
+of users). Instead of drawing the user of every slot, the scheduler draws the
+number of slots until the next event, which is geometrically distributed
+with parameter p (the discrete counterpart of the exponential waiting time),
+and the user of the event with probability proportional to its rate. This is
+statistically identical to the uniform scheduler, but the user revisions in
+the slots in between are skipped (see OpDyn::perform_user_revision). The
+information revision and the ageing are not affected.
+
+A user without out-edges has no partner and no weights, so its revision
+changes nothing; these are the users of rate 0. The scheduler is thus only a
+filter of the users without out-edges, and only pays off if there are many of
+them. A rate from the opinions, e.g. 0 if all out-neighbours are within a
+small distance, would not be exact: the revision of any other user changes
+its weights (see revision::reduce_weights) and may rewire far-off neighbours.
+Skipping the users that cannot change their opinion or edges, at the cost of
+keeping their weights, is what ActiveSet does. The user revisions preserve
+the out-degrees, so the rates only change in the ageing, after which they are
+updated (update_all) and the next event is drawn anew (reschedule), which is
+exact since the waiting time has no memory.
+*/
+template<typename NWType>
+class KineticScheduler {
+public:
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+    static constexpr std::uint64_t never = scheduling::never;
+
+private:
+    sampling::FenwickTree _rates;
+    std::uint64_t _next;
+    std::uniform_real_distribution<double> _uniform;
+
+    // The event probability p and log(1 - p), as of the last update
+    double _probability;
+    double _log_complement;
+
+public:
+    explicit KineticScheduler(std::size_t num_vertices)
+    :
+        _rates(num_vertices),
+        _next(never),
+        _uniform(0., 1.),
+        _probability(0.),
+        _log_complement(0.)
+    { }
+
+    /// The rate of v: whether a revision of v can change the state, i.e.
+    /// whether v has out-edges
+    static double rate(vertex v, const NWType& nw) {
+        return out_degree(v, nw) != 0 ? 1. : 0.;
+    }
+
+    /// Update the rates of all users
+    void update_all(const NWType& nw) {
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+            _rates.set(*v, rate(*v, nw));
+        }
+        _rates.rebuild();
+        update_probability();
+    }
+
+    /// The probability p that a user revision is an event
+    double event_probability() const {
+        return _probability;
+    }
+
+    /// Draw the slot of the next event, from the slot given on
+    template<typename RNGType>
+    void reschedule(const std::uint64_t slot, RNGType& rng) {
+        _next = after(slot, rng);
+    }
+
+    /// The slot of the next event; never if all rates are 0
+    std::uint64_t next_event() const {
+        return _next;
+    }
+
+    /// The user revised in the given slot, if it is the slot of the next
+    /// event; then, the slot of the event after it is drawn as well
+    template<typename RNGType>
+    std::optional<vertex> draw(const std::uint64_t slot, RNGType& rng) {
+        if (slot != _next) {
+            return std::nullopt;
+        }
+
+        // a fraction in (0, 1], such that no user of rate 0 is drawn
+        const double frac = 1. - _uniform(rng);
+        const vertex v = _rates.sample(frac);
+        _next = after(slot + 1, rng);
+        return v;
+    }
+
+    /// Write the state to a checkpoint (see checkpoint.hh)
+    template<typename Writer>
+    void save(Writer& out) const {
+        _rates.save(out);
+        out.write(_next);
+    }
+
+    /// Restore the state written by save
+    template<typename Reader>
+    void load(Reader& in) {
+        _rates.load(in);
+        in.read(_next);
+        update_probability();
+    }
+
+private:
+    void update_probability() {
+        _probability = _rates.size() == 0 ? 0.
+                            : _rates.total() / double(_rates.size());
+        _log_complement = std::log1p(-_probability);
+    }
+
+    /// The slot of the first event from the given slot on
+    template<typename RNGType>
+    std::uint64_t after(const std::uint64_t slot, RNGType& rng) {
+        return first_event(slot, _probability, _log_complement, _uniform, rng);
+    }
+};
+
+
+/*! The set of active users, a lighter alternative to the KineticScheduler.
+A user is active if its revision can change its opinion or its edges, i.e. if
+it has an out-neighbour within its tolerance or, if the rewiring probability
+is positive, one beyond it, which is a candidate for rewiring. The revision of
+an inactive user only shifts its weights, which are not used until it is
+active again; skipping it is exact for the opinions, tolerances and edges, but
+the weights of inactive users are frozen as well. With a positive rewiring
+probability, the active users are those with out-edges, as for the
+KineticScheduler; more revisions are skipped only without rewiring.
+
+A user revision is an event with probability p = (number of active users) /
+(number of users). As in the KineticScheduler, the number of slots until the
+next event is drawn from the geometric distribution, but its user is drawn
+uniformly from the set, in constant time. The set changes with the state, and
+the changes have to be reported (touch, update_all): whether a user is active
+depends on its tolerance, its out-edges, and its opinion and those of its
+out-neighbours, so that an opinion change affects its in-neighbours as well.
+If the set has changed, the next event is drawn anew from the current slot,
+which is exact since the waiting time has no memory.
+
+The bookkeeping costs more than the revisions it saves unless a good part of
+the users is inactive: the users in an opinion cluster have their neighbours
+within their tolerance and stay active even if the cluster has settled.
+*/
+template<typename NWType>
+class ActiveSet {
+public:
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+    static constexpr std::uint64_t never = scheduling::never;
+
+private:
+    static constexpr std::size_t inactive =
+                                    std::numeric_limits<std::size_t>::max();
+
+    // The active users, and the position of each user among them
+    std::vector<vertex> _members;
+    std::vector<std::size_t> _positions;
+
+    // Whether the edges beyond the tolerance are rewired
+    const bool _rewiring;
+
+    std::uint64_t _next;
+
+    // Whether the set has changed since the next event was drawn
+    bool _changed;
+
+    std::uniform_real_distribution<double> _uniform;
+
+    // The event probability p and log(1 - p), as of the last draw of the
+    // next event
+    double _probability;
+    double _log_complement;
+
+public:
+    ActiveSet(const std::size_t num_vertices, const double rewiring)
+    :
+        _members(),
+        _positions(num_vertices, inactive),
+        _rewiring(rewiring > 0.),
+        _next(never),
+        _changed(true),
+        _uniform(0., 1.),
+        _probability(0.),
+        _log_complement(0.)
+    {
+        _members.reserve(num_vertices);
+    }
+
+    /// Whether a revision of v can change its opinion or its edges
+    bool is_active(const vertex v, const NWType& nw) const {
+        if (out_degree(v, nw) == 0) {
+            return false;
+        }
+        if (_rewiring) {
+            return true;
+        }
+        for (auto [w, w_end] = adjacent_vertices(v, nw); w!=w_end; ++w) {
+            if (update::within(nw[*w].opinion, nw[v].opinion,
+                               nw[v].tolerance)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(const vertex v) const {
+        return _positions[v] != inactive;
+    }
+
+    /// The number of active users
+    std::size_t size() const {
+        return _members.size();
+    }
+
+    /// The probability p that a user revision is an event
+    double event_probability() const {
+        return _positions.empty() ? 0.
+                    : double(_members.size()) / double(_positions.size());
+    }
+
+    /// Update whether v is active
+    void update(const vertex v, const NWType& nw) {
+        if (is_active(v, nw)) {
+            insert(v);
+        }
+        else {
+            erase(v);
+        }
+    }
+
+    /// Update the users affected by a change of v: v itself, and those
+    /// in-neighbours for which its opinion has crossed their tolerance
+    void touch(const vertex v, const NWType& nw,
+               const double previous_opinion)
+    {
+        update(v, nw);
+        if (_rewiring or nw[v].opinion == previous_opinion) {
+            return;
+        }
+        for (auto [e, e_end] = in_edges(v, nw); e!=e_end; ++e) {
+            const vertex u = source(*e, nw);
+            const bool was_within = update::within(previous_opinion,
+                                                   nw[u].opinion,
+                                                   nw[u].tolerance);
+            const bool is_within = update::within(nw[v].opinion,
+                                                  nw[u].opinion,
+                                                  nw[u].tolerance);
+            if (is_within != was_within) {
+                update(u, nw);
+            }
+        }
+    }
+
+    /// Update all users
+    void update_all(const NWType& nw) {
+        _members.clear();
+        std::fill(_positions.begin(), _positions.end(), inactive);
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+            if (is_active(*v, nw)) {
+                insert(*v);
+            }
+        }
+        _changed = true;
+    }
+
+    /// The slot of the next event, as of the last draw
+    std::uint64_t next_event() const {
+        return _next;
+    }
+
+    /// The user revised in the given slot, if it is the slot of the next
+    /// event. The slots have to be passed in order; after an event, the
+    /// revised user is expected to be touched before the next slot.
+    template<typename RNGType>
+    std::optional<vertex> draw(const std::uint64_t slot, RNGType& rng) {
+        if (_changed) {
+            _probability = event_probability();
+            _log_complement = std::log1p(-_probability);
+            _next = after(slot, rng);
+            _changed = false;
+        }
+        if (slot != _next) {
+            return std::nullopt;
+        }
+
+        std::uniform_int_distribution<std::size_t> member(0,
+                                                          _members.size()-1);
+        const vertex v = _members[member(rng)];
+
+        // drawn anew if the revision of v changes the set
+        _next = after(slot + 1, rng);
+        return v;
+    }
+
+    /// Write the state to a checkpoint (see checkpoint.hh)
+    template<typename Writer>
+    void save(Writer& out) const {
+        out.write(_members);
+        out.write(_next);
+        out.write(_changed);
+    }
+
+    /// Restore the state written by save
+    template<typename Reader>
+    void load(Reader& in) {
+        in.read(_members);
+        in.read(_next);
+        in.read(_changed);
+
+        std::fill(_positions.begin(), _positions.end(), inactive);
+        for (std::size_t i=0; i<_members.size(); ++i) {
+            _positions.at(_members[i]) = i;
+        }
+        _probability = event_probability();
+        _log_complement = std::log1p(-_probability);
+    }
+
+private:
+    /// The slot of the first event from the given slot on
+    template<typename RNGType>
+    std::uint64_t after(const std::uint64_t slot, RNGType& rng) {
+        return first_event(slot, _probability, _log_complement, _uniform, rng);
+    }
+
+    void insert(const vertex v) {
+        if (_positions[v] == inactive) {
+            _positions[v] = _members.size();
+            _members.push_back(v);
+            _changed = true;
+        }
+    }
+
+    /// Remove v by moving the last member into its place
+    void erase(const vertex v) {
+        const auto i = _positions[v];
+        if (i != inactive) {
+            _members[i] = _members.back();
+            _positions[_members[i]] = i;
+            _members.pop_back();
+            _positions[v] = inactive;
+            _changed = true;
+        }
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_SCHEDULING
@@ -0,0 +1,120 @@
+#ifndef UTOPIA_MODELS_OPDYN_STREAMS
+#define UTOPIA_MODELS_OPDYN_STREAMS
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace Utopia::Models::OpDyn::streams {
+
+/*! Counter-based random number streams. The Philox4x32-10 generator of
+Salmon et al. (2011) encrypts a 128-bit counter with a 64-bit key; its n-th
+output is a pure function of (key, counter, n). A stream is thus fully
+determined by a handful of integers and can be created anywhere, e.g. on the
+thread that revises a given user, without any shared state. Two streams with
+different (seed, step, id, phase) never overlap.
+
+The engine satisfies the UniformRandomBitGenerator requirements, so it can be
+used in place of the shared RNG with the std and boost distributions and with
+the utils functions.
+*/
+
+/// The phase of the model a stream is drawn for
+enum class Phase : std::uint32_t {
+    batch,
+    user_revision,
+    revision,
+    initialization,
+    analysis
+};
+
+// PHILOX 4x32-10 ..............................................................
+
+class Philox4x32 {
+public:
+    using result_type = std::uint32_t;
+    using counter_type = std::array<std::uint32_t, 4>;
+    using key_type = std::array<std::uint32_t, 2>;
+
+private:
+    key_type _key;
+    counter_type _counter;
+    counter_type _block;
+    unsigned int _idx;
+
+    static constexpr std::uint32_t M0 = 0xD2511F53;
+    static constexpr std::uint32_t M1 = 0xCD9E8D57;
+    static constexpr std::uint32_t W0 = 0x9E3779B9;
+    static constexpr std::uint32_t W1 = 0xBB67AE85;
+
+public:
+    /// The stream with the given key, whose first block has the given counter
+    Philox4x32(const key_type& key, const counter_type& counter)
+    :
+        _key(key),
+        _counter(counter),
+        _block{},
+        _idx(4)
+    { }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        if (_idx == 4) {
+            _block = encrypt(_counter, _key);
+            ++_counter[0];
+            _idx = 0;
+        }
+        return _block[_idx++];
+    }
+
+    void discard(unsigned long long n) {
+        for (; n > 0; --n) {
+            (*this)();
+        }
+    }
+
+    /// The ten Philox rounds applied to a single counter
+    static counter_type encrypt(counter_type ctr, key_type key) {
+        for (int r = 0; r < 10; ++r) {
+            if (r > 0) {
+                key[0] += W0;
+                key[1] += W1;
+            }
+            const std::uint64_t p0 = std::uint64_t(M0) * ctr[0];
+            const std::uint64_t p1 = std::uint64_t(M1) * ctr[2];
+            ctr = {std::uint32_t(p1 >> 32) ^ ctr[1] ^ key[0],
+                   std::uint32_t(p1),
+                   std::uint32_t(p0 >> 32) ^ ctr[3] ^ key[1],
+                   std::uint32_t(p0)};
+        }
+        return ctr;
+    }
+};
+
+/// The stream for the given phase of a step, and an id within it (e.g. a
+/// vertex, a thread or the position in a batch)
+inline Philox4x32 stream(const std::uint64_t seed,
+                         const std::uint64_t step,
+                         const std::uint32_t id,
+                         const Phase phase)
+{
+    // The first counter word counts the blocks within the stream; the step
+    // may use 56 bits.
+    return Philox4x32({std::uint32_t(seed), std::uint32_t(seed >> 32)},
+                      {0,
+                       id,
+                       std::uint32_t(step),
+                       std::uint32_t((step >> 32) & 0xFFFFFF)
+                           | (std::uint32_t(phase) << 24)});
+}
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_STREAMS
@@ -0,0 +1,307 @@
+#ifndef UTOPIA_MODELS_OPDYN_SYNCHRONOUS
+#define UTOPIA_MODELS_OPDYN_SYNCHRONOUS
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <boost/graph/graph_traits.hpp>
+
+#include "flat_network.hh"
+#include "parallel.hh"
+#include "update.hh"
+
+namespace Utopia::Models::OpDyn::synchronous {
+
+/*! The bulk-synchronous bounded-confidence update (Hegselmann-Krause), an
+alternative to the pairwise user revisions. In a sweep, every user moves
+towards the mean of the opinions of its out-neighbours within its tolerance,
+weighted by the edge weights, by its susceptibility:
+
+    x_v' = x_v + s_v (sum_w a_vw x_w / sum_w a_vw - x_v)
+
+over the w with |x_w - x_v| <= t_v. The opinions are read from a snapshot
+taken before the sweep, so the users are independent of each other and are
+updated in parallel; the tolerance then changes as after a pairwise update
+(see update::tolerance). The weights and edges are not changed.
+
+The sums over the neighbourhood are computed by a kernel over contiguous
+arrays of the targets and weights, gathering the opinions from the snapshot:
+with AVX-512 or AVX2 if the compiler targets them (see the CMake option
+OPDYN_NATIVE_ARCH), else by the scalar fallback. The kernels sum in a
+different order, so the results of builds for different instruction sets
+differ by rounding.
+*/
+
+using flat::index_t;
+
+/// The sums of a_vw x_w and a_vw over the neighbours within the tolerance
+struct Sums {
+    double weighted_opinion = 0.;
+    double weight = 0.;
+};
+
+// KERNELS .....................................................................
+
+namespace kernels {
+
+/// The sums over the n neighbours with the given targets and weights
+inline Sums scalar(const double* opinions,
+                   const index_t* targets,
+                   const double* weights,
+                   const std::size_t n,
+                   const double opinion,
+                   const double tolerance)
+{
+    Sums sums;
+    for (std::size_t i=0; i<n; ++i) {
+        const double x = opinions[targets[i]];
+        if (std::fabs(x - opinion) <= tolerance) {
+            sums.weighted_opinion += weights[i] * x;
+            sums.weight += weights[i];
+        }
+    }
+    return sums;
+}
+
+#if defined(__AVX2__)
+/// As scalar, four neighbours at a time; the weights beyond the tolerance
+/// are masked to zero
+inline Sums avx2(const double* opinions,
+                 const index_t* targets,
+                 const double* weights,
+                 const std::size_t n,
+                 const double opinion,
+                 const double tolerance)
+{
+    // not worth the reduction of the lanes
+    if (n < 8) {
+        return scalar(opinions, targets, weights, n, opinion, tolerance);
+    }
+
+    const __m256d x_v = _mm256_set1_pd(opinion);
+    const __m256d t_v = _mm256_set1_pd(tolerance);
+    const __m256d sign = _mm256_set1_pd(-0.);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256d weighted_opinion = _mm256_setzero_pd();
+    __m256d weight = _mm256_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        const __m128i idx = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(targets + i));
+        // the masked gather with a zeroed source, as the unmasked one starts
+        // from an undefined register, which GCC 12 warns about
+        const __m256d x = _mm256_mask_i32gather_pd(_mm256_setzero_pd(),
+                                                   opinions, idx, all, 8);
+        const __m256d distance = _mm256_andnot_pd(sign,
+                                                  _mm256_sub_pd(x, x_v));
+        const __m256d within = _mm256_cmp_pd(distance, t_v, _CMP_LE_OQ);
+        const __m256d w = _mm256_and_pd(_mm256_loadu_pd(weights + i), within);
+#if defined(__FMA__)
+        weighted_opinion = _mm256_fmadd_pd(w, x, weighted_opinion);
+#else
+        weighted_opinion = _mm256_add_pd(weighted_opinion,
+                                         _mm256_mul_pd(w, x));
+#endif
+        weight = _mm256_add_pd(weight, w);
+    }
+
+    alignas(32) double lanes[2][4];
+    _mm256_store_pd(lanes[0], weighted_opinion);
+    _mm256_store_pd(lanes[1], weight);
+    Sums sums = scalar(opinions, targets + i, weights + i, n - i,
+                       opinion, tolerance);
+    sums.weighted_opinion += (lanes[0][0] + lanes[0][1])
+                             + (lanes[0][2] + lanes[0][3]);
+    sums.weight += (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+    return sums;
+}
+#endif
+
+#if defined(__AVX512F__)
+/// As scalar, eight neighbours at a time, accumulating under the mask of
+/// those within the tolerance
+inline Sums avx512(const double* opinions,
+                   const index_t* targets,
+                   const double* weights,
+                   const std::size_t n,
+                   const double opinion,
+                   const double tolerance)
+{
+    // not worth the reduction of the lanes
+    if (n < 16) {
+        return scalar(opinions, targets, weights, n, opinion, tolerance);
+    }
+
+    const __m512d x_v = _mm512_set1_pd(opinion);
+    const __m512d t_v = _mm512_set1_pd(tolerance);
+    __m512d weighted_opinion = _mm512_setzero_pd();
+    __m512d weight = _mm512_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i+8<=n; i+=8) {
+        const __m256i idx = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(targets + i));
+        // (masked with a zeroed source, see avx2)
+        const __m512d x = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF,
+                                                   idx, opinions, 8);
+        const __m512d w = _mm512_loadu_pd(weights + i);
+        const __mmask8 within = _mm512_cmp_pd_mask(
+                        _mm512_abs_pd(_mm512_sub_pd(x, x_v)), t_v,
+                        _CMP_LE_OQ);
+        weighted_opinion = _mm512_mask3_fmadd_pd(w, x, weighted_opinion,
+                                                 within);
+        weight = _mm512_mask_add_pd(weight, within, weight, w);
+    }
+
+    // the lanes are added in the order of _mm512_reduce_add_pd, whose
+    // extraction of the halves GCC 12 also warns about
+    alignas(64) double lanes[2][8];
+    _mm512_store_pd(lanes[0], weighted_opinion);
+    _mm512_store_pd(lanes[1], weight);
+    const auto reduce = [](const double* l) {
+        return ((l[0] + l[4]) + (l[2] + l[6]))
+               + ((l[1] + l[5]) + (l[3] + l[7]));
+    };
+
+    Sums sums = scalar(opinions, targets + i, weights + i, n - i,
+                       opinion, tolerance);
+    sums.weighted_opinion += reduce(lanes[0]);
+    sums.weight += reduce(lanes[1]);
+    return sums;
+}
+#endif
+
+} // namespace kernels
+
+/// The name of the kernel used by accumulate
+inline constexpr const char* kernel_name =
+#if defined(__AVX512F__)
+    "avx512";
+#elif defined(__AVX2__)
+    "avx2";
+#else
+    "scalar";
+#endif
+
+/// The sums over the neighbourhood, with the best kernel available
+inline Sums accumulate(const double* opinions,
+                       const index_t* targets,
+                       const double* weights,
+                       const std::size_t n,
+                       const double opinion,
+                       const double tolerance)
+{
+#if defined(__AVX512F__)
+    return kernels::avx512(opinions, targets, weights, n, opinion, tolerance);
+#elif defined(__AVX2__)
+    return kernels::avx2(opinions, targets, weights, n, opinion, tolerance);
+#else
+    return kernels::scalar(opinions, targets, weights, n, opinion, tolerance);
+#endif
+}
+
+// NEIGHBOURHOODS ..............................................................
+
+/// The targets and weights of the out-edges of a user, as contiguous arrays
+struct Neighbourhood {
+    const index_t* targets;
+    const double* weights;
+    std::size_t size;
+};
+
+/// Buffers for the neighbourhoods of networks that do not store them
+/// contiguously
+struct Buffer {
+    std::vector<index_t> targets;
+    std::vector<double> weights;
+};
+
+/// The neighbourhood of v, copied to the buffer
+template<typename NWType, typename VertexDescType>
+Neighbourhood neighbourhood(const VertexDescType v, const NWType& nw,
+                            Buffer& buffer)
+{
+    buffer.targets.clear();
+    buffer.weights.clear();
+    for (auto [e, e_end] = out_edges(v, nw); e!=e_end; ++e) {
+        buffer.targets.push_back(index_t(target(*e, nw)));
+        buffer.weights.push_back(nw[*e].attr);
+    }
+    return {buffer.targets.data(), buffer.weights.data(),
+            buffer.targets.size()};
+}
+
+/// The neighbourhood of v in a flat network, in place; weights of float are
+/// converted to the buffer
+template<typename VertexStore, typename EdgeProperty>
+Neighbourhood neighbourhood(const index_t v,
+                            const flat::FlatNetwork<VertexStore,
+                                                    EdgeProperty>& nw,
+                            Buffer& buffer)
+{
+    const index_t* targets = nw.targets(v).first;
+    const auto properties = nw.out_properties(v);
+    if constexpr (std::is_same_v<decltype(EdgeProperty::attr), double>) {
+        static_assert(sizeof(EdgeProperty) == sizeof(double),
+                      "The edge weights must be stored contiguously!");
+        return {targets, &properties->attr, nw.out_deg(v)};
+    }
+    else {
+        buffer.weights.resize(nw.out_deg(v));
+        for (std::size_t i=0; i<buffer.weights.size(); ++i) {
+            buffer.weights[i] = properties[i].attr;
+        }
+        return {targets, buffer.weights.data(), buffer.weights.size()};
+    }
+}
+
+// THE SWEEP ...................................................................
+
+/// Performs the sweeps, keeping the opinion snapshot and the buffers
+template<typename NWType>
+class Sweep {
+    using vertex = typename boost::graph_traits<NWType>::vertex_descriptor;
+
+    std::vector<double> _snapshot;
+    std::vector<Buffer> _buffers;
+
+public:
+    /// Update all users of nw from a snapshot of the opinions
+    void operator()(NWType& nw,
+                    const double radicalisation_parameter,
+                    parallel::ThreadPool& pool)
+    {
+        const std::size_t n = num_vertices(nw);
+        _snapshot.resize(n);
+        for (auto [v, v_end] = vertices(nw); v!=v_end; ++v) {
+            _snapshot[*v] = nw[*v].opinion;
+        }
+        _buffers.resize(pool.num_threads());
+
+        pool.parallel_for(n, [&](const std::size_t i, const std::size_t t){
+            vertex v = vertex(i);
+            const auto nb = neighbourhood(v, nw, _buffers[t]);
+            const double opinion = _snapshot[i];
+            const auto sums = accumulate(_snapshot.data(), nb.targets,
+                                         nb.weights, nb.size, opinion,
+                                         nw[v].tolerance);
+            if (sums.weight > 0.) {
+                nw[v].opinion = opinion + nw[v].susceptibility
+                                * (sums.weighted_opinion / sums.weight
+                                   - opinion);
+                update::tolerance(v, nw, opinion, radicalisation_parameter);
+            }
+        });
+    }
+};
+
+} // namespace
+
+#endif // UTOPIA_MODELS_OPDYN_SYNCHRONOUS
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <yaml-cpp/yaml.h>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/graph.hh>
+
+#include "../OpDyn.hh"
+
+/*! Microbenchmarks of the kernels of the OpDyn model (not a test). Each kernel
+is timed in isolation on a matrix of user networks: graph models, numbers of
+vertices and mean degrees, for both network backends. For every kernel and
+network, one CSV line is written to stdout:
+
+    kernel,backend,model,num_vertices,mean_degree,ops,ns_per_op,
+    allocs_per_op,ops_per_s
+
+An op is one call of the kernel: a revision for the revision kernels
+(user_revision being pairwise_weighted_update, update_weights and
+normalize_weights together, and kinetic_user_revision the same with the
+kinetic scheduler), a sweep over all users for synchronous_sweep, one ageing
+step for ageing, and one write for write_data. Allocations are the calls of
+operator new in this process; those of the HDF5 library are not counted.
+
+    OpDyn_benchmark [--models ErdosRenyi,WattsStrogatz]
+                    [--sizes 1000,10000] [--degrees 4,20]
+                    [--min-time 0.2] [--cfg <model configuration>]
+
+The model configuration (by default the one of the model) provides the media
+network and the parameters of the kernels.
+*/
+
+// ALLOCATION COUNTING .........................................................
+
+namespace {
+std::atomic<std::size_t> num_allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+
+namespace Utopia::Models::OpDyn::benchmark {
+
+using Config = Utopia::DataIO::Config;
+using RNG = Utopia::DefaultRNG;
+using Clock = std::chrono::steady_clock;
+
+/// The network a row of the matrix is measured on
+struct Case {
+    std::string model;
+    std::size_t num_vertices;
+    std::size_t mean_degree;
+};
+
+struct Result {
+    std::size_t ops = 0;
+    double seconds = 0.;
+    std::size_t allocations = 0;
+};
+
+/// Calls kernel in batches of batch_size until min_time has passed, after
+/// one batch to warm up
+template<typename Kernel>
+Result measure(Kernel&& kernel, const std::size_t batch_size,
+               const double min_time)
+{
+    for (std::size_t i=0; i<batch_size; ++i) {
+        kernel();
+    }
+
+    Result res;
+    const auto allocations = num_allocations.load();
+    const auto start = Clock::now();
+    do {
+        for (std::size_t i=0; i<batch_size; ++i) {
+            kernel();
+        }
+        res.ops += batch_size;
+        res.seconds = std::chrono::duration<double>(Clock::now()
+                                                    - start).count();
+    } while (res.seconds < min_time);
+    res.allocations = num_allocations.load() - allocations;
+    return res;
+}
+
+/// Like measure, but calls setup before each call of kernel, untimed
+template<typename Setup, typename Kernel>
+Result measure_each(Setup&& setup, Kernel&& kernel, const double min_time) {
+    setup();
+    kernel();
+
+    Result res;
+    do {
+        setup();
+        const auto allocations = num_allocations.load();
+        const auto start = Clock::now();
+        kernel();
+        res.seconds += std::chrono::duration<double>(Clock::now()
+                                                     - start).count();
+        res.allocations += num_allocations.load() - allocations;
+        ++res.ops;
+    } while (res.seconds < min_time);
+    return res;
+}
+
+void print_header() {
+    std::cout << "kernel,backend,model,num_vertices,mean_degree,ops,"
+                 "ns_per_op,allocs_per_op,ops_per_s" << std::endl;
+}
+
+void print(const std::string& kernel, const std::string& backend,
+           const Case& c, const Result& res)
+{
+    std::cout << kernel << "," << backend << "," << c.model << ","
+              << c.num_vertices << "," << c.mean_degree << "," << res.ops
+              << "," << 1e9 * res.seconds / double(res.ops) << ","
+              << double(res.allocations) / double(res.ops) << ","
+              << double(res.ops) / res.seconds << std::endl;
+}
+
+/// The configuration of the user network of a case
+Config nw_u_cfg(const Config& model_cfg, const Case& c) {
+    Config cfg = YAML::Clone(model_cfg["nw_u"]);
+    cfg["model"] = c.model;
+    cfg["num_vertices"] = c.num_vertices;
+    cfg["mean_degree"] = c.mean_degree;
+    return cfg;
+}
+
+/// A user network with random properties and normalised weights, and a
+/// media network the users are assigned to
+template<typename NWType>
+void initialize(NWType& nw_u, Network_m& nw_m, sampling::FenwickTree& ads_tree,
+                RNG& rng)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    std::uniform_int_distribution<unsigned int> medium(
+                            0, std::max<std::size_t>(num_vertices(nw_m), 1) - 1);
+
+    for (auto [m, m_end] = boost::vertices(nw_m); m!=m_end; ++m) {
+        nw_m[*m].opinion = prob(rng);
+        nw_m[*m].tolerance = 0.1 + 0.3 * prob(rng);
+        nw_m[*m].susceptibility = 0.5 * prob(rng);
+        nw_m[*m].persuasiveness = prob(rng);
+        nw_m[*m].users = 0;
+        nw_m[*m].ads = 0.;
+        for (auto [e, e_end] = boost::out_edges(*m, nw_m); e!=e_end; ++e) {
+            nw_m[*e].attr = prob(rng);
+        }
+    }
+
+    for (auto [v, v_end] = vertices(nw_u); v!=v_end; ++v) {
+        nw_u[*v].age = 1 + int(90 * prob(rng));
+        nw_u[*v].opinion = prob(rng);
+        nw_u[*v].tolerance = 0.1 + 0.3 * prob(rng);
+        nw_u[*v].susceptibility = 0.5 * prob(rng);
+        nw_u[*v].used_media = medium(rng);
+        nw_m[nw_u[*v].used_media].users++;
+        nw_m[nw_u[*v].used_media].ads++;
+        for (auto [e, e_end] = out_edges(*v, nw_u); e!=e_end; ++e) {
+            nw_u[*e].attr = 1. / double(out_degree(*v, nw_u));
+        }
+        revision::sum_weights(*v, nw_u);
+    }
+
+    ads_tree = sampling::FenwickTree(num_vertices(nw_m));
+    for (auto [m, m_end] = boost::vertices(nw_m); m!=m_end; ++m) {
+        ads_tree.set(*m, nw_m[*m].ads);
+    }
+    ads_tree.rebuild();
+}
+
+
+// KERNELS .....................................................................
+
+/// Times the revision kernels and the ageing on the user network nw_u
+template<typename NWType>
+void user_kernels(const std::string& backend, const Case& c, NWType nw_u,
+                  const Config& model_cfg, const double min_time)
+{
+    RNG rng(42);
+    Network_m nw_m = Utopia::Graph::create_graph<Network_m>(model_cfg["nw_m"],
+                                                            rng);
+    sampling::FenwickTree ads_tree;
+    initialize(nw_u, nw_m, ads_tree, rng);
+    const NWType initial_nw_u = nw_u;
+
+    std::uniform_real_distribution<double> prob(0., 1.);
+    sampling::NeighbourSampler<NWType> sampler(num_vertices(nw_u));
+    rewiring::Scratch<NWType> scratch(num_vertices(nw_u));
+    const auto radicalisation = get_as<double>("radicalisation_parameter",
+                                               model_cfg);
+    const auto weighting = get_as<double>("weighting", model_cfg);
+    const auto rewiring = get_as<double>("rewiring", model_cfg);
+    constexpr std::size_t batch = 1000;
+
+    print("pairwise_weighted_update", backend, c, measure([&](){
+        auto v = random_vertex(nw_u, rng);
+        revision::pairwise_weighted_update(v, nw_u, prob, rng,
+                                           radicalisation, sampler);
+    }, batch, min_time));
+
+    // the weights are normalised after each update, as in user_revision;
+    // otherwise they would soon vanish
+    unsigned int rewiring_count = 0;
+    print("update_weights", backend, c, measure([&](){
+        const auto v = random_vertex(nw_u, rng);
+        const bool rewired = revision::update_weights<Mode::None>(
+                                             v, nw_u, weighting, rewiring,
+                                             rewiring_count, prob, rng,
+                                             sampler, scratch);
+        const bool normalized = revision::normalize_weights(v, nw_u);
+        if (rewired or normalized) {
+            sampler.invalidate(v);
+        }
+    }, batch, min_time));
+
+    print("normalize_weights", backend, c, measure([&](){
+        const auto v = random_vertex(nw_u, rng);
+        revision::normalize_weights(v, nw_u);
+        sampler.invalidate(v);
+    }, batch, min_time));
+
+    print("user_revision", backend, c, measure([&](){
+        revision::user_revision<Mode::None>(nw_u, weighting, rewiring,
+                                            rewiring_count, prob,
+                                            radicalisation, rng, sampler,
+                                            scratch);
+    }, batch, min_time));
+
+    // the same, scheduled rejection-free; an op is also one user revision,
+    // but only those of users with out-edges are performed
+    scheduling::KineticScheduler<NWType> scheduler(num_vertices(nw_u));
+    scheduler.update_all(nw_u);
+    std::uint64_t slot = 0;
+    scheduler.reschedule(slot, rng);
+    print("kinetic_user_revision", backend, c, measure([&](){
+        if (const auto v = scheduler.draw(slot++, rng)) {
+            revision::revise_user<Mode::None>(*v, nw_u, weighting, rewiring,
+                                              rewiring_count, prob,
+                                              radicalisation, rng, sampler,
+                                              scratch);
+        }
+    }, batch, min_time));
+
+    // a sweep over all users on one thread, with the kernel of
+    // synchronous::kernel_name
+    parallel::ThreadPool pool(1);
+    synchronous::Sweep<NWType> sweep;
+    print("synchronous_sweep", backend, c, measure([&](){
+        sweep(nw_u, radicalisation, pool);
+    }, 1, min_time));
+
+    print("information_revision", backend, c, measure([&](){
+        revision::information_revision(nw_u, nw_m, prob, radicalisation, rng,
+                                       ads_tree);
+    }, batch, min_time));
+
+    print("media_revision", backend, c, measure([&](){
+        revision::media_revision(nw_m, rng, ads_tree);
+    }, batch, min_time));
+
+    const utils::SusceptibilityTable susceptibility(
+                                model_cfg["susceptibility"]["users"]["custom"]);
+    const auto age_groups = model_cfg["age_groups"];
+    auto log = spdlog::get("root.OpDyn");
+    // Ageing is done once per life cycle; back to back, it would soon leave
+    // no users of some age group. It is thus timed on the initial network.
+    NWType aged_nw_u;
+    print("ageing", backend, c, measure_each([&](){
+        aged_nw_u = initial_nw_u;
+    }, [&](){
+        ageing::ageing(get_as<double>("replacement_rate", model_cfg),
+                       num_vertices(nw_m),
+                       get_as<pair_int>("children", age_groups),
+                       get_as<pair_int>("parents", age_groups),
+                       get_as<pair_int>("seniors", age_groups),
+                       aged_nw_u, log, rng, susceptibility);
+    }, min_time));
+}
+
+/// Times write_data of a model with ageing and media on the network of c
+template<NetworkBackend network_backend>
+void write_kernel(const std::string& backend, const Case& c,
+                  Utopia::PseudoParent& pp, const Config& model_cfg,
+                  const std::size_t index, const double min_time)
+{
+    Config cfg = YAML::Clone(model_cfg);
+    cfg["nw_u"] = nw_u_cfg(model_cfg, c);
+    cfg["nw_u"]["backend"] = backend;
+    cfg["user_ageing"] = "on";
+    cfg["media_status"] = "on";
+    cfg["async_write"]["enabled"] = false;
+    cfg["edge_events"]["enabled"] = false;
+    cfg["checkpoint"]["every"] = 0;
+
+    // every case writes to its own group
+    OpDyn<Ageing_and_Media, network_backend> model(
+                                "OpDyn_" + std::to_string(index), pp, cfg);
+    model.get_logger()->set_level(spdlog::level::off);
+    print("write_data", backend, c, measure([&](){
+        model.write_data();
+    }, 1, min_time));
+    model.flush();
+}
+
+/// The comma-separated values of an argument
+template<typename T>
+std::vector<T> parse_list(const std::string& arg) {
+    std::vector<T> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        values.push_back(YAML::Load(item).as<T>());
+    }
+    return values;
+}
+
+} // namespace Utopia::Models::OpDyn::benchmark
+
+
+using namespace Utopia::Models::OpDyn;
+using namespace Utopia::Models::OpDyn::benchmark;
+
+int main (int argc, char** argv)
+{
+    try {
+        std::vector<std::string> models = {"ErdosRenyi", "WattsStrogatz"};
+        std::vector<std::size_t> sizes = {1000, 10000};
+        std::vector<std::size_t> degrees = {4, 20};
+        double min_time = 0.2;
+        std::string cfg_path = OPDYN_CFG_PATH;
+
+        for (int i=1; i<argc; ++i) {
+            const std::string arg = argv[i];
+            if (i + 1 == argc) {
+                throw std::invalid_argument("Missing value of " + arg);
+            }
+            const std::string value = argv[++i];
+            if (arg == "--models") {
+                models = parse_list<std::string>(value);
+            }
+            else if (arg == "--sizes") {
+                sizes = parse_list<std::size_t>(value);
+            }
+            else if (arg == "--degrees") {
+                degrees = parse_list<std::size_t>(value);
+            }
+            else if (arg == "--min-time") {
+                min_time = std::stod(value);
+            }
+            else if (arg == "--cfg") {
+                cfg_path = value;
+            }
+            else {
+                throw std::invalid_argument("Unknown argument " + arg);
+            }
+        }
+
+        // the kernels log, e.g. about failed rewirings, to stdout
+        if (not spdlog::get("root.OpDyn")) {
+            spdlog::stdout_color_mt("root.OpDyn");
+        }
+        spdlog::set_level(spdlog::level::off);
+
+        // A run configuration for the models of the write_data kernel
+        const Config model_cfg = YAML::LoadFile(cfg_path);
+        Config run_cfg;
+        run_cfg["output_path"] = "benchmark_output.h5";
+        run_cfg["seed"] = 42;
+        run_cfg["num_steps"] = 1;
+        run_cfg["write_every"] = 1;
+        run_cfg["write_start"] = 0;
+        run_cfg["monitor_emit_interval"] = 2.;
+        run_cfg["log_levels"]["core"] = "error";
+        run_cfg["log_levels"]["data_io"] = "error";
+        run_cfg["log_levels"]["model"] = "error";
+        run_cfg["parameter_space"]["OpDyn"] = model_cfg;
+        {
+            std::ofstream out("benchmark_run_cfg.yml");
+            out << run_cfg;
+        }
+        Utopia::PseudoParent pp("benchmark_run_cfg.yml",
+                                "benchmark_output.h5", 42, "w");
+
+        print_header();
+        std::size_t index = 0;
+        for (const auto& model : models) {
+            for (const auto n : sizes) {
+                for (const auto k : degrees) {
+                    const Case c{model, n, k};
+                    try {
+                        RNG rng(42);
+                        const auto nw = Utopia::Graph::create_graph<Network_u>(
+                                                nw_u_cfg(model_cfg, c), rng);
+                        user_kernels("adjacency_list", c, nw, model_cfg,
+                                     min_time);
+                        user_kernels("flat", c, FlatNetwork_u::from(nw),
+                                     model_cfg, min_time);
+                        write_kernel<NetworkBackend::adjacency_list>(
+                            "adjacency_list", c, pp, model_cfg, index++,
+                            min_time);
+                        write_kernel<NetworkBackend::flat>(
+                            "flat", c, pp, model_cfg, index++, min_time);
+                    }
+                    catch (std::exception& e) {
+                        std::cerr << "Skipping " << model << " with " << n
+                                  << " vertices and mean degree " << k
+                                  << ": " << e.what() << std::endl;
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (...) {
+        std::cerr << "Exception occured!" << std::endl;
+        return 1;
+    }
+}
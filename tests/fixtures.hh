@@ -0,0 +1,66 @@
+#ifndef UTOPIA_MODELS_OPDYN_TEST_FIXTURES
+#define UTOPIA_MODELS_OPDYN_TEST_FIXTURES
+
+#include <random>
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+#include <utopia/data_io/cfg_utils.hh>
+
+#include "../revision.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// A random user network with random users and normalised weights, and the
+/// test configuration
+struct TestNetwork {
+    using RNG = std::mt19937;
+    using Config = Utopia::DataIO::Config;
+    using vertex = boost::graph_traits<Network_u>::vertex_descriptor;
+
+    RNG rng;
+    Network_u nw;
+    Config cfg;
+
+    explicit TestNetwork(const std::size_t num_vertices = 300,
+                         const std::size_t num_edges = 3000)
+    :
+        rng(42),
+        nw{},
+        cfg(YAML::LoadFile("test_config.yml"))
+    {
+        if (not spdlog::get("root.OpDyn")) {
+            spdlog::stdout_color_mt("root.OpDyn");
+        }
+
+        boost::generate_random_graph(nw, num_vertices, num_edges, rng,
+                                     false, false);
+
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            nw[*v].age = utils::get_rand_int(1, 91, rng);
+            nw[*v].opinion = utils::get_rand_double(0., 1., rng);
+            nw[*v].tolerance = utils::get_rand_double(0.1, 0.4, rng);
+            nw[*v].susceptibility = utils::get_rand_double(0., 0.5, rng);
+            nw[*v].used_media = 0;
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+                nw[*e].attr = 1. / double(boost::out_degree(*v, nw));
+            }
+            revision::sum_weights(*v, nw);
+        }
+    }
+};
+
+} // namespace Utopia::Models::OpDyn
+
+#endif // UTOPIA_MODELS_OPDYN_TEST_FIXTURES
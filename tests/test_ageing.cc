@@ -1,5 +1,6 @@
 #define BOOST_TEST_MODULE test ageing
 
+#include <cmath>
 #include <random>
 #include <type_traits>
 
@@ -132,7 +133,8 @@ BOOST_AUTO_TEST_CASE(test_user_collection)
     std::cout<<cfg["susceptibility"]["users"]["custom"]["peak"]<<std::endl;
     user_selection_and_ageing(children, parents, peers, child_ages,
                               parent_ages, senior_ages, replacement_rate,
-                              nw, *rng, cfg["susceptibility"]["users"]["custom"]);
+                              nw, *rng, utils::SusceptibilityTable(
+                                    cfg["susceptibility"]["users"]["custom"]));
 
     BOOST_TEST(children.size()==20);
     BOOST_TEST(parents.size()==20);
@@ -148,11 +150,19 @@ BOOST_AUTO_TEST_CASE(test_user_collection)
     }
 }
 
-BOOST_AUTO_TEST_CASE(test_vertex_removal)
+BOOST_AUTO_TEST_CASE(test_vertex_removal,
+                     * boost::unit_test::tolerance(1e-9))
 {
     using ageing::user_selection_and_ageing;
     using ageing::remove_edges;
 
+    for (auto v : range<IterateOver::vertices>(nw)) {
+        for (auto e : range<IterateOver::out_edges>(v, nw)) {
+            nw[e].attr = utils::get_rand_double(0., 1., *rng);
+        }
+        revision::sum_weights(v, nw);
+    }
+
     std::pair<int, int> child_ages(0, 10);
     std::pair<int, int> parent_ages(20, 40);
     std::pair<int, int> senior_ages(70, 1000);
@@ -162,7 +172,8 @@ BOOST_AUTO_TEST_CASE(test_vertex_removal)
     BOOST_TEST_PASSPOINT();
     user_selection_and_ageing(children, parents, peers, child_ages,
                               parent_ages, senior_ages, replacement_rate,
-                              nw, *rng, cfg["susceptibility"]["users"]["custom"]);
+                              nw, *rng, utils::SusceptibilityTable(
+                                    cfg["susceptibility"]["users"]["custom"]));
 
     BOOST_TEST(children.size() == 200);
     BOOST_TEST(parents.size() == 200);
@@ -177,6 +188,83 @@ BOOST_AUTO_TEST_CASE(test_vertex_removal)
             BOOST_TEST(boost::in_degree(children.at(i), nw) == 0);
         }
     }
+
+    // the weight sums of the previous in-neighbours are kept without the
+    // removed weights
+    for (auto v : range<IterateOver::vertices>(nw)) {
+        double sum = 0.;
+        for (auto e : range<IterateOver::out_edges>(v, nw)) {
+            sum += nw[e].attr;
+        }
+        BOOST_TEST(nw[v].weight_sum == sum);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_ageing_without_peers)
+{
+    // a ring, in which nobody needs peers, and nobody is young enough to be
+    // one; the seniors are not adjacent, so each keeps its degree
+    Network_u ring(100);
+    for (vertex v=0; v<100; ++v) {
+        boost::add_edge(v, (v+1)%100, {1.}, ring);
+        revision::sum_weights(v, ring);
+        ring[v].age = (v % 2 == 0) ? 30 : 80;
+    }
+
+    std::pair<int, int> child_ages(0, 10);
+    std::pair<int, int> parent_ages(20, 40);
+    std::pair<int, int> senior_ages(70, 1000);
+    auto opdyn_log = spdlog::get("root.OpDyn");
+    ageing::ageing(0.1, 1, child_ages, parent_ages, senior_ages, ring,
+                   opdyn_log, *rng, utils::SusceptibilityTable(
+                                    cfg["susceptibility"]["users"]["custom"]));
+
+    // the seniors are still replaced, and keep their degree
+    int num_children = 0;
+    for (auto v : range<IterateOver::vertices>(ring)) {
+        if (ring[v].age == 1) {
+            ++num_children;
+            BOOST_TEST(boost::degree(v, ring) == 2u);
+        }
+    }
+    BOOST_TEST(num_children == 10);
+    BOOST_TEST(boost::num_edges(ring) == 100u);
+}
+
+BOOST_AUTO_TEST_CASE(test_weight_sums, * boost::unit_test::tolerance(1e-12))
+{
+    const vertex v = 0, w = 1, u = 2;
+    boost::clear_vertex(v, nw);
+    boost::clear_vertex(u, nw);
+    boost::add_edge(v, w, {2.}, nw);
+    revision::sum_weights(v, nw);
+    BOOST_TEST(nw[v].weight_sum == 2.);
+
+    // the weights are not normalised while their sum is in range ...
+    BOOST_TEST(not revision::normalize_weights(v, nw));
+    BOOST_TEST(nw[boost::edge(v, w, nw).first].attr == 2.);
+
+    // ... and an edge is added on the scale of the normalised weights
+    revision::add_relative_edge(v, u, 0.5, nw);
+    BOOST_TEST(nw[boost::edge(v, u, nw).first].attr == 1.);
+    BOOST_TEST(nw[v].weight_sum == 3.);
+
+    // beyond the range, they are normalised
+    for (auto e : range<IterateOver::out_edges>(v, nw)) {
+        nw[e].attr *= std::ldexp(1., 40);
+    }
+    revision::sum_weights(v, nw);
+    BOOST_TEST(revision::normalize_weights(v, nw));
+    BOOST_TEST(nw[boost::edge(v, w, nw).first].attr == 2./3.);
+    BOOST_TEST(nw[boost::edge(v, u, nw).first].attr == 1./3.);
+    BOOST_TEST(nw[v].weight_sum == 1.);
+
+    // removing most of the weight takes the sum anew
+    revision::remove_weight(v, boost::edge(v, w, nw).first, nw);
+    BOOST_TEST(nw[v].weight_sum == 1./3.);
+    revision::remove_weight(v, boost::edge(v, u, nw).first, nw);
+    BOOST_TEST(nw[v].weight_sum == 0.);
+    BOOST_TEST(not revision::normalize_weights(v, nw));
 }
 
 
@@ -0,0 +1,300 @@
+#define BOOST_TEST_MODULE test checkpoint
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "../checkpoint.hh"
+#include "../sampling.hh"
+#include "../revision.hh"
+#include "../ageing.hh"
+#include "../OpDyn.hh"
+
+#include "fixtures.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// Saves the network and the RNG state to path, as the model does
+template<typename NWType>
+void save(const std::string& path, const NWType& g, const std::mt19937& rng) {
+    checkpoint::Writer out(path);
+    std::ostringstream rng_state;
+    rng_state << rng;
+    out.write(rng_state.str());
+    checkpoint::save_network(out, g, [](auto& out, const auto& u){
+        out.write(u.opinion);
+        out.write(u.tolerance);
+        out.write(u.susceptibility);
+        out.write(u.weight_sum);
+        out.write(u.age);
+        out.write(u.used_media);
+    });
+    out.commit();
+}
+
+/// Restores what save wrote
+template<typename NWType>
+NWType load(const std::string& path, std::mt19937& rng) {
+    checkpoint::Reader in(path);
+    std::istringstream rng_state(in.read<std::string>());
+    rng_state >> rng;
+    auto g = checkpoint::load_network<NWType>(in, [](auto& in, auto&& u){
+        in.read(u.opinion);
+        in.read(u.tolerance);
+        in.read(u.susceptibility);
+        in.read(u.weight_sum);
+        in.read(u.age);
+        in.read(u.used_media);
+    });
+    in.finish();
+    return g;
+}
+
+/// Runs revisions with rewiring and some ageing on g
+template<typename NWType>
+void evolve(NWType& g, std::mt19937& rng, const TestNetwork::Config& cfg) {
+    std::uniform_real_distribution<double> prob(0., 1.);
+    unsigned int rewiring_count = 0;
+    sampling::NeighbourSampler<NWType> sampler(num_vertices(g));
+    rewiring::Scratch<NWType> scratch(num_vertices(g));
+    const utils::SusceptibilityTable susceptibility(
+                                cfg["susceptibility"]["users"]["custom"]);
+    auto log = spdlog::get("root.OpDyn");
+
+    for (std::size_t step=1; step<=20; ++step) {
+        for (int i=0; i<100; ++i) {
+            revision::user_revision<Mode::Ageing>(g, 0.1, 0.8, rewiring_count,
+                                                  prob, 2., rng, sampler,
+                                                  scratch);
+        }
+        if (step % 10 == 5) {
+            ageing::ageing(0.03, 1, {1, 10}, {20, 40}, {75, 1000}, g, log,
+                           rng, susceptibility);
+            sampler.invalidate_all();
+        }
+    }
+}
+
+/// Checks that two networks have the same vertices and edges, in the same
+/// order and with the same properties
+template<typename NWType>
+void check_equal(const NWType& a, const NWType& b) {
+    BOOST_TEST(num_vertices(a) == num_vertices(b));
+    BOOST_TEST(num_edges(a) == num_edges(b));
+    for (auto [v, v_end] = vertices(a); v!=v_end; ++v) {
+        BOOST_TEST(a[*v].opinion == b[*v].opinion);
+        BOOST_TEST(a[*v].tolerance == b[*v].tolerance);
+        BOOST_TEST(a[*v].susceptibility == b[*v].susceptibility);
+        BOOST_TEST(a[*v].weight_sum == b[*v].weight_sum);
+        BOOST_TEST(a[*v].age == b[*v].age);
+        BOOST_TEST(a[*v].used_media == b[*v].used_media);
+    }
+
+    auto [e, e_end] = edges(a);
+    auto [f, f_end] = edges(b);
+    for (; e!=e_end and f!=f_end; ++e, ++f) {
+        BOOST_TEST(source(*e, a) == source(*f, b));
+        BOOST_TEST(target(*e, a) == target(*f, b));
+        BOOST_TEST(a[*e].attr == b[*f].attr);
+    }
+}
+
+/// Checks that the network restored from a checkpoint continues exactly as
+/// the original one
+template<typename NWType>
+void check_restart(NWType& g, const std::string& path,
+                   const TestNetwork::Config& cfg)
+{
+    std::mt19937 rng(7);
+    evolve(g, rng, cfg);
+    save(path, g, rng);
+
+    std::mt19937 restored_rng;
+    auto restored = load<NWType>(path, restored_rng);
+    BOOST_TEST((restored_rng == rng));
+    check_equal(g, restored);
+
+    evolve(g, rng, cfg);
+    evolve(restored, restored_rng, cfg);
+    check_equal(g, restored);
+}
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(checkpoint_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_restart)
+{
+    auto fnw = FlatNetwork_u::from(nw);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        fnw[*v].age = nw[*v].age;
+        fnw[*v].opinion = nw[*v].opinion;
+        fnw[*v].tolerance = nw[*v].tolerance;
+        fnw[*v].susceptibility = nw[*v].susceptibility;
+        fnw[*v].weight_sum = nw[*v].weight_sum;
+        fnw[*v].used_media = nw[*v].used_media;
+    }
+
+    check_restart(nw, "test_checkpoint.chk", cfg);
+    check_restart(fnw, "test_checkpoint_flat.chk", cfg);
+
+    // the temporary file was renamed
+    BOOST_TEST(not std::ifstream("test_checkpoint.chk.tmp"));
+}
+
+BOOST_AUTO_TEST_CASE(test_fenwick_tree)
+{
+    sampling::FenwickTree tree(37);
+    std::uniform_real_distribution<double> prob(0., 1.);
+    for (int i=0; i<50; ++i) {
+        tree.set(std::size_t(prob(rng) * 37), prob(rng));
+    }
+
+    {
+        checkpoint::Writer out("test_checkpoint_tree.chk");
+        tree.save(out);
+        out.commit();
+    }
+    sampling::FenwickTree restored;
+    {
+        checkpoint::Reader in("test_checkpoint_tree.chk");
+        restored.load(in);
+        in.finish();
+    }
+
+    // the same changes lead to the same draws, including the rebuilds
+    for (int i=0; i<100; ++i) {
+        const auto idx = std::size_t(prob(rng) * 37);
+        const double val = prob(rng);
+        tree.set(idx, val);
+        restored.set(idx, val);
+        const double frac = prob(rng);
+        BOOST_TEST(tree.sample(frac) == restored.sample(frac));
+        BOOST_TEST(tree.total() == restored.total());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_checkpoints)
+{
+    BOOST_CHECK_THROW(checkpoint::Reader("does_not_exist.chk"),
+                      std::runtime_error);
+
+    {
+        std::ofstream out("test_checkpoint_invalid.chk", std::ios::binary);
+        out << "not a checkpoint";
+    }
+    BOOST_CHECK_THROW(checkpoint::Reader("test_checkpoint_invalid.chk"),
+                      std::runtime_error);
+
+    // a checkpoint that was not committed is not there
+    std::remove("test_checkpoint_invalid.chk");
+    {
+        checkpoint::Writer out("test_checkpoint_invalid.chk");
+        out.write(std::uint64_t(1));
+    }
+    BOOST_CHECK_THROW(checkpoint::Reader("test_checkpoint_invalid.chk"),
+                      std::runtime_error);
+
+    // a truncated checkpoint
+    save("test_checkpoint_complete.chk", nw, rng);
+    {
+        std::ifstream in("test_checkpoint_complete.chk", std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+        std::ofstream out("test_checkpoint_invalid.chk", std::ios::binary);
+        out << content.substr(0, content.size() / 2);
+    }
+    std::mt19937 restored_rng;
+    BOOST_CHECK_THROW(load<Network_u>("test_checkpoint_invalid.chk",
+                                      restored_rng),
+                      std::runtime_error);
+
+    // the header is readable on its own, but the rest is missing
+    {
+        checkpoint::Writer out("test_checkpoint_invalid.chk");
+        checkpoint::Header header;
+        header.time = 100;
+        header.time_series = {"/OpDyn/nw_u/opinion"};
+        checkpoint::write_header(out, header);
+        out.commit();
+    }
+    const auto header = checkpoint::read_header("test_checkpoint_invalid.chk");
+    BOOST_TEST(header.time == 100u);
+    BOOST_TEST(header.time_series.size() == 1u);
+    checkpoint::Reader in("test_checkpoint_invalid.chk");
+    checkpoint::read_header(in);
+    BOOST_CHECK_NO_THROW(in.finish());
+    BOOST_CHECK_THROW(in.read<std::uint64_t>(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_truncate_datasets)
+{
+    // an output file with a time series of 5 rows
+    auto create = [](const std::string& path) {
+        const hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC,
+                                     H5P_DEFAULT, H5P_DEFAULT);
+        hsize_t dims[2] = {5, 3}, max_dims[2] = {H5S_UNLIMITED, 3},
+                chunks[2] = {1, 3};
+        const hid_t space = H5Screate_simple(2, dims, max_dims);
+        const hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(plist, 2, chunks);
+        const hid_t dset = H5Dcreate2(file, "opinion", H5T_NATIVE_DOUBLE,
+                                      space, H5P_DEFAULT, plist, H5P_DEFAULT);
+        H5Dclose(dset);
+        H5Pclose(plist);
+        H5Sclose(space);
+        H5Fclose(file);
+    };
+    auto rows = [](const std::string& path) {
+        const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        const hid_t dset = H5Dopen2(file, "opinion", H5P_DEFAULT);
+        const hid_t space = H5Dget_space(dset);
+        hsize_t dims[2];
+        H5Sget_simple_extent_dims(space, dims, nullptr);
+        H5Sclose(space);
+        H5Dclose(dset);
+        H5Fclose(file);
+        return dims[0];
+    };
+
+    checkpoint::Header header;
+    header.time_series = {"opinion"};
+
+    // the rows written after the checkpoint are removed
+    create("test_checkpoint_output.h5");
+    header.num_writes = 3;
+    checkpoint::truncate_datasets("test_checkpoint_output.h5", header);
+    BOOST_TEST(rows("test_checkpoint_output.h5") == 3u);
+
+    // rows the checkpoint records, but which never reached the file, cannot
+    // be restored
+    header.num_writes = 4;
+    BOOST_CHECK_THROW(checkpoint::truncate_datasets(
+                                    "test_checkpoint_output.h5", header),
+                      std::runtime_error);
+    BOOST_TEST(rows("test_checkpoint_output.h5") == 3u);
+
+    header.time_series = {"does_not_exist"};
+    BOOST_CHECK_THROW(checkpoint::truncate_datasets(
+                                    "test_checkpoint_output.h5", header),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,170 @@
+#define BOOST_TEST_MODULE test convergence
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+
+#include "../checkpoint.hh"
+#include "../convergence.hh"
+#include "../parallel.hh"
+#include "../revision.hh"
+
+#include "fixtures.hh"
+
+namespace Utopia::Models::OpDyn {
+
+struct Opinion {
+    double opinion = 0.;
+};
+
+using OpinionNetwork = boost::adjacency_list<boost::vecS, boost::vecS,
+                                             boost::directedS, Opinion>;
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_indicators, * boost::unit_test::tolerance(1e-12))
+{
+    OpinionNetwork nw(4);
+    convergence::Monitor monitor(0.01, 0.1, 2);
+    monitor.reset(nw, 0, 0);
+    BOOST_TEST(std::isnan(monitor.indicators().max_opinion_change));
+
+    // no evaluation before a sweep has passed
+    nw[0].opinion = 0.5;
+    BOOST_TEST(not monitor.update(nw, 1, 3, 1));
+    BOOST_TEST(std::isnan(monitor.indicators().max_opinion_change));
+
+    nw[1].opinion = -0.1;
+    BOOST_TEST(not monitor.update(nw, 2, 5, 1));
+    BOOST_TEST(monitor.indicators().max_opinion_change == 0.5);
+    BOOST_TEST(monitor.indicators().mean_opinion_change == 0.15);
+    BOOST_TEST(monitor.indicators().rewiring_rate == 0.2);
+    BOOST_TEST(monitor.quiet_sweeps() == 0u);
+
+    // small changes, but too many rewirings
+    nw[2].opinion = 0.005;
+    BOOST_TEST(not monitor.update(nw, 3, 9, 2));
+    BOOST_TEST(monitor.indicators().max_opinion_change == 0.005);
+    BOOST_TEST(monitor.indicators().rewiring_rate == 0.25);
+    BOOST_TEST(monitor.quiet_sweeps() == 0u);
+
+    // two quiet sweeps in a row
+    BOOST_TEST(not monitor.update(nw, 4, 13, 2));
+    BOOST_TEST(monitor.quiet_sweeps() == 1u);
+    BOOST_TEST(not monitor.converged());
+    BOOST_TEST(monitor.convergence_time() == -1);
+
+    nw[3].opinion = 0.01;
+    BOOST_TEST(monitor.update(nw, 6, 20, 2));
+    BOOST_TEST(monitor.converged());
+    BOOST_TEST(monitor.convergence_time() == 6);
+    BOOST_TEST(monitor.indicators().mean_opinion_change == 0.0025);
+
+    // the time of convergence is kept
+    nw[0].opinion = 1.;
+    BOOST_TEST(not monitor.update(nw, 7, 30, 2));
+    BOOST_TEST(monitor.convergence_time() == 6);
+
+    BOOST_CHECK_THROW(convergence::Monitor(0.01, 0.1, 0),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_restore)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> distr(0., 1.);
+
+    OpinionNetwork nw(50);
+    convergence::Monitor monitor(0.05, 0.5, 3);
+    monitor.reset(nw, 0, 0);
+
+    // opinions that change less and less
+    std::uint64_t revisions = 0;
+    double amplitude = 1.;
+    auto evolve = [&](convergence::Monitor& m, OpinionNetwork& g,
+                      std::mt19937& r) {
+        for (auto [v, v_end] = boost::vertices(g); v!=v_end; ++v) {
+            g[*v].opinion += amplitude * (distr(r) - 0.5);
+        }
+        amplitude *= 0.7;
+        revisions += 20;
+        return m.update(g, revisions / 20, revisions, revisions / 10);
+    };
+
+    for (int i=0; i<4; ++i) {
+        evolve(monitor, nw, rng);
+    }
+    {
+        checkpoint::Writer out("test_convergence.chk");
+        monitor.save(out);
+        out.commit();
+    }
+    convergence::Monitor restored(0.05, 0.5, 3);
+    {
+        checkpoint::Reader in("test_convergence.chk");
+        restored.load(in);
+        in.finish();
+    }
+    BOOST_TEST(restored.quiet_sweeps() == monitor.quiet_sweeps());
+
+    // both continue identically
+    auto restored_nw = nw;
+    auto restored_rng = rng;
+    const auto restored_revisions = revisions;
+    const auto restored_amplitude = amplitude;
+    while (not evolve(monitor, nw, rng)) { }
+
+    revisions = restored_revisions;
+    amplitude = restored_amplitude;
+    while (not evolve(restored, restored_nw, restored_rng)) { }
+
+    BOOST_TEST(restored.convergence_time() == monitor.convergence_time());
+    BOOST_TEST(restored.indicators().max_opinion_change
+               == monitor.indicators().max_opinion_change);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_rewiring_rate, TestNetwork)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    sampling::NeighbourSampler<Network_u> sampler(boost::num_vertices(nw));
+    rewiring::Scratch<Network_u> scratch(boost::num_vertices(nw));
+    revision::BatchScratch<Network_u> batch_scratch;
+    parallel::ThreadPool pool(4);
+    parallel::ConflictColouring<Network_u> colouring(boost::num_vertices(nw));
+
+    unsigned int rewiring_count = 0;
+    std::uint64_t revisions = 0;
+    convergence::Monitor monitor(0.01, 0., 1);
+    monitor.reset(nw, revisions, rewiring_count);
+
+    // the rewirings of the sequential revisions are counted
+    for (; revisions<boost::num_vertices(nw); ++revisions) {
+        revision::user_revision<Mode::None>(nw, 0.1, 0.8, rewiring_count,
+                                            prob, 2., rng, sampler, scratch);
+    }
+    BOOST_TEST(rewiring_count > 0u);
+    BOOST_TEST(not monitor.update(nw, 1, revisions, rewiring_count));
+    BOOST_TEST(monitor.indicators().rewiring_rate > 0.);
+
+    // and so are those of the parallel revisions
+    const auto sequential_count = rewiring_count;
+    std::vector<TestNetwork::vertex> batch;
+    for (std::size_t i=0; i<boost::num_vertices(nw); ++i) {
+        batch.push_back(boost::random_vertex(nw, rng));
+    }
+    revision::parallel_user_revision<Mode::None>(nw, batch, 0.1, 0.8,
+                                                 rewiring_count, prob, 2.,
+                                                 42, 0, sampler, colouring,
+                                                 scratch, batch_scratch, pool);
+    revisions += batch.size();
+    BOOST_TEST(rewiring_count > sequential_count);
+    BOOST_TEST(not monitor.update(nw, 2, revisions, rewiring_count));
+    BOOST_TEST(monitor.indicators().rewiring_rate > 0.);
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,185 @@
+#define BOOST_TEST_MODULE test events
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "../events.hh"
+#include "../revision.hh"
+#include "../ageing.hh"
+#include "../OpDyn.hh"
+
+#include "fixtures.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// The sorted edge list of a network
+template<typename NWType>
+std::vector<events::Edge> edge_list(const NWType& g) {
+    std::vector<events::Edge> list;
+    for (auto [e, e_end] = edges(g); e!=e_end; ++e) {
+        list.emplace_back(source(*e, g), target(*e, g));
+    }
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+/// Runs revisions with frequent rewiring and some ageing on g, recording the
+/// edge events to path, and returns the edge list at the end of each step
+template<typename NWType>
+std::vector<std::vector<events::Edge>> record(NWType& g,
+                                              const std::string& path,
+                                              const TestNetwork::Config& cfg)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> prob(0., 1.);
+    unsigned int rewiring_count = 0;
+    sampling::NeighbourSampler<NWType> sampler(num_vertices(g));
+    rewiring::Scratch<NWType> scratch(num_vertices(g));
+    const utils::SusceptibilityTable susceptibility(
+                                cfg["susceptibility"]["users"]["custom"]);
+    auto log = spdlog::get("root.OpDyn");
+
+    // with a small buffer, the records are written in many pieces
+    events::EdgeLog edge_log(path, num_vertices(g), false, 64);
+    edge_log.keyframe(g);
+
+    std::vector<std::vector<events::Edge>> history = {edge_list(g)};
+    for (std::size_t step=1; step<=40; ++step) {
+        edge_log.begin_step(step);
+        for (int i=0; i<100; ++i) {
+            revision::user_revision<Mode::Ageing>(g, 0.1, 0.8, rewiring_count,
+                                                  prob, 2., rng, sampler,
+                                                  scratch, &edge_log);
+        }
+        if (step % 10 == 5) {
+            ageing::ageing(0.03, 1, {1, 10}, {20, 40}, {75, 1000}, g, log,
+                           rng, susceptibility, &edge_log);
+            sampler.invalidate_all();
+        }
+        if (step % 7 == 0) {
+            edge_log.keyframe(g);
+        }
+        history.push_back(edge_list(g));
+    }
+    return history;
+}
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(events_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_reconstruction)
+{
+    auto fnw = FlatNetwork_u::from(nw);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        fnw[*v].age = nw[*v].age;
+        fnw[*v].opinion = nw[*v].opinion;
+        fnw[*v].tolerance = nw[*v].tolerance;
+        fnw[*v].susceptibility = nw[*v].susceptibility;
+        fnw[*v].weight_sum = nw[*v].weight_sum;
+        fnw[*v].used_media = nw[*v].used_media;
+    }
+
+    const auto history = record(nw, "test_events.bin", cfg);
+    const auto flat_history = record(fnw, "test_events_flat.bin", cfg);
+
+    // the network changed
+    BOOST_TEST((history.front() != history.back()));
+
+    for (const auto& [path, hist] : {std::make_pair("test_events.bin",
+                                                    &history),
+                                     std::make_pair("test_events_flat.bin",
+                                                    &flat_history)})
+    {
+        events::EdgeLogReader reader(path);
+        BOOST_TEST(reader.num_vertices() == 300u);
+        BOOST_TEST(reader.last_step() == 40u);
+        const std::vector<std::uint64_t> keyframes = {0, 7, 14, 21, 28, 35};
+        BOOST_TEST(reader.keyframe_steps() == keyframes,
+                   boost::test_tools::per_element());
+
+        // every step, in any order
+        for (std::size_t step : {40, 0, 13, 14, 15, 5, 6, 35, 22, 1}) {
+            BOOST_TEST_CONTEXT("Step: " << step) {
+                BOOST_TEST((reader.edges_at(step) == (*hist)[step]));
+            }
+        }
+        for (std::size_t step=0; step<=40; ++step) {
+            BOOST_TEST((reader.edges_at(step) == (*hist)[step]));
+        }
+        BOOST_TEST((reader.edges_at(100) == hist->back()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_restart)
+{
+    const auto history = record(nw, "test_events_restart.bin", cfg);
+
+    // a run restarted at step 20 from a network with other edges
+    Network_u restarted(num_vertices(nw));
+    boost::add_edge(0, 1, restarted);
+    boost::add_edge(1, 2, restarted);
+    {
+        events::EdgeLog edge_log("test_events_restart.bin",
+                                 num_vertices(nw), true);
+        edge_log.begin_step(20);
+        edge_log.keyframe(restarted);
+        edge_log.begin_step(21);
+        edge_log.remove(0, 1);
+    }
+
+    events::EdgeLogReader reader("test_events_restart.bin");
+    const std::vector<std::uint64_t> keyframes = {0, 7, 14, 20};
+    BOOST_TEST(reader.keyframe_steps() == keyframes,
+               boost::test_tools::per_element());
+    BOOST_TEST((reader.edges_at(19) == history[19]));
+    BOOST_TEST((reader.edges_at(20) == edge_list(restarted)));
+    const std::vector<events::Edge> edges_21 = {{1, 2}};
+    BOOST_TEST((reader.edges_at(21) == edges_21));
+    BOOST_TEST((reader.edges_at(40) == edges_21));
+
+    // only a log of the same network can be continued
+    BOOST_CHECK_THROW(events::EdgeLog("test_events_restart.bin", 10, true),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_logs)
+{
+    BOOST_CHECK_THROW(events::EdgeLogReader("does_not_exist.bin"),
+                      std::runtime_error);
+
+    {
+        std::ofstream out("test_events_invalid.bin", std::ios::binary);
+        out << "not an edge event log";
+    }
+    BOOST_CHECK_THROW(events::EdgeLogReader("test_events_invalid.bin"),
+                      std::runtime_error);
+
+    // a log without the initial keyframe
+    {
+        events::EdgeLog edge_log("test_events_invalid.bin", 10);
+        edge_log.begin_step(1);
+        edge_log.add(1, 2);
+    }
+    BOOST_CHECK_THROW(events::EdgeLogReader("test_events_invalid.bin"),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,189 @@
+#define BOOST_TEST_MODULE test flat network
+
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+#include <utopia/data_io/cfg_utils.hh>
+
+#include "../flat_network.hh"
+#include "../revision.hh"
+#include "../ageing.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// A boost user network and its flat copy with identical properties
+struct TestNetworks {
+    using RNG = std::mt19937;
+    using Config = Utopia::DataIO::Config;
+
+    RNG rng;
+    Network_u nw;
+    FlatNetwork_u fnw;
+    Config cfg;
+
+    TestNetworks()
+    :
+        rng(42),
+        nw{},
+        fnw{},
+        cfg(YAML::LoadFile("test_config.yml"))
+    {
+        if (not spdlog::get("root.OpDyn")) {
+            spdlog::stdout_color_mt("root.OpDyn");
+        }
+
+        boost::generate_random_graph(nw, 500, 5000, rng, false, false);
+
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            nw[*v].age = utils::get_rand_int(1, 91, rng);
+            nw[*v].opinion = utils::get_rand_double(0., 1., rng);
+            nw[*v].tolerance = utils::get_rand_double(0.1, 0.4, rng);
+            nw[*v].susceptibility = utils::get_rand_double(0., 0.5, rng);
+            nw[*v].used_media = 0;
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+                nw[*e].attr = 1. / double(boost::out_degree(*v, nw));
+            }
+            revision::sum_weights(*v, nw);
+        }
+
+        fnw = FlatNetwork_u::from(nw);
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            fnw[*v].age = nw[*v].age;
+            fnw[*v].opinion = nw[*v].opinion;
+            fnw[*v].tolerance = nw[*v].tolerance;
+            fnw[*v].susceptibility = nw[*v].susceptibility;
+            fnw[*v].weight_sum = nw[*v].weight_sum;
+            fnw[*v].used_media = nw[*v].used_media;
+        }
+    }
+
+    /// Check that both networks hold exactly the same state
+    void check_identical() {
+        BOOST_TEST(num_edges(fnw) == boost::num_edges(nw));
+
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            BOOST_TEST(fnw[*v].opinion == nw[*v].opinion);
+            BOOST_TEST(fnw[*v].tolerance == nw[*v].tolerance);
+            BOOST_TEST(fnw[*v].age == nw[*v].age);
+            BOOST_TEST(out_degree(*v, fnw) == boost::out_degree(*v, nw));
+            BOOST_TEST(in_degree(*v, fnw) == boost::in_degree(*v, nw));
+
+            auto fe = out_edges(*v, fnw).first;
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end;
+                 ++e, ++fe)
+            {
+                BOOST_TEST(target(*fe, fnw) == boost::target(*e, nw));
+                BOOST_TEST(fnw[*fe].attr == nw[*e].attr);
+            }
+
+            auto fi = in_edges(*v, fnw).first;
+            for (auto [e, e_end] = boost::in_edges(*v, nw); e!=e_end;
+                 ++e, ++fi)
+            {
+                BOOST_TEST(source(*fi, fnw) == boost::source(*e, nw));
+                BOOST_TEST(fnw[*fi].attr == nw[*e].attr);
+            }
+        }
+    }
+};
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(flat_network_suite, TestNetworks)
+
+BOOST_AUTO_TEST_CASE(test_conversion)
+{
+    BOOST_TEST(num_vertices(fnw) == boost::num_vertices(nw));
+    check_identical();
+
+    // the edge iterator visits every edge exactly once, grouped by source
+    std::size_t count = 0;
+    auto [be, be_end] = boost::edges(nw);
+    for (auto [e, e_end] = edges(fnw); e!=e_end; ++e, ++be, ++count) {
+        BOOST_TEST(source(*e, fnw) == boost::source(*be, nw));
+        BOOST_TEST(target(*e, fnw) == boost::target(*be, nw));
+    }
+    BOOST_TEST(count == num_edges(fnw));
+}
+
+BOOST_AUTO_TEST_CASE(test_edge_surgery)
+{
+    // apply the same random sequence of structural changes to both networks;
+    // adding many edges to few vertices forces blocks to move and compact
+    for (int i=0; i<20000; ++i) {
+        const auto u = utils::get_rand_int(0, 50, rng);
+        const auto w = utils::get_rand_int(0, 500, rng);
+        const auto op = utils::get_rand_int(0, 10, rng);
+
+        if (op < 6) {
+            const double weight = utils::get_rand_double(0., 1., rng);
+            const auto added = add_edge(u, w, {weight}, fnw).second;
+            BOOST_TEST(added == boost::add_edge(u, w, {weight}, nw).second);
+        }
+        else if (op < 9) {
+            remove_edge(u, w, fnw);
+            boost::remove_edge(u, w, nw);
+        }
+        else {
+            clear_vertex(w, fnw);
+            boost::clear_vertex(w, nw);
+        }
+    }
+    check_identical();
+
+    for (auto [v, v_end] = vertices(fnw); v!=v_end; ++v) {
+        for (auto [w, w_end] = adjacent_vertices(*v, fnw); w!=w_end; ++w) {
+            BOOST_TEST(edge(*v, *w, fnw).second);
+            BOOST_TEST(edge(*v, *w, fnw).first.tgt == *w);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_identical_dynamics)
+{
+    // Both backends iterate edges in the same order, hence they consume the
+    // same random numbers and must produce bit-identical states.
+    std::mt19937 rng_a(123), rng_b(123);
+    std::uniform_real_distribution<double> prob(0., 1.);
+    unsigned int rw_a = 0, rw_b = 0;
+    sampling::NeighbourSampler<Network_u> sampler_a(num_vertices(nw));
+    sampling::NeighbourSampler<FlatNetwork_u> sampler_b(num_vertices(fnw));
+    rewiring::Scratch<Network_u> scratch_a(num_vertices(nw));
+    rewiring::Scratch<FlatNetwork_u> scratch_b(num_vertices(fnw));
+
+    for (int i=0; i<20000; ++i) {
+        revision::user_revision<Mode::Ageing>(nw, 0.1, 0.4, rw_a, prob, 2.,
+                                              rng_a, sampler_a, scratch_a);
+        revision::user_revision<Mode::Ageing>(fnw, 0.1, 0.4, rw_b, prob, 2.,
+                                              rng_b, sampler_b, scratch_b);
+    }
+    check_identical();
+
+    auto log = spdlog::get("root.OpDyn");
+    const utils::SusceptibilityTable custom(
+                                cfg["susceptibility"]["users"]["custom"]);
+    ageing::ageing(0.03, 1, {1, 10}, {20, 40}, {75, 1000}, nw, log, rng_a,
+                   custom);
+    ageing::ageing(0.03, 1, {1, 10}, {20, 40}, {75, 1000}, fnw, log, rng_b,
+                   custom);
+    check_identical();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
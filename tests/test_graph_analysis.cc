@@ -0,0 +1,247 @@
+#define BOOST_TEST_MODULE test graph analysis
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+
+#include "../graph_analysis.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Type definitions --------------------------------------------------------
+
+using vertex = boost::graph_traits<Network_u>::vertex_descriptor;
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// Random network with random opinions, tolerances and weights, which are not
+/// normalised, and their sums
+struct TestNetwork {
+    std::mt19937 rng;
+    Network_u nw;
+
+    TestNetwork()
+    :
+        rng(42),
+        nw{}
+    {
+        boost::generate_random_graph(nw, 500, 1000, rng, false, false);
+
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            nw[*v].opinion = utils::get_rand_double(0., 1., rng);
+            nw[*v].tolerance = utils::get_rand_double(0., 0.4, rng);
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+                nw[*e].attr = utils::get_rand_double(0., 1., rng);
+            }
+            revision::sum_weights(*v, nw);
+        }
+    }
+
+    /// The clusters found by a breadth-first search along in and out edges
+    /// for which the predicate holds
+    template<typename Predicate>
+    std::vector<std::vector<size_t>> bfs_clusters(Predicate&& joins) {
+        std::vector<std::vector<size_t>> clusters;
+        std::vector<bool> seen(boost::num_vertices(nw), false);
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            if (seen[*v]) {
+                continue;
+            }
+            clusters.emplace_back();
+            std::queue<vertex> queue;
+            queue.push(*v);
+            seen[*v] = true;
+            while (not queue.empty()) {
+                const auto u = queue.front();
+                queue.pop();
+                clusters.back().push_back(u);
+                for (auto [e, e_end] = boost::out_edges(u, nw); e!=e_end; ++e) {
+                    const auto w = boost::target(*e, nw);
+                    if (not seen[w] and joins(*e)) {
+                        seen[w] = true;
+                        queue.push(w);
+                    }
+                }
+                for (auto [e, e_end] = boost::in_edges(u, nw); e!=e_end; ++e) {
+                    const auto w = boost::source(*e, nw);
+                    if (not seen[w] and joins(*e)) {
+                        seen[w] = true;
+                        queue.push(w);
+                    }
+                }
+            }
+            std::sort(clusters.back().begin(), clusters.back().end());
+        }
+        return clusters;
+    }
+};
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_disjoint_sets)
+{
+    Graph_Analysis::DisjointSets ds(6);
+    BOOST_TEST(ds.num_sets() == 6);
+
+    ds.unite(0, 3);
+    ds.unite(4, 3);
+    ds.unite(3, 0);
+    ds.unite(1, 5);
+    BOOST_TEST(ds.num_sets() == 3);
+    BOOST_TEST(ds.find(0) == ds.find(4));
+    BOOST_TEST(ds.find(1) == ds.find(5));
+    BOOST_TEST(ds.find(0) != ds.find(2));
+
+    const std::vector<std::vector<size_t>> expected = {{0, 3, 4}, {1, 5}, {2}};
+    BOOST_TEST((ds.sets() == expected));
+}
+
+BOOST_FIXTURE_TEST_SUITE(graph_analysis_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_opinion_clusters)
+{
+    // with a fixed tolerance ...
+    const auto oc = Graph_Analysis::opinion_clusters(nw, 0.1);
+    const auto bfs = bfs_clusters([this](auto e){
+        return fabs(nw[boost::source(e, nw)].opinion
+                    - nw[boost::target(e, nw)].opinion) <= 0.1;
+    });
+    BOOST_TEST((oc == bfs));
+    BOOST_TEST(Graph_Analysis::num_opinion_clusters(nw, 0.1) == bfs.size());
+
+    // ... and with the tolerance of the users
+    const auto oc_u = Graph_Analysis::opinion_clusters(nw);
+    const auto bfs_u = bfs_clusters([this](auto e){
+        const auto s = boost::source(e, nw);
+        return fabs(nw[s].opinion - nw[boost::target(e, nw)].opinion)
+               <= nw[s].tolerance;
+    });
+    BOOST_TEST((oc_u == bfs_u));
+    BOOST_TEST(Graph_Analysis::num_opinion_clusters(nw) == bfs_u.size());
+
+    // the flat network gives the same clusters
+    auto fnw = FlatNetwork_u::from(nw);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        fnw[*v].opinion = nw[*v].opinion;
+        fnw[*v].tolerance = nw[*v].tolerance;
+    }
+    BOOST_TEST((Graph_Analysis::opinion_clusters(fnw) == bfs_u));
+}
+
+BOOST_AUTO_TEST_CASE(test_weighted_opinion_clusters)
+{
+    const auto woc = Graph_Analysis::weighted_opinion_clusters(nw, 0.2, 0.5);
+    const auto bfs = bfs_clusters([this](auto e){
+        const auto s = boost::source(e, nw);
+        return (fabs(nw[s].opinion - nw[boost::target(e, nw)].opinion) <= 0.2)
+               and (nw[e].attr / nw[s].weight_sum * boost::out_degree(s, nw)
+                    >= 0.5);
+    });
+    BOOST_TEST((woc == bfs));
+    BOOST_TEST(Graph_Analysis::num_weighted_opinion_clusters(nw, 0.2, 0.5)
+               == bfs.size());
+
+    // the weight condition can only split clusters
+    BOOST_TEST(Graph_Analysis::num_weighted_opinion_clusters(nw)
+               >= Graph_Analysis::num_opinion_clusters(nw));
+}
+
+BOOST_AUTO_TEST_CASE(test_betweenness_centrality,
+                     * boost::unit_test::tolerance(1e-9))
+{
+    // the exact parallel computation matches the serial boost implementation
+    auto reference = Graph_Analysis::betweenness_centrality(nw);
+    auto rel_reference = Graph_Analysis::relative_betweenness_centrality(nw);
+
+    parallel::ThreadPool pool(4);
+    const auto bc = Graph_Analysis::betweenness_centrality(nw, pool, 0, rng);
+    const auto rel_bc = Graph_Analysis::relative_betweenness_centrality(
+                                                            nw, pool, 0, rng);
+    BOOST_TEST(bc.centrality == reference, boost::test_tools::per_element());
+    BOOST_TEST(rel_bc.centrality == rel_reference,
+               boost::test_tools::per_element());
+    for (const auto err : bc.error) {
+        BOOST_TEST(err == 0.);
+    }
+
+    // as does the one on the flat network
+    const auto fnw = FlatNetwork_u::from(nw);
+    const auto flat_bc = Graph_Analysis::betweenness_centrality(fnw, pool, 0,
+                                                                rng);
+    BOOST_TEST(flat_bc.centrality == reference,
+               boost::test_tools::per_element());
+
+    // sampling all vertices is exact
+    const auto all = Graph_Analysis::betweenness_centrality(
+                                        nw, pool, boost::num_vertices(nw), rng);
+    BOOST_TEST(all.centrality == reference, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(test_sampled_betweenness_centrality)
+{
+    parallel::ThreadPool pool(3);
+    const auto exact = Graph_Analysis::betweenness_centrality(nw, pool, 0, rng);
+    const auto sampled = Graph_Analysis::betweenness_centrality(nw, pool, 200,
+                                                                rng);
+
+    // the exact values are mostly within three standard errors; the error
+    // vanishes only for vertices without any dependency in the sample
+    std::size_t within = 0;
+    for (std::size_t v=0; v<boost::num_vertices(nw); ++v) {
+        BOOST_TEST(sampled.error[v] >= 0.);
+        if (fabs(sampled.centrality[v] - exact.centrality[v])
+            <= 3. * sampled.error[v] + 1e-9)
+        {
+            ++within;
+        }
+    }
+    BOOST_TEST(within >= 0.9 * boost::num_vertices(nw));
+
+    // the same seed gives the same sample, for any number of threads
+    parallel::ThreadPool single(1);
+    std::mt19937 rng_a(3), rng_b(3);
+    const auto a = Graph_Analysis::betweenness_centrality(nw, pool, 50, rng_a);
+    const auto b = Graph_Analysis::betweenness_centrality(nw, single, 50,
+                                                          rng_b);
+    for (std::size_t v=0; v<boost::num_vertices(nw); ++v) {
+        BOOST_TEST(fabs(a.centrality[v] - b.centrality[v])
+                   <= 1e-9 * (1. + a.centrality[v]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE(test_large_cluster)
+{
+    // a single cluster along a long chain, which a recursive search could
+    // not handle
+    const size_t n = 1000000;
+    Network_u chain(n);
+    for (size_t v=0; v+1<n; ++v) {
+        chain[v].opinion = 0.5;
+        chain[v].tolerance = 0.1;
+        boost::add_edge(v+1, v, chain);
+    }
+    chain[n-1].opinion = 0.5;
+    chain[n-1].tolerance = 0.1;
+
+    BOOST_TEST(Graph_Analysis::num_opinion_clusters(chain) == 1u);
+
+    chain[n/2].opinion = 1.;
+    BOOST_TEST(Graph_Analysis::num_opinion_clusters(chain) == 3u);
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,99 @@
+#define BOOST_TEST_MODULE test observables
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../observables.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_moments, * boost::unit_test::tolerance(1e-10))
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> distr(0., 1.);
+    std::vector<double> x(1000);
+    for (auto& val : x) {
+        val = distr(rng);
+    }
+
+    auto identity = [](double val) { return val; };
+    const auto m = observables::moments(x.begin(), x.end(), identity);
+
+    // compare with the direct computations
+    double mean = 0.;
+    for (const auto val : x) {
+        mean += val / x.size();
+    }
+    double var = 0.;
+    double p = 0.;
+    for (const auto xi : x) {
+        var += (xi - mean) * (xi - mean) / x.size();
+        for (const auto xj : x) {
+            p += (xi - xj) * (xi - xj);
+        }
+    }
+
+    BOOST_TEST(m.n == x.size());
+    BOOST_TEST(m.mean == mean);
+    BOOST_TEST(m.variance == var);
+    BOOST_TEST(m.polarization() == p);
+    BOOST_TEST(m.range() == *std::max_element(x.begin(), x.end())
+                            - *std::min_element(x.begin(), x.end()));
+
+    // no values
+    const auto empty = observables::moments(x.end(), x.end(), identity);
+    BOOST_TEST(empty.n == 0u);
+    BOOST_TEST(empty.polarization() == 0.);
+}
+
+BOOST_AUTO_TEST_CASE(test_histogram)
+{
+    const std::vector<double> x = {-0.1, 0., 0.05, 0.1, 0.55, 1., 1.1};
+    const auto hist = observables::histogram(x.begin(), x.end(),
+                                             [](double val){ return val; },
+                                             10);
+
+    // the last bin includes 1, values outside [0, 1] are dropped
+    const std::vector<std::size_t> expected = {2, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+    BOOST_TEST(hist == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(test_localization, * boost::unit_test::tolerance(1e-12))
+{
+    // 1 for a single occupied bin, 1/k for k equally occupied bins
+    BOOST_TEST(observables::localization({0, 0, 7, 0}) == 1.);
+    BOOST_TEST(observables::localization({3, 3, 3, 3}) == 0.25);
+    BOOST_TEST(observables::localization({0, 5, 0, 5}) == 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(test_number_of_peaks)
+{
+    std::vector<std::size_t> hist(40, 0);
+    hist[2] = 20;                       // peak
+    hist[8] = hist[9] = hist[10] = 30;  // flat peak
+    hist[14] = 5;                       // not prominent
+    hist[20] = 40;                      // peak ...
+    hist[21] = 10;
+    hist[22] = 25;                      // ... and a close, lower one
+    hist[30] = 50;                      // peak ...
+    for (std::size_t i=31; i<36; ++i) {
+        hist[i] = 40;
+    }
+    hist[36] = 48;                      // ... and a shoulder
+
+    BOOST_TEST(observables::number_of_peaks(hist, 15., 1) == 5u);
+    BOOST_TEST(observables::number_of_peaks(hist, 15., 5) == 4u);
+    BOOST_TEST(observables::number_of_peaks(hist, 4., 1) == 7u);
+
+    // a single peak in the middle of a plateau, and none at the boundary
+    BOOST_TEST(observables::number_of_peaks({50, 0, 0, 0, 0}, 1., 1) == 0u);
+    BOOST_TEST(observables::number_of_peaks({0, 0, 0, 0, 0}, 0., 1) == 0u);
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,184 @@
+#define BOOST_TEST_MODULE test output
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <utopia/core/types.hh>
+
+#include "../output.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// Records the values and attributes written to it
+struct MockDataSet {
+    std::vector<double> values;
+    bool is_float = false;
+    std::size_t bytes = 0;
+    std::vector<std::string> attributes;
+
+    template<typename It, typename Adaptor>
+    void write(It first, It last, Adaptor&& f) {
+        for (; first!=last; ++first) {
+            const auto val = f(*first);
+            is_float = std::is_floating_point_v<decltype(val)>;
+            bytes = sizeof(val);
+            values.push_back(val);
+        }
+    }
+
+    template<typename T>
+    void add_attribute(const std::string& name, T&&) {
+        attributes.push_back(name);
+    }
+};
+
+const auto cfg = YAML::Load(
+    "{opinion_u: {chunksize: [10, 3000], compression: 9, quantization: 16},"
+    " tolerance_u: {chunksize: [], compression: 5, quantization: 0},"
+    " age_u: {chunksize: [], compression: 5, quantization: 8},"
+    " bad_level: {chunksize: [], compression: 10, quantization: 0},"
+    " bad_bits: {chunksize: [], compression: 5, quantization: 12}}");
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_dataset_spec)
+{
+    const output::DatasetSpec spec("opinion_u", cfg, true);
+    const std::vector<hsize_t> chunks = {10, 3000};
+    BOOST_TEST(spec.chunksize == chunks, boost::test_tools::per_element());
+    BOOST_TEST(spec.compression == 9u);
+    BOOST_TEST(spec.quantization == 16u);
+    BOOST_TEST(spec.scale_factor() == 1. / 65535.);
+
+    const output::DatasetSpec plain("tolerance_u", cfg, true);
+    BOOST_TEST(plain.chunksize.empty());
+    BOOST_TEST(plain.quantization == 0u);
+
+    BOOST_CHECK_THROW(output::DatasetSpec("age_u", cfg, false),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(output::DatasetSpec("bad_level", cfg, true),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(output::DatasetSpec("bad_bits", cfg, true),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_quantization)
+{
+    BOOST_TEST(output::quantize<std::uint8_t>(0.) == 0u);
+    BOOST_TEST(output::quantize<std::uint8_t>(1.) == 255u);
+    BOOST_TEST(output::quantize<std::uint8_t>(1.5) == 255u);
+    BOOST_TEST(output::quantize<std::uint8_t>(-0.5) == 0u);
+    BOOST_TEST(output::quantize<std::uint16_t>(1.) == 65535u);
+
+    // the error is at most half a quantization step
+    for (int i=0; i<=1000; ++i) {
+        const double x = i / 1000.;
+        const double x8 = output::quantize<std::uint8_t>(x) / 255.;
+        const double x16 = output::quantize<std::uint16_t>(x) / 65535.;
+        BOOST_TEST(fabs(x8 - x) <= 0.5 / 255. + 1e-15);
+        BOOST_TEST(fabs(x16 - x) <= 0.5 / 65535. + 1e-15);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_write_unit_interval)
+{
+    const std::vector<double> x = {0., 0.25, 0.5, 1.};
+    auto value = [&](std::size_t i) { return x[i]; };
+    const std::vector<std::size_t> idx = {0, 1, 2, 3};
+
+    MockDataSet plain;
+    output::DatasetSpec plain_spec("tolerance_u", cfg, true);
+    output::write_unit_interval(plain, plain_spec, idx.begin(), idx.end(),
+                                value);
+    output::add_attributes(plain, plain_spec);
+    BOOST_TEST(plain.is_float);
+    BOOST_TEST(plain.bytes == sizeof(float));
+    BOOST_TEST(plain.values == x, boost::test_tools::per_element());
+    BOOST_TEST(plain.attributes.empty());
+
+    MockDataSet quantized;
+    output::DatasetSpec spec("opinion_u", cfg, true);
+    output::write_unit_interval(quantized, spec, idx.begin(), idx.end(),
+                                value);
+    output::add_attributes(quantized, spec);
+    BOOST_TEST(not quantized.is_float);
+    BOOST_TEST(quantized.bytes == 2u);
+    const std::vector<double> expected = {0., 16384., 32768., 65535.};
+    BOOST_TEST(quantized.values == expected, boost::test_tools::per_element());
+    BOOST_TEST(quantized.attributes.size() == 3u);
+}
+
+BOOST_AUTO_TEST_CASE(test_buffered_writer)
+{
+    using Buffer = std::vector<int>;
+
+    for (const bool asynchronous : {false, true}) {
+        std::vector<int> written;
+        std::atomic<int> pending(0);
+        int max_pending = 0;
+        {
+            output::BufferedWriter<Buffer> writer(
+                [&](const Buffer& buf){
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    written.insert(written.end(), buf.begin(), buf.end());
+                    --pending;
+                },
+                asynchronous, 3);
+
+            for (int i=0; i<50; ++i) {
+                auto buf = writer.acquire();
+                buf->assign({i, -i});
+                max_pending = std::max(max_pending, ++pending);
+                writer.submit(std::move(buf));
+            }
+            if (asynchronous) {
+                writer.flush();
+                BOOST_TEST(pending == 0);
+            }
+
+            // the destructor drains the remaining buffers
+            for (int i=50; i<60; ++i) {
+                auto buf = writer.acquire();
+                buf->assign({i, -i});
+                ++pending;
+                writer.submit(std::move(buf));
+            }
+        }
+
+        // all buffers are written in order, and at most the queue depth of
+        // them (and one being filled) are pending
+        BOOST_TEST(written.size() == 120u);
+        for (int i=0; i<60; ++i) {
+            BOOST_TEST(written[2*i] == i);
+            BOOST_TEST(written[2*i + 1] == -i);
+        }
+        BOOST_TEST(max_pending <= (asynchronous ? 4 : 1));
+    }
+
+    // errors of the writer thread are passed on
+    output::BufferedWriter<Buffer> failing(
+        [](const Buffer&){ throw std::runtime_error("disk full"); },
+        true, 2);
+    failing.submit(failing.acquire());
+    BOOST_CHECK_THROW(failing.flush(), std::runtime_error);
+    failing.flush();
+
+    BOOST_CHECK_THROW(output::BufferedWriter<Buffer>([](const Buffer&){},
+                                                     true, 0),
+                      std::invalid_argument);
+}
+
+} // namespace Utopia::Models::OpDyn
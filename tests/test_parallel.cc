@@ -0,0 +1,235 @@
+#define BOOST_TEST_MODULE test parallel
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include "../parallel.hh"
+#include "../revision.hh"
+#include "../OpDyn.hh"
+
+#include "fixtures.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Type definitions --------------------------------------------------------
+
+using vertex = boost::graph_traits<Network_u>::vertex_descriptor;
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// A larger random user network, and the batched revisions on it
+struct ParallelNetwork : TestNetwork {
+    ParallelNetwork()
+    :
+        TestNetwork(1000, 8000)
+    { }
+
+    /// Whether the revisions of u and v may not run concurrently
+    template<typename NWType>
+    static bool conflict(vertex u, vertex v, const NWType& g) {
+        return (u == v) or edge(u, v, g).second or edge(v, u, g).second;
+    }
+
+    /// Revise random batches of users on the given number of threads
+    template<typename NWType>
+    static void revise(NWType& g, std::size_t num_threads, unsigned seed) {
+        std::mt19937 rng(seed);
+        parallel::ThreadPool pool(num_threads);
+        parallel::ConflictColouring<NWType> colouring(num_vertices(g));
+        sampling::NeighbourSampler<NWType> sampler(num_vertices(g));
+        rewiring::Scratch<NWType> scratch(num_vertices(g));
+        revision::BatchScratch<NWType> batch_scratch;
+        std::uniform_real_distribution<double> prob(0., 1.);
+
+        std::vector<typename boost::graph_traits<NWType>::vertex_descriptor>
+            batch;
+        unsigned int rewiring_count = 0;
+        for (int b=0; b<50; ++b) {
+            batch.clear();
+            for (int i=0; i<200; ++i) {
+                batch.push_back(random_vertex(g, rng));
+            }
+            revision::parallel_user_revision<Mode::Ageing>(g, batch, 0.1, 0.4,
+                                                           rewiring_count,
+                                                           prob, 2., seed, b,
+                                                           sampler,
+                                                           colouring, scratch,
+                                                           batch_scratch,
+                                                           pool);
+        }
+    }
+};
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_thread_pool)
+{
+    parallel::ThreadPool pool(4);
+    BOOST_TEST(pool.num_threads() == 4);
+
+    // every index is visited once, by the thread of its contiguous chunk
+    for (std::size_t n : {0, 1, 3, 1000}) {
+        std::vector<std::atomic<int>> visits(n);
+        std::vector<std::size_t> threads(n);
+        pool.parallel_for(n, [&](std::size_t i, std::size_t t){
+            ++visits[i];
+            threads[i] = t;
+        });
+        for (std::size_t i=0; i<n; ++i) {
+            BOOST_TEST(visits[i] == 1);
+            if (n > 1) {
+                BOOST_TEST(i >= n * threads[i] / 4);
+                BOOST_TEST(i < n * (threads[i] + 1) / 4);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_pool_dynamic)
+{
+    parallel::ThreadPool pool(3);
+
+    // every index is visited once, also for tasks of very different length
+    for (std::size_t n : {0, 1, 50}) {
+        std::vector<std::atomic<int>> visits(n);
+        pool.parallel_for_dynamic(n, [&](std::size_t i, std::size_t t){
+            BOOST_TEST_REQUIRE(t < 3);
+            if (i % 10 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            ++visits[i];
+        });
+        for (std::size_t i=0; i<n; ++i) {
+            BOOST_TEST(visits[i] == 1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_pool_exceptions)
+{
+    parallel::ThreadPool pool(4);
+
+    // an exception on a worker or on the calling thread is rethrown once all
+    // threads are done
+    for (std::size_t thrower : {0, 3}) {
+        std::atomic<int> visits(0);
+        BOOST_CHECK_THROW(pool.parallel_for(100, [&](std::size_t, std::size_t t){
+            if (t == thrower) {
+                throw std::runtime_error("failed");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ++visits;
+        }), std::runtime_error);
+        BOOST_TEST(visits == 75);
+    }
+
+    // the pool is usable afterwards
+    std::atomic<int> visits(0);
+    pool.parallel_for_dynamic(100, [&](std::size_t, std::size_t){ ++visits; });
+    BOOST_TEST(visits == 100);
+}
+
+BOOST_FIXTURE_TEST_SUITE(parallel_suite, ParallelNetwork)
+
+BOOST_AUTO_TEST_CASE(test_conflict_colouring)
+{
+    parallel::ConflictColouring<Network_u> colouring(boost::num_vertices(nw));
+
+    for (int b=0; b<20; ++b) {
+        std::vector<vertex> batch;
+        for (int i=0; i<300; ++i) {
+            batch.push_back(boost::random_vertex(nw, rng));
+        }
+
+        // the batch is cut before the first repeated vertex
+        const auto last = colouring.batch_end(batch.begin(), batch.end());
+        const std::size_t n = last - batch.begin();
+        for (std::size_t i=0; i<n; ++i) {
+            for (std::size_t j=0; j<i; ++j) {
+                BOOST_TEST_REQUIRE(batch[i] != batch[j]);
+            }
+        }
+        if (last != batch.end()) {
+            const bool repeated = std::find(batch.begin(), last, *last) != last;
+            BOOST_TEST(repeated);
+        }
+
+        colouring.colour(batch.begin(), last, nw);
+
+        std::vector<int> level_of(n, -1);
+        const auto& levels = colouring.levels();
+        for (std::size_t l=0; l<levels.size(); ++l) {
+            BOOST_TEST(not levels[l].empty());
+            for (const auto i : levels[l]) {
+                BOOST_TEST_REQUIRE(level_of[i] == -1);
+                level_of[i] = l;
+            }
+        }
+
+        // conflicting revisions keep their order, all others may run
+        // concurrently
+        for (std::size_t i=0; i<n; ++i) {
+            BOOST_TEST_REQUIRE(level_of[i] != -1);
+            for (std::size_t j=0; j<i; ++j) {
+                if (conflict(batch[i], batch[j], nw)) {
+                    BOOST_TEST(level_of[j] < level_of[i]);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_user_revision,
+                     * boost::unit_test::tolerance(1e-10))
+{
+    auto fnw = FlatNetwork_u::from(nw);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        fnw[*v].age = nw[*v].age;
+        fnw[*v].opinion = nw[*v].opinion;
+        fnw[*v].tolerance = nw[*v].tolerance;
+        fnw[*v].susceptibility = nw[*v].susceptibility;
+        fnw[*v].weight_sum = nw[*v].weight_sum;
+        fnw[*v].used_media = 0;
+    }
+    auto nw_copy = nw;
+
+    revise(nw, 4, 7);
+    revise(nw_copy, 1, 7);
+    revise(fnw, 3, 7);
+
+    // The result is the same for any number of threads, and for both
+    // backends
+    BOOST_TEST(boost::num_edges(nw) == boost::num_edges(nw_copy));
+    BOOST_TEST(boost::num_edges(nw) == num_edges(fnw));
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        // (bit-identical, hence not compared with tolerance)
+        BOOST_TEST((nw[*v].opinion == nw_copy[*v].opinion));
+        BOOST_TEST(boost::out_degree(*v, nw)
+                   == boost::out_degree(*v, nw_copy));
+        BOOST_TEST((nw[*v].opinion == fnw[*v].opinion));
+        BOOST_TEST((nw[*v].tolerance == fnw[*v].tolerance));
+        BOOST_TEST(boost::out_degree(*v, nw) == out_degree(*v, fnw));
+
+        // the revised weights add up to the weight sum, as for both backends
+        double sum = 0.;
+        for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+            sum += nw[*e].attr;
+        }
+        BOOST_TEST(sum == nw[*v].weight_sum);
+        BOOST_TEST((nw[*v].weight_sum == fnw[*v].weight_sum));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
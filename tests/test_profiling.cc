@@ -0,0 +1,175 @@
+#define BOOST_TEST_MODULE test profiling
+
+// the timers and counters are tested as compiled in
+#define OPDYN_PROFILING
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "../profiling.hh"
+#include "../revision.hh"
+#include "../ageing.hh"
+#include "../OpDyn.hh"
+
+#include "fixtures.hh"
+
+namespace Utopia::Models::OpDyn {
+
+using profiling::Counter;
+using profiling::Phase;
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// The number of out-edges that differ between the networks a and b
+std::size_t num_rewired(const Network_u& a, const Network_u& b) {
+    std::size_t n = 0;
+    for (auto [e, e_end] = boost::edges(b); e!=e_end; ++e) {
+        if (not boost::edge(source(*e, b), target(*e, b), a).second) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(profiling_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_bind)
+{
+    profiling::Profile outer, inner;
+    BOOST_TEST(not profiling::current());
+
+    // nothing is counted without a bound profile
+    profiling::count(Counter::rewirings, 5);
+    {
+        const profiling::Bind bind(&outer);
+        profiling::count(Counter::rewirings, 2);
+        {
+            const profiling::Bind bind(&inner);
+            profiling::count(Counter::rewirings);
+        }
+        BOOST_TEST(profiling::current() == &outer);
+        profiling::count(Counter::nan_weights);
+    }
+    BOOST_TEST(not profiling::current());
+
+    BOOST_TEST(outer.summary().count(Counter::rewirings) == 2u);
+    BOOST_TEST(outer.summary().count(Counter::nan_weights) == 1u);
+    BOOST_TEST(inner.summary().count(Counter::rewirings) == 1u);
+    BOOST_TEST(inner.summary().count(Counter::nan_weights) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_timer)
+{
+    profiling::Profile profile;
+    for (int i=0; i<3; ++i) {
+        const profiling::Timer timer(profile, Phase::ageing);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const auto summary = profile.summary();
+    BOOST_TEST(summary.calls[std::size_t(Phase::ageing)] == 3u);
+    BOOST_TEST(summary.seconds(Phase::ageing) >= 0.006);
+    BOOST_TEST(summary.calls[std::size_t(Phase::step)] == 0u);
+    BOOST_TEST(summary.seconds(Phase::step) == 0.);
+}
+
+BOOST_AUTO_TEST_CASE(test_revision_counters)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    unsigned int rewiring_count = 0;
+    sampling::NeighbourSampler<Network_u> sampler(boost::num_vertices(nw));
+    rewiring::Scratch<Network_u> scratch(boost::num_vertices(nw));
+    const auto initial_nw = nw;
+
+    profiling::Profile profile;
+    {
+        const profiling::Bind bind(&profile);
+        for (int i=0; i<500; ++i) {
+            revision::user_revision<Mode::None>(nw, 0.1, 0.5, rewiring_count,
+                                                prob, 2., rng, sampler,
+                                                scratch);
+        }
+    }
+    const auto summary = profile.summary();
+    BOOST_TEST(summary.count(Counter::user_revisions) == 500u);
+
+    // many partners are beyond the tolerance, but not all
+    BOOST_TEST(summary.count(Counter::noop_interactions) > 0u);
+    BOOST_TEST(summary.count(Counter::noop_interactions) < 500u);
+
+    // every rewired edge is counted, including those rewired back later
+    BOOST_TEST(summary.count(Counter::rewirings) > 0u);
+    BOOST_TEST(summary.count(Counter::rewirings) == rewiring_count);
+    BOOST_TEST(summary.count(Counter::rewirings)
+               >= num_rewired(initial_nw, nw));
+    BOOST_TEST(summary.count(Counter::nan_weights) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_counters)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    parallel::ThreadPool pool(4);
+    parallel::ConflictColouring<Network_u> colouring(boost::num_vertices(nw));
+    sampling::NeighbourSampler<Network_u> sampler(boost::num_vertices(nw));
+    rewiring::Scratch<Network_u> scratch(boost::num_vertices(nw));
+
+    revision::BatchScratch<Network_u> batch_scratch;
+    unsigned int rewiring_count = 0;
+
+    std::vector<vertex> batch;
+    for (int i=0; i<200; ++i) {
+        batch.push_back(boost::random_vertex(nw, rng));
+    }
+
+    // the revisions on the workers count into the profile of the caller
+    profiling::Profile profile;
+    {
+        const profiling::Bind bind(&profile);
+        revision::parallel_user_revision<Mode::None>(nw, batch, 0.1, 0.5,
+                                                     rewiring_count,
+                                                     prob, 2., 42, 0,
+                                                     sampler, colouring,
+                                                     scratch, batch_scratch,
+                                                     pool);
+    }
+    const auto summary = profile.summary();
+    BOOST_TEST(summary.count(Counter::user_revisions) == 200u);
+    BOOST_TEST(summary.count(Counter::noop_interactions) > 0u);
+    BOOST_TEST(summary.count(Counter::rewirings) > 0u);
+    BOOST_TEST(summary.count(Counter::rewirings) == rewiring_count);
+}
+
+BOOST_AUTO_TEST_CASE(test_ageing_counters)
+{
+    const utils::SusceptibilityTable susceptibility(
+                                cfg["susceptibility"]["users"]["custom"]);
+    auto log = spdlog::get("root.OpDyn");
+
+    profiling::Profile profile;
+    {
+        const profiling::Bind bind(&profile);
+        ageing::ageing(0.01, 1, {1, 10}, {20, 40}, {75, 1000}, nw, log, rng,
+                       susceptibility);
+    }
+
+    // three users are replaced, each with a parent
+    const auto summary = profile.summary();
+    BOOST_TEST(summary.count(Counter::ageing_children) == 3u);
+    BOOST_TEST(summary.count(Counter::ageing_parents) == 3u);
+    BOOST_TEST(summary.count(Counter::ageing_peers) > 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
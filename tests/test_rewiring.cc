@@ -0,0 +1,130 @@
+#define BOOST_TEST_MODULE test rewiring
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+
+#include "../rewiring.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Type definitions --------------------------------------------------------
+
+using vertex = boost::graph_traits<Network_u>::vertex_descriptor;
+using Scratch = rewiring::Scratch<Network_u>;
+using FlatScratch = rewiring::Scratch<FlatNetwork_u>;
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// Random network, and a copy of it on the flat backend
+struct TestNetwork {
+    std::mt19937 rng;
+    Network_u nw;
+    FlatNetwork_u fnw;
+
+    TestNetwork()
+    :
+        rng(42),
+        nw{},
+        fnw{}
+    {
+        boost::generate_random_graph(nw, 100, 1500, rng, false, false);
+        fnw = FlatNetwork_u::from(nw);
+    }
+};
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(rewiring_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_marks)
+{
+    Scratch scratch(boost::num_vertices(nw));
+
+    const vertex v = 0;
+    BOOST_TEST_REQUIRE(boost::out_degree(v, nw) > 1);
+    const vertex w = *boost::adjacent_vertices(v, nw).first;
+    std::vector<vertex> to_drop{w};
+    scratch.begin(v, nw, to_drop);
+
+    // the neighbours, and only those, are marked
+    for (auto [u, u_end] = boost::vertices(nw); u!=u_end; ++u) {
+        BOOST_TEST(scratch.is(*u, Scratch::neighbour)
+                   == boost::edge(v, *u, nw).second);
+        BOOST_TEST(scratch.is(*u, Scratch::dropped) == (*u == w));
+        BOOST_TEST(not scratch.is(*u, Scratch::added));
+    }
+
+    // marks accumulate, and a removed neighbour keeps its other marks
+    scratch.mark(w, Scratch::added);
+    scratch.remove_neighbour(w);
+    BOOST_TEST(not scratch.is(w, Scratch::neighbour));
+    BOOST_TEST(scratch.is(w, Scratch::dropped));
+    BOOST_TEST(scratch.is(w, Scratch::added));
+
+    // the next rewiring starts without the marks of the last
+    const vertex v2 = 1;
+    scratch.begin(v2, nw, {});
+    for (auto [u, u_end] = boost::vertices(nw); u!=u_end; ++u) {
+        BOOST_TEST(scratch.is(*u, Scratch::neighbour)
+                   == boost::edge(v2, *u, nw).second);
+        BOOST_TEST(not scratch.is(*u, Scratch::dropped));
+        BOOST_TEST(not scratch.is(*u, Scratch::added));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_random_neighbour)
+{
+    Scratch scratch(boost::num_vertices(nw));
+    FlatScratch flat_scratch(num_vertices(fnw));
+
+    // the neighbours are drawn as by utils::get_rand_nb, from the same RNG
+    // state, also after removing edges; the copy of the neighbours on the
+    // adjacency list skips the removed ones
+    for (int i=0; i<200; ++i) {
+        vertex v = boost::random_vertex(nw, rng);
+        if (boost::out_degree(v, nw) < 4) {
+            continue;
+        }
+        scratch.begin(v, nw, {});
+        flat_scratch.begin(v, fnw, {});
+
+        auto rng_a = rng, rng_b = rng, rng_c = rng;
+        BOOST_TEST(scratch.random_neighbour(v, nw, rng_a)
+                   == utils::get_rand_nb(nw, v, rng_b));
+        BOOST_TEST(flat_scratch.random_neighbour(v, fnw, rng_c)
+                   == utils::get_rand_nb(fnw, v, rng));
+
+        for (int k=0; k<3; ++k) {
+            const vertex w = utils::get_rand_nb(nw, v, rng);
+            boost::remove_edge(v, w, nw);
+            remove_edge(v, w, fnw);
+            scratch.remove_neighbour(w);
+            flat_scratch.remove_neighbour(w);
+            BOOST_TEST(not scratch.is(w, Scratch::neighbour));
+
+            for (int j=0; j<10; ++j) {
+                auto rng_a = rng, rng_b = rng, rng_c = rng;
+                BOOST_TEST(scratch.random_neighbour(v, nw, rng_a)
+                           == utils::get_rand_nb(nw, v, rng_b));
+                BOOST_TEST(flat_scratch.random_neighbour(v, fnw, rng_c)
+                           == utils::get_rand_nb(fnw, v, rng));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace Utopia::Models::OpDyn
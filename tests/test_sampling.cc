@@ -0,0 +1,190 @@
+#define BOOST_TEST_MODULE test sampling
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/random.hpp>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+
+#include "../sampling.hh"
+#include "../revision.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+// -- Type definitions --------------------------------------------------------
+
+using vertex = boost::graph_traits<Network_u>::vertex_descriptor;
+
+// -- Fixtures ----------------------------------------------------------------
+
+/// Random network with random, normalised weights
+struct TestNetwork {
+    std::mt19937 rng;
+    Network_u nw;
+
+    TestNetwork()
+    :
+        rng(42),
+        nw{}
+    {
+        boost::generate_random_graph(nw, 200, 4000, rng, false, false);
+
+        for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+            double sum = 0.;
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+                nw[*e].attr = utils::get_rand_double(0., 1., rng);
+                sum += nw[*e].attr;
+            }
+            for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+                nw[*e].attr /= sum;
+            }
+        }
+    }
+
+    /// The partner a linear scan over the cumulative weights would pick
+    vertex linear_scan(vertex v, double frac) {
+        double cumulative = 0.;
+        for (auto [w, w_end] = boost::adjacent_vertices(v, nw); w!=w_end; ++w) {
+            if (cumulative < frac) {
+                cumulative += nw[boost::edge(v, *w, nw).first].attr;
+            }
+            if (cumulative >= frac) {
+                return *w;
+            }
+        }
+        return v;
+    }
+};
+
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_SUITE(sampling_suite, TestNetwork)
+
+BOOST_AUTO_TEST_CASE(test_neighbour_sampler)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    sampling::NeighbourSampler<Network_u> sampler(boost::num_vertices(nw));
+
+    // The sampler picks exactly the neighbour of the linear scan
+    for (int i=0; i<20000; ++i) {
+        const vertex v = boost::random_vertex(nw, rng);
+        const double frac = prob(rng);
+        BOOST_TEST(sampler.sample(v, frac, nw) == linear_scan(v, frac));
+    }
+
+    // ... also on the flat backend, where the targets are not cached
+    auto fnw = FlatNetwork_u::from(nw);
+    sampling::NeighbourSampler<FlatNetwork_u> flat_sampler(num_vertices(fnw));
+    for (int i=0; i<20000; ++i) {
+        const vertex v = boost::random_vertex(nw, rng);
+        const double frac = prob(rng);
+        BOOST_TEST(flat_sampler.sample(v, frac, fnw) == linear_scan(v, frac));
+    }
+
+    // Changed weights are only seen after invalidation
+    const vertex v = 0;
+    BOOST_TEST_REQUIRE(boost::out_degree(v, nw) > 1);
+    for (auto [e, e_end] = boost::out_edges(v, nw); e!=e_end; ++e) {
+        nw[*e].attr = 0.;
+    }
+    const auto [e, e_end] = boost::out_edges(v, nw);
+    nw[*e].attr = 1.;
+
+    sampler.sample(v, 0.5, nw);
+    BOOST_TEST(sampler.is_valid(v));
+    sampler.invalidate(v);
+    BOOST_TEST(not sampler.is_valid(v));
+    BOOST_TEST(sampler.sample(v, 0.5, nw) == boost::target(*e, nw));
+    BOOST_TEST(sampler.total_weight(v, nw) == 1.);
+}
+
+BOOST_AUTO_TEST_CASE(test_neighbour_sampler_weight_update)
+{
+    std::uniform_real_distribution<double> prob(0., 1.);
+    sampling::NeighbourSampler<Network_u> sampler(boost::num_vertices(nw));
+    std::vector<vertex> to_drop;
+    double sum_of_reduced_weights;
+
+    // The weight update refills the cache, which then draws as a rebuilt one
+    for (int i=0; i<200; ++i) {
+        const vertex v = boost::random_vertex(nw, rng);
+        sampler.invalidate(v);
+        revision::reduce_weights<Mode::None>(v, nw, 0.5, 0., prob, rng,
+                                             sampler, to_drop,
+                                             sum_of_reduced_weights);
+        BOOST_TEST_REQUIRE(to_drop.empty());
+        BOOST_TEST(sampler.is_valid(v));
+        BOOST_TEST(sampler.total_weight(v, nw) == sum_of_reduced_weights);
+
+        sampling::NeighbourSampler<Network_u> rebuilt(boost::num_vertices(nw));
+        for (int j=0; j<20; ++j) {
+            const double value = prob(rng) * sum_of_reduced_weights;
+            BOOST_TEST(sampler.sample(v, value, nw)
+                       == rebuilt.sample(v, value, nw));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+BOOST_AUTO_TEST_CASE(test_fenwick_tree,
+                     * boost::unit_test::tolerance(1e-9))
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> prob(0., 1.);
+
+    const std::size_t n = 37;
+    sampling::FenwickTree tree(n);
+    std::vector<double> values(n, 0.);
+
+    // many updates, including zeros, as for the media ad values
+    for (int i=0; i<5000; ++i) {
+        const auto idx = utils::get_rand_int(0, n, rng);
+        values[idx] = (prob(rng) < 0.2) ? 0. : utils::get_rand_int(0, 100, rng);
+        tree.set(idx, values[idx]);
+
+        double sum = 0.;
+        for (std::size_t k=0; k<n; ++k) {
+            BOOST_TEST(tree.prefix_sum(k) == sum);
+            sum += values[k];
+        }
+        BOOST_TEST(tree.total() == sum);
+        if (sum == 0.) {
+            continue;
+        }
+
+        // the drawn index is where the cumulative values reach frac * total
+        const double frac = prob(rng);
+        const auto drawn = tree.sample(frac);
+        BOOST_TEST(values[drawn] > 0.);
+        BOOST_TEST(tree.prefix_sum(drawn) / sum <= frac);
+        BOOST_TEST(tree.prefix_sum(drawn + 1) / sum >= frac);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_fenwick_tree_empty)
+{
+    // as for a media network without media, there is nothing to draw
+    sampling::FenwickTree tree(0);
+    BOOST_TEST(tree.size() == 0u);
+    BOOST_TEST(tree.total() == 0.);
+    BOOST_CHECK_THROW(tree.sample(0.5), std::invalid_argument);
+
+    // ... unlike a single medium, which is always drawn
+    sampling::FenwickTree single(1);
+    single.set(0, 2.);
+    BOOST_TEST(single.sample(0.) == 0u);
+    BOOST_TEST(single.sample(1.) == 0u);
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,262 @@
+#define BOOST_TEST_MODULE test scheduling
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+
+#include "../checkpoint.hh"
+#include "../scheduling.hh"
+
+namespace Utopia::Models::OpDyn {
+
+struct User {
+    double opinion = 0.;
+    double tolerance = 0.1;
+};
+
+using TestNetwork = boost::adjacency_list<boost::vecS, boost::vecS,
+                                          boost::bidirectionalS, User>;
+using Scheduler = scheduling::KineticScheduler<TestNetwork>;
+using ActiveSet = scheduling::ActiveSet<TestNetwork>;
+
+/// A network of n users, of which every third has an out-edge
+TestNetwork every_third(const std::size_t n) {
+    TestNetwork nw(n);
+    for (std::size_t v=0; v<n; v+=3) {
+        boost::add_edge(v, (v + 1) % n, nw);
+    }
+    return nw;
+}
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_events, * boost::unit_test::tolerance(0.01))
+{
+    const auto nw = every_third(300);
+    std::mt19937 rng(42);
+    Scheduler scheduler(300);
+    scheduler.update_all(nw);
+    scheduler.reschedule(0, rng);
+    BOOST_TEST(scheduler.event_probability() == 1. / 3.);
+
+    // only users with out-edges are drawn, in a third of the slots
+    const std::uint64_t num_slots = 300000;
+    std::uint64_t num_events = 0;
+    std::vector<std::size_t> draws(300, 0);
+    for (std::uint64_t slot=0; slot<num_slots; ++slot) {
+        if (auto v = scheduler.draw(slot, rng)) {
+            ++num_events;
+            ++draws[*v];
+        }
+        BOOST_TEST_REQUIRE(scheduler.next_event() > slot);
+    }
+    BOOST_TEST(double(num_events) / double(num_slots) == 1. / 3.);
+
+    for (std::size_t v=0; v<300; ++v) {
+        if (v % 3 == 0) {
+            BOOST_TEST(draws[v] > 0u);
+        }
+        else {
+            BOOST_TEST(draws[v] == 0u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_update)
+{
+    auto nw = every_third(30);
+    std::mt19937 rng(42);
+    Scheduler scheduler(30);
+
+    // no events without out-edges
+    scheduler.update_all(TestNetwork(30));
+    scheduler.reschedule(0, rng);
+    BOOST_TEST(scheduler.event_probability() == 0.);
+    BOOST_TEST(scheduler.next_event() == Scheduler::never);
+    BOOST_TEST(not scheduler.draw(0, rng));
+
+    // an event in every slot if all users have out-edges
+    for (std::size_t v=1; v<30; v+=3) {
+        boost::add_edge(v, 0, nw);
+        boost::add_edge(v + 1, 0, nw);
+    }
+    scheduler.update_all(nw);
+    scheduler.reschedule(5, rng);
+    BOOST_TEST(scheduler.event_probability() == 1.);
+    BOOST_TEST(scheduler.next_event() == 5u);
+    for (std::uint64_t slot=5; slot<50; ++slot) {
+        BOOST_TEST(scheduler.draw(slot, rng).has_value());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_checkpoint)
+{
+    const auto nw = every_third(300);
+    std::mt19937 rng(42);
+    Scheduler scheduler(300);
+    scheduler.update_all(nw);
+    scheduler.reschedule(0, rng);
+    for (std::uint64_t slot=0; slot<1000; ++slot) {
+        scheduler.draw(slot, rng);
+    }
+    {
+        checkpoint::Writer out("test_scheduling.chk");
+        scheduler.save(out);
+        out.commit();
+    }
+    Scheduler restored(300);
+    {
+        checkpoint::Reader in("test_scheduling.chk");
+        restored.load(in);
+        in.finish();
+    }
+    BOOST_TEST(restored.next_event() == scheduler.next_event());
+    BOOST_TEST(restored.event_probability() == scheduler.event_probability());
+
+    // both continue identically
+    auto restored_rng = rng;
+    for (std::uint64_t slot=1000; slot<5000; ++slot) {
+        const auto v = scheduler.draw(slot, rng);
+        const auto w = restored.draw(slot, restored_rng);
+        BOOST_TEST_REQUIRE(v.has_value() == w.has_value());
+        BOOST_TEST_REQUIRE(v.value_or(0) == w.value_or(0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_active_users)
+{
+    // a chain 0 -> 1 -> 2 -> 3, with 2 beyond the tolerance of 1
+    TestNetwork nw(5);
+    const std::vector<double> opinions = {0.1, 0.15, 0.5, 0.55, 0.9};
+    for (std::size_t v=0; v<5; ++v) {
+        nw[v].opinion = opinions[v];
+    }
+    for (std::size_t v=0; v<3; ++v) {
+        boost::add_edge(v, v + 1, nw);
+    }
+
+    ActiveSet active(5, 0.);
+    active.update_all(nw);
+    BOOST_TEST(active.size() == 2u);
+    BOOST_TEST(active.contains(0));
+    BOOST_TEST(not active.contains(1));
+    BOOST_TEST(active.contains(2));
+    BOOST_TEST(not active.contains(3));
+    BOOST_TEST(not active.contains(4));
+    BOOST_TEST(active.event_probability() == 0.4);
+
+    // an opinion change re-activates the in-neighbours
+    const double previous_opinion = nw[2].opinion;
+    nw[2].opinion = 0.2;
+    active.touch(2, nw, previous_opinion);
+    BOOST_TEST(active.contains(1));
+    BOOST_TEST(not active.contains(2));
+
+    // as do tolerance and edge changes the user itself
+    nw[2].tolerance = 0.4;
+    active.touch(2, nw, nw[2].opinion);
+    BOOST_TEST(active.contains(2));
+    boost::add_edge(4, 3, nw);
+    active.touch(4, nw, nw[4].opinion);
+    BOOST_TEST(not active.contains(4));
+    boost::add_edge(4, 0, nw);
+    active.touch(4, nw, nw[4].opinion);
+    BOOST_TEST(not active.contains(4));
+    nw[4].tolerance = 0.4;
+    active.touch(4, nw, nw[4].opinion);
+    BOOST_TEST(active.contains(4));
+
+    // with rewiring, far-off neighbours keep the users active
+    ActiveSet rewiring(5, 0.1);
+    rewiring.update_all(nw);
+    BOOST_TEST(rewiring.size() == 4u);
+    BOOST_TEST(not rewiring.contains(3));
+}
+
+BOOST_AUTO_TEST_CASE(test_active_events, * boost::unit_test::tolerance(0.01))
+{
+    // every third user has a neighbour within its tolerance, and every
+    // third one only a neighbour beyond it
+    auto nw = every_third(300);
+    for (std::size_t v=1; v<300; v+=3) {
+        nw[v + 1].opinion = 0.5;
+        boost::add_edge(v, v + 1, nw);
+    }
+
+    std::mt19937 rng(42);
+    ActiveSet active(300, 0.);
+    active.update_all(nw);
+    BOOST_TEST(active.event_probability() == 1. / 3.);
+
+    const std::uint64_t num_slots = 300000;
+    std::uint64_t num_events = 0;
+    std::vector<std::size_t> draws(300, 0);
+    for (std::uint64_t slot=0; slot<num_slots; ++slot) {
+        if (auto v = active.draw(slot, rng)) {
+            ++num_events;
+            ++draws[*v];
+            active.touch(*v, nw, nw[*v].opinion);
+        }
+    }
+    BOOST_TEST(double(num_events) / double(num_slots) == 1. / 3.);
+
+    for (std::size_t v=0; v<300; ++v) {
+        if (v % 3 == 0) {
+            BOOST_TEST(draws[v] > 0u);
+        }
+        else {
+            BOOST_TEST(draws[v] == 0u);
+        }
+    }
+
+    // no events without active users
+    ActiveSet none(300, 0.);
+    none.update_all(TestNetwork(300));
+    BOOST_TEST(not none.draw(0, rng));
+    BOOST_TEST(none.next_event() == ActiveSet::never);
+}
+
+BOOST_AUTO_TEST_CASE(test_active_checkpoint)
+{
+    auto nw = every_third(300);
+    std::mt19937 rng(42);
+    ActiveSet active(300, 0.);
+    active.update_all(nw);
+
+    // the order of the members depends on the history of the set
+    for (std::size_t v=0; v<300; v+=6) {
+        nw[v].tolerance = 0.;
+        nw[v + 1].opinion = 0.5;
+        active.touch(v + 1, nw, 0.);
+    }
+    for (std::uint64_t slot=0; slot<1000; ++slot) {
+        active.draw(slot, rng);
+    }
+    {
+        checkpoint::Writer out("test_scheduling_active.chk");
+        active.save(out);
+        out.commit();
+    }
+    ActiveSet restored(300, 0.);
+    {
+        checkpoint::Reader in("test_scheduling_active.chk");
+        restored.load(in);
+        in.finish();
+    }
+    BOOST_TEST(restored.size() == active.size());
+    BOOST_TEST(restored.next_event() == active.next_event());
+
+    // both continue identically
+    auto restored_rng = rng;
+    for (std::uint64_t slot=1000; slot<5000; ++slot) {
+        const auto v = active.draw(slot, rng);
+        const auto w = restored.draw(slot, restored_rng);
+        BOOST_TEST_REQUIRE(v.has_value() == w.has_value());
+        BOOST_TEST_REQUIRE(v.value_or(0) == w.value_or(0));
+    }
+}
+
+} // namespace Utopia::Models::OpDyn
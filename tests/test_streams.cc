@@ -0,0 +1,96 @@
+#define BOOST_TEST_MODULE test streams
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/random.hpp>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+
+#include "../streams.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+using streams::Philox4x32;
+using streams::Phase;
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_philox_known_answers)
+{
+    // The known-answer tests of the Random123 reference implementation
+    using C = Philox4x32::counter_type;
+    using K = Philox4x32::key_type;
+
+    BOOST_TEST((Philox4x32::encrypt(C{0, 0, 0, 0}, K{0, 0})
+                == C{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    BOOST_TEST((Philox4x32::encrypt(C{0xffffffff, 0xffffffff, 0xffffffff,
+                                      0xffffffff},
+                                    K{0xffffffff, 0xffffffff})
+                == C{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    BOOST_TEST((Philox4x32::encrypt(C{0x243f6a88, 0x85a308d3, 0x13198a2e,
+                                      0x03707344},
+                                    K{0xa4093822, 0x299f31d0})
+                == C{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+BOOST_AUTO_TEST_CASE(test_streams)
+{
+    // A stream is a pure function of (seed, step, id, phase) ...
+    auto a = streams::stream(42, 7, 3, Phase::user_revision);
+    auto b = streams::stream(42, 7, 3, Phase::user_revision);
+    std::vector<std::uint32_t> first;
+    for (int i=0; i<1000; ++i) {
+        first.push_back(a());
+        BOOST_TEST(first.back() == b());
+    }
+
+    // ... and discarding skips ahead
+    auto c = streams::stream(42, 7, 3, Phase::user_revision);
+    c.discard(500);
+    BOOST_TEST(c() == first[500]);
+
+    // Streams differing in any of the parameters start differently
+    std::set<std::uint32_t> starts;
+    for (std::uint64_t seed : {1ull, 2ull}) {
+        for (std::uint64_t step : {0ull, 1ull, (1ull << 40)}) {
+            for (std::uint32_t id : {0u, 1u}) {
+                for (auto phase : {Phase::batch, Phase::user_revision}) {
+                    starts.insert(streams::stream(seed, step, id, phase)());
+                }
+            }
+        }
+    }
+    BOOST_TEST(starts.size() == 24);
+}
+
+BOOST_AUTO_TEST_CASE(test_distributions, * boost::unit_test::tolerance(0.01))
+{
+    // The streams work with the utils functions and the boost graph sampling
+    auto rng = streams::stream(1, 0, 0, Phase::batch);
+
+    const int n = 200000;
+    double mean = 0.;
+    std::vector<int> counts(10, 0);
+    for (int i=0; i<n; ++i) {
+        mean += utils::get_rand_double(0., 1., rng) / n;
+        ++counts[utils::get_rand_int(0, 10, rng)];
+    }
+    BOOST_TEST(mean == 0.5);
+    for (const auto c : counts) {
+        BOOST_TEST(double(c) / n == 0.1);
+    }
+
+    boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS> g(50);
+    for (int i=0; i<1000; ++i) {
+        BOOST_TEST(boost::random_vertex(g, rng) < 50);
+    }
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -0,0 +1,164 @@
+#define BOOST_TEST_MODULE test synchronous
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/random.hpp>
+
+#include <utopia/core/model.hh>
+#include <utopia/core/types.hh>
+#include <utopia/core/graph.hh>
+
+#include "../synchronous.hh"
+#include "../OpDyn.hh"
+
+namespace Utopia::Models::OpDyn {
+
+using synchronous::Sums;
+using synchronous::index_t;
+
+/// The sums of the kernels, evaluated term by term
+Sums reference(const std::vector<double>& opinions,
+               const std::vector<index_t>& targets,
+               const std::vector<double>& weights,
+               const double opinion, const double tolerance)
+{
+    Sums sums;
+    for (std::size_t i=0; i<targets.size(); ++i) {
+        const double x = opinions[targets[i]];
+        if (std::fabs(x - opinion) <= tolerance) {
+            sums.weighted_opinion += weights[i] * x;
+            sums.weight += weights[i];
+        }
+    }
+    return sums;
+}
+
+/// A random user network with normalised weights
+Network_u random_network(std::mt19937& rng) {
+    Network_u nw;
+    boost::generate_random_graph(nw, 200, 2000, rng, false, false);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        nw[*v].opinion = uniform(rng);
+        nw[*v].tolerance = 0.1 + 0.2 * uniform(rng);
+        nw[*v].susceptibility = 0.5 * uniform(rng);
+        nw[*v].age = 20;
+        nw[*v].used_media = 0;
+        for (auto [e, e_end] = boost::out_edges(*v, nw); e!=e_end; ++e) {
+            nw[*e].attr = 1. / double(boost::out_degree(*v, nw));
+        }
+    }
+    return nw;
+}
+
+// -- Tests -------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(test_kernels, * boost::unit_test::tolerance(1e-12))
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::vector<double> opinions(1000);
+    for (auto& x : opinions) {
+        x = uniform(rng);
+    }
+
+    // all lengths around the vector widths, including the remainders
+    for (std::size_t n=0; n<40; ++n) {
+        std::vector<index_t> targets(n);
+        std::vector<double> weights(n);
+        for (std::size_t i=0; i<n; ++i) {
+            targets[i] = index_t(rng() % opinions.size());
+            weights[i] = uniform(rng);
+        }
+
+        for (const double tolerance : {0., 0.2, 1.}) {
+            const auto expected = reference(opinions, targets, weights, 0.4,
+                                            tolerance);
+            auto check = [&](const Sums& sums) {
+                BOOST_TEST(sums.weighted_opinion
+                           == expected.weighted_opinion);
+                BOOST_TEST(sums.weight == expected.weight);
+            };
+            check(synchronous::kernels::scalar(opinions.data(),
+                        targets.data(), weights.data(), n, 0.4, tolerance));
+#if defined(__AVX2__)
+            check(synchronous::kernels::avx2(opinions.data(),
+                        targets.data(), weights.data(), n, 0.4, tolerance));
+#endif
+#if defined(__AVX512F__)
+            check(synchronous::kernels::avx512(opinions.data(),
+                        targets.data(), weights.data(), n, 0.4, tolerance));
+#endif
+            check(synchronous::accumulate(opinions.data(),
+                        targets.data(), weights.data(), n, 0.4, tolerance));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_sweep, * boost::unit_test::tolerance(1e-12))
+{
+    // 0 -> 1 (weight 1) and 0 -> 2 (weight 3); 2 -> 0 and 2 -> 1, with 0
+    // beyond the tolerance of 2; 3 without neighbours
+    Network_u nw;
+    for (const double x : {0.2, 0.3, 0.4, 0.9}) {
+        const auto v = boost::add_vertex(nw);
+        nw[v].opinion = x;
+        nw[v].tolerance = 0.25;
+        nw[v].susceptibility = 0.5;
+    }
+    boost::add_edge(0, 1, {1.}, nw);
+    boost::add_edge(0, 2, {3.}, nw);
+    boost::add_edge(2, 0, {1.}, nw);
+    boost::add_edge(2, 1, {1.}, nw);
+    nw[2].tolerance = 0.15;
+
+    parallel::ThreadPool pool(1);
+    synchronous::Sweep<Network_u> sweep;
+    sweep(nw, 0., pool);
+
+    // the opinions of the snapshot are used, not those updated before
+    BOOST_TEST(nw[0].opinion == 0.2 + 0.5 * ((0.3 + 3. * 0.4) / 4. - 0.2));
+    BOOST_TEST(nw[1].opinion == 0.3);
+    BOOST_TEST(nw[2].opinion == 0.4 + 0.5 * (0.3 - 0.4));
+    BOOST_TEST(nw[3].opinion == 0.9);
+
+    // users moving towards the centre become more tolerant
+    sweep(nw, 2., pool);
+    BOOST_TEST(nw[1].tolerance == 0.25);
+    BOOST_TEST(nw[0].tolerance > 0.25);
+}
+
+BOOST_AUTO_TEST_CASE(test_backends_and_threads)
+{
+    std::mt19937 rng(42);
+    auto nw = random_network(rng);
+    auto flat_nw = FlatNetwork_u::from(nw);
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        flat_nw[*v].opinion = nw[*v].opinion;
+        flat_nw[*v].tolerance = nw[*v].tolerance;
+        flat_nw[*v].susceptibility = nw[*v].susceptibility;
+    }
+    auto threaded_nw = nw;
+
+    parallel::ThreadPool pool(1), threads(4);
+    synchronous::Sweep<Network_u> sweep, threaded_sweep;
+    synchronous::Sweep<FlatNetwork_u> flat_sweep;
+    for (int i=0; i<10; ++i) {
+        sweep(nw, 2., pool);
+        threaded_sweep(threaded_nw, 2., threads);
+        flat_sweep(flat_nw, 2., threads);
+    }
+
+    // identical for both backends and any number of threads
+    for (auto [v, v_end] = boost::vertices(nw); v!=v_end; ++v) {
+        BOOST_TEST_REQUIRE(threaded_nw[*v].opinion == nw[*v].opinion);
+        BOOST_TEST_REQUIRE(flat_nw[*v].opinion == nw[*v].opinion);
+        BOOST_TEST_REQUIRE(flat_nw[*v].tolerance == nw[*v].tolerance);
+    }
+}
+
+} // namespace Utopia::Models::OpDyn
@@ -1,5 +1,6 @@
 #define BOOST_TEST_MODULE test utils
 
+#include <cmath>
 #include <random>
 #include <type_traits>
 
@@ -94,6 +95,44 @@ BOOST_FIXTURE_TEST_CASE( test_inits,
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_distributions,
+                      * boost::unit_test::tolerance(1e-12))
+{
+    const auto cfg = YAML::Load("{distribution_type: age-dependent, "
+                                " custom: {peak: 17, val_at_0: 0.5, "
+                                "          val_at_peak: 0.8}}");
+
+    // the tabulated susceptibility matches the closed form, also beyond the
+    // tabulated ages
+    const utils::SusceptibilityTable table(cfg["custom"], 100);
+    for (int age=0; age<=150; ++age) {
+        BOOST_TEST((table(age) == utils::susceptibility(cfg["custom"], age)));
+    }
+    BOOST_TEST(table(0) == 0.5);
+    BOOST_TEST(table(17) == 0.8);
+
+    const utils::Distribution age_dependent(cfg);
+    BOOST_TEST((age_dependent(17, rng) == table(17)));
+
+    const utils::Distribution constant(YAML::Load(
+                        "{distribution_type: constant, const_val: 0.3}"));
+    BOOST_TEST(constant(rng) == 0.3);
+    BOOST_TEST(constant(17, rng) == 0.3);
+
+    const utils::Distribution uniform(YAML::Load(
+                        "{distribution_type: uniform, uniform_int: [0.2, 0.4]}"));
+    for (int i=0; i<100; ++i) {
+        const double val = uniform(rng);
+        BOOST_TEST(0.2<=val);
+        BOOST_TEST(val<=0.4);
+    }
+
+    BOOST_CHECK_THROW(utils::Distribution(YAML::Load(
+                        "{distribution_type: age-dependent, "
+                        " custom: {peak: 17, val_at_0: 1.5, val_at_peak: 0.8}}")),
+                      std::invalid_argument);
+}
+
 //2. Test opinion update........................................................
 
 BOOST_FIXTURE_TEST_CASE( test_opinion_update,
@@ -174,4 +213,37 @@ BOOST_FIXTURE_TEST_CASE( test_tolerance_update,
 
 }
 
+BOOST_AUTO_TEST_CASE( test_float_opinion_update )
+{
+    // the distance of 1 and y is rounded to t in float, but is larger
+    const float y = 0.75f * std::ldexp(1.f, -24);
+    const float t = std::nextafter(1.f, 0.f);
+    BOOST_TEST(std::fabs(1.f - y) <= t);
+    BOOST_TEST(not update::within(1.f, y, t));
+
+    // a float state decides as a double state holding the same values
+    BasicNetwork_u<float> nw_f(2);
+    Network_u nw_d(2);
+    auto init = [&](auto& nw) {
+        nw[0].opinion = 1.f;
+        nw[1].opinion = y;
+        nw[0].tolerance = t;
+        nw[0].susceptibility = 0.5;
+    };
+    init(nw_f);
+    init(nw_d);
+
+    vertex v = 0, nb = 1;
+    update::opinion(v, nb, nw_f);
+    update::opinion(v, nb, nw_d);
+    BOOST_TEST(nw_f[v].opinion == 1.f);
+    BOOST_TEST(nw_d[v].opinion == 1.);
+
+    // within the tolerance, the update is that of double, rounded
+    nw_f[v].tolerance = nw_d[v].tolerance = 1.f;
+    update::opinion(v, nb, nw_f);
+    update::opinion(v, nb, nw_d);
+    BOOST_TEST(nw_f[v].opinion == float(nw_d[v].opinion));
+}
+
 } // namespace Utopia::Models::OpDyn
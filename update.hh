@@ -1,8 +1,31 @@
 #ifndef UTOPIA_MODELS_OPDYN_UPDATE
 #define UTOPIA_MODELS_OPDYN_UPDATE
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
 namespace Utopia::Models::OpDyn::update{
 
+// COMPARISONS .................................................................
+// The model state may be of float (see OpDyn). Distances are compared in
+// double precision, in which the difference of two floats in [0, 1] is exact,
+// so a float state decides as a double state holding the same values would.
+
+/// Whether the distance of x and y is at most the tolerance
+inline bool within(const double x, const double y, const double tolerance) {
+    return std::fabs(x - y) <= tolerance;
+}
+
+/// The deviation from one of a sum of n normalised values of type Real that
+/// is still due to rounding
+template<typename Real>
+double sum_tolerance(const std::size_t n) {
+    return std::max(1e-12, 4. * double(n)
+                           * double(std::numeric_limits<Real>::epsilon()));
+}
+
 // UPDATE UTILITY FUNCTIONS ....................................................
 //user-user opinion update
 template <typename VertexDescType, typename NWType>
@@ -10,19 +33,20 @@ void opinion( VertexDescType& v,
                      VertexDescType& nb,
                      NWType& nw)
 {
-    if (fabs(nw[v].opinion-nw[nb].opinion) <= nw[v].tolerance) {
+    if (within(nw[v].opinion, nw[nb].opinion, nw[v].tolerance)) {
         nw[v].opinion += nw[v].susceptibility * (nw[nb].opinion-nw[v].opinion);
     }
 }
 
 //user-media opinion update
-template <typename VertexDescType, typename NWType_1, typename NWType_2>
+template <typename VertexDescType, typename MediumDescType,
+          typename NWType_1, typename NWType_2>
 void opinion( VertexDescType& v,
-                     VertexDescType& nb,
+                     MediumDescType& nb,
                      NWType_1& nw_1,
                      NWType_2& nw_2)
 {
-    if (fabs(nw_1[v].opinion-nw_2[nb].opinion) <= nw_1[v].tolerance) {
+    if (within(nw_1[v].opinion, nw_2[nb].opinion, nw_1[v].tolerance)) {
         nw_1[v].opinion += nw_1[v].susceptibility * nw_2[nb].persuasiveness
                             * (nw_2[nb].opinion-nw_1[v].opinion);
     }
@@ -4,6 +4,11 @@
 #include <cmath>
 #include <stdlib.h>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 #include <spdlog/spdlog.h>
 
 
@@ -43,16 +48,53 @@ auto get_rand_nb(NWType& nw, VertexDescType& v, RNGType& rng) {
     std::advance(nb, nb_shift);
     return *nb;
 }
+
+// SUSCEPTIBILITY FUNCTION .....................................................
+/*! The susceptibility of a user as a function of age, given by its value at
+age 0 and its peak. The parameters are read from the 'custom' config node once;
+the values of all ages up to max_age are tabulated, so that a lookup is a
+single array access. */
+class SusceptibilityTable {
+    double _peak;
+    double _b;
+    double _c;
+    std::vector<double> _table;
+
+public:
+    template<typename Config>
+    explicit SusceptibilityTable(const Config& cfg, const int max_age = 128)
+    :
+        _peak(get_as<double>("peak", cfg))
+    {
+        const double s_1 = get_as<double>("val_at_0", cfg);
+        const double s_2 = get_as<double>("val_at_peak", cfg);
+        _c = 1./s_2;
+        _b = (1.-_c*s_1)/(_c*s_1*pow(_peak, 2));
+
+        for (int age=0; age<=max_age; ++age) {
+            _table.push_back(evaluate(age));
+        }
+    }
+
+    /// The susceptibility at the given age
+    double operator()(const int age) const {
+        if (age >= 0 and std::size_t(age) < _table.size()) {
+            return _table[age];
+        }
+        return evaluate(age);
+    }
+
+private:
+    double evaluate(const int age) const {
+        const double denom = _c*(1.+_b*pow((age-_peak),2));
+        return 1./denom;
+    }
+};
+
 template<typename Config>
 double susceptibility(const Config cfg, const int age) {
     /*! This function returns the susceptibility of a user at a given age. */
-    const double s_0 = get_as<double>("peak", cfg);
-    const double s_1 = get_as<double>("val_at_0", cfg);
-    const double s_2 = get_as<double>("val_at_peak", cfg);
-    const double c = 1./s_2;
-    const double b = (1.-c*s_1)/(c*s_1*pow(s_0, 2));
-    const double denom = c*(1.+b*pow((age-s_0),2));
-    return 1./denom;
+    return SusceptibilityTable(cfg, 0)(age);
 }
 
 // Helper functions ............................................................
@@ -90,35 +132,110 @@ double set_init_Gauss( std::pair<double, double> distribution_info,
     return parameter;
 }
 
-// initialize properties
-template <typename RNGType, typename Config>
-double initialize ( const Config& cfg,
-                    RNGType& rng) {
-
-    const auto log = spdlog::get("root.OpDyn");
-
-    std::string distribution_type =
-              get_as<std::string>("distribution_type", cfg);
-    if (distribution_type == "constant") {
-        return get_as<double>("const_val", cfg);
+// PARAMETER DISTRIBUTIONS .....................................................
+/*! The initial distribution of a vertex property, parsed once from its config
+node (see initialize). The age-dependent distribution is only available for
+nodes with a 'custom' susceptibility function. */
+class Distribution {
+public:
+    enum class Type {
+        constant,
+        uniform,
+        gaussian,
+        age_dependent,
+        invalid
+    };
+
+private:
+    Type _type;
+    double _const_val;
+    std::pair<double, double> _interval;
+    std::pair<double, double> _gauss;
+    std::shared_ptr<const SusceptibilityTable> _age_dependent;
+
+public:
+    template<typename Config>
+    explicit Distribution(const Config& cfg)
+    :
+        _type(Type::invalid),
+        _const_val(0.),
+        _interval(0., 0.),
+        _gauss(0., 0.)
+    {
+        const auto distribution_type =
+                        get_as<std::string>("distribution_type", cfg);
+
+        if (distribution_type == "constant") {
+            _type = Type::constant;
+            _const_val = get_as<double>("const_val", cfg);
+        }
+        else if (distribution_type == "uniform") {
+            _type = Type::uniform;
+            _interval = get_as<std::pair<double, double>>("uniform_int", cfg);
+        }
+        else if (distribution_type == "gaussian") {
+            _type = Type::gaussian;
+            _gauss = std::make_pair(get_as<double>("mean", cfg),
+                                    get_as<double>("stddev", cfg));
+        }
+        else if (distribution_type == "age-dependent") {
+            const double s_0 = get_as<double>("peak", cfg["custom"]);
+            const double s_1 = get_as<double>("val_at_0", cfg["custom"]);
+            const double s_2 = get_as<double>("val_at_peak", cfg["custom"]);
+            if (s_0<0){
+              throw std::invalid_argument("Invalid value for 'peak':"
+                                          "age value must be greater than 0!");
+            }
+            if (s_1<0 or s_1>1){
+              throw std::invalid_argument("Invalid suscepbility value val_at_0:"
+                                          "susceptibility must be in [0, 1]!");
+            }
+            if (s_2<0 or s_2>1){
+              throw std::invalid_argument("Invalid suscepbility value val_at_peak:"
+                                          "susceptibility must be in [0, 1]!");
+            }
+            _type = Type::age_dependent;
+            _age_dependent = std::make_shared<const SusceptibilityTable>(
+                                                                cfg["custom"]);
+        }
     }
 
-    if (distribution_type == "uniform") {
-        std::pair<double, double> interval =
-                            get_as<std::pair<double, double>>("uniform_int", cfg);
-        return set_init_uniform(interval, rng);
+    Type type() const {
+        return _type;
     }
 
-    if (distribution_type == "gaussian") {
-        std::pair<double, double> distribution_info =
-                           std::make_pair(get_as<double>("mean", cfg),
-                                          get_as<double>("stddev", cfg));
-        return set_init_Gauss(distribution_info, rng);
+    /// Draw a value; without the age, age-dependent distributions are invalid
+    template<typename RNGType>
+    double operator()(RNGType& rng) const {
+        switch (_type) {
+            case Type::constant:
+                return _const_val;
+            case Type::uniform:
+                return set_init_uniform(_interval, rng);
+            case Type::gaussian:
+                return set_init_Gauss(_gauss, rng);
+            default:
+                spdlog::get("root.OpDyn")->error("Invalid distribution type");
+                return 0;
+        }
     }
-    else {
-        log->error("Invalid distribution type");
-        return 0;
+
+    /// Draw a value for a user of the given age
+    template<typename RNGType>
+    double operator()(const int age, RNGType& rng) const {
+        if (_type == Type::age_dependent) {
+            return (*_age_dependent)(age);
+        }
+        return (*this)(rng);
     }
+};
+
+// initialize properties; to draw many values, parse the config only once into
+// a Distribution
+template <typename RNGType, typename Config>
+double initialize ( const Config& cfg,
+                    RNGType& rng) {
+    return Distribution(cfg)(rng);
 }
 
 /* function overloading, so the age parameter doesn't always need to be given as
@@ -127,32 +244,7 @@ template <typename RNGType, typename Config>
 double initialize (const int age,
                    const Config& cfg,
                    RNGType& rng) {
-
-    std::string distribution_type =
-         get_as<std::string>("distribution_type", cfg);
-
-    if (distribution_type == "age-dependent") {
-          const double s_0 = get_as<double>("peak", cfg["custom"]);
-          const double s_1 = get_as<double>("val_at_0", cfg["custom"]);
-          const double s_2 = get_as<double>("val_at_peak", cfg["custom"]);
-          if (s_0<0){
-            throw std::invalid_argument("Invalid value for 'peak':"
-                                        "age value must be greater than 0!");
-          }
-          if (s_1<0 or s_1>1){
-            throw std::invalid_argument("Invalid suscepbility value val_at_0:"
-                                        "susceptibility must be in [0, 1]!");
-          }
-          if (s_2<0 or s_2>1){
-            throw std::invalid_argument("Invalid suscepbility value val_at_peak:"
-                                        "susceptibility must be in [0, 1]!");
-          }
-
-           return susceptibility(cfg["custom"], age);
-      }
-
-    else { return initialize(cfg, rng);}
-
+    return Distribution(cfg)(age, rng);
 }
 
 } // namespace